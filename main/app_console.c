@@ -0,0 +1,48 @@
+#include "app_console.h"
+#include "esp_console.h"
+#include "esp_log.h"
+#include "input_inject.h"
+#include "input_expander.h"
+#include "input_capture.h"
+#include "output_driver.h"
+#include "shift_out.h"
+#include "lighting.h"
+#include "meter_output.h"
+#include "audio_out.h"
+#include "storage.h"
+#include "history.h"
+
+static const char *TAG = "console";
+
+void app_console_init(void)
+{
+#if CONFIG_APP_CONSOLE
+  esp_console_repl_t *repl = NULL;
+  esp_console_repl_config_t repl_config = ESP_CONSOLE_REPL_CONFIG_DEFAULT();
+  repl_config.prompt = "clock>";
+  repl_config.max_cmdline_length = 256;
+
+#if CONFIG_ESP_CONSOLE_USB_SERIAL_JTAG
+  esp_console_dev_usb_serial_jtag_config_t hw_config = ESP_CONSOLE_DEV_USB_SERIAL_JTAG_CONFIG_DEFAULT();
+  ESP_ERROR_CHECK(esp_console_new_repl_usb_serial_jtag(&hw_config, &repl_config, &repl));
+#else
+  esp_console_dev_uart_config_t hw_config = ESP_CONSOLE_DEV_UART_CONFIG_DEFAULT();
+  ESP_ERROR_CHECK(esp_console_new_repl_uart(&hw_config, &repl_config, &repl));
+#endif
+
+  esp_console_register_help_command();
+  input_inject_register_commands();
+  input_expander_register_commands();
+  input_capture_register_commands();
+  output_clock_register_commands();
+  shift_out_register_commands();
+  lighting_register_commands();
+  meter_output_register_commands();
+  audio_out_register_commands();
+  storage_register_commands();
+  history_register_commands();
+
+  ESP_ERROR_CHECK(esp_console_start_repl(repl));
+  ESP_LOGI(TAG, "Console started");
+#endif
+}
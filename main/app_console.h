@@ -0,0 +1,7 @@
+#ifndef APP_CONSOLE_H
+#define APP_CONSOLE_H
+
+/* Serial console (esp_console REPL) with the commands of the modules */
+void app_console_init(void);
+
+#endif
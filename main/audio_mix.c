@@ -0,0 +1,137 @@
+#include <stdlib.h>
+#include <string.h>
+#include "audio_mix.h"
+
+void audio_mixer_init(audio_mixer_t *m, uint16_t master)
+{
+  memset(m, 0, sizeof(*m));
+  m->master = master;
+}
+
+bool audio_mixer_start(audio_mixer_t *m, const audio_clip_t *clip)
+{
+  if (clip->count == 0)
+    return false;
+  for (int v = 0; v < AUDIO_VOICES_MAX; v++)
+  {
+    if (!m->voices[v].clip)
+    {
+      m->voices[v].pos = 0;
+      m->voices[v].clip = clip;
+      return true;
+    }
+  }
+  return false;
+}
+
+int audio_mixer_render(audio_mixer_t *m, int16_t *out, size_t frames)
+{
+  int32_t acc[64];
+  int active = 0;
+
+  for (size_t done = 0; done < frames;)
+  {
+    size_t n = frames - done < 64 ? frames - done : 64;
+    memset(acc, 0, n * sizeof(acc[0]));
+
+    for (int v = 0; v < AUDIO_VOICES_MAX; v++)
+    {
+      audio_voice_t *voice = &m->voices[v];
+      if (!voice->clip)
+        continue;
+      const audio_clip_t *clip = voice->clip;
+      uint32_t left = clip->count - voice->pos;
+      size_t k_end = n < left ? n : left;
+      const int16_t *src = clip->samples + voice->pos;
+      int32_t gain = clip->gain;
+      for (size_t k = 0; k < k_end; k++)
+        acc[k] += (src[k] * gain) >> 15;
+      voice->pos += k_end;
+      if (voice->pos >= clip->count)
+        voice->clip = NULL;
+    }
+
+    int32_t master = m->master;
+    for (size_t k = 0; k < n; k++)
+    {
+      int32_t s = (acc[k] * master) >> 15;
+      if (s > INT16_MAX)
+      {
+        s = INT16_MAX;
+        m->clipped++;
+      }
+      else if (s < INT16_MIN)
+      {
+        s = INT16_MIN;
+        m->clipped++;
+      }
+      out[done + k] = (int16_t)s;
+    }
+    done += n;
+  }
+
+  for (int v = 0; v < AUDIO_VOICES_MAX; v++)
+  {
+    if (m->voices[v].clip)
+      active++;
+  }
+  return active;
+}
+
+int audio_sched_parse(audio_sched_t *s, const char *text, int (*find_clip)(const char *name, int len))
+{
+  int skipped = 0;
+  s->count = 0;
+  const char *p = text;
+  while (*p)
+  {
+    const char *item = p;
+    int len = strcspn(p, ",");
+    p += len;
+    if (*p == ',')
+      p++;
+
+    int hour = -1;
+    const char *q = item;
+    if (*q == '*')
+      q++;
+    else
+      hour = (int)strtol(item, (char **)&q, 10);
+    if (q == item || *q != ':')
+    {
+      skipped++;
+      continue;
+    }
+    const char *mstart = q + 1;
+    int minute = (int)strtol(mstart, (char **)&q, 10);
+    // only "*" gives an hour below 0, "-5:00" is not every hour
+    if (q == mstart || *q != '=' || (*item != '*' && hour < 0) || hour > 23 || minute < 0 || minute > 59 || s->count >= AUDIO_SCHEDULE_MAX)
+    {
+      skipped++;
+      continue;
+    }
+    const char *name = q + 1;
+    int clip = find_clip(name, (int)(item + len - name));
+    if (clip < 0)
+    {
+      skipped++;
+      continue;
+    }
+    s->entries[s->count++] = (audio_sched_entry_t){.hour = (int8_t)hour, .minute = (uint8_t)minute, .clip = (uint8_t)clip};
+  }
+  return skipped;
+}
+
+int audio_sched_due(const audio_sched_t *s, uint16_t minute_of_day, uint8_t *clips, int max)
+{
+  int hour = minute_of_day / 60;
+  int minute = minute_of_day % 60;
+  int n = 0;
+  for (uint8_t i = 0; i < s->count && n < max; i++)
+  {
+    const audio_sched_entry_t *e = &s->entries[i];
+    if (e->minute == minute && (e->hour < 0 || e->hour == hour))
+      clips[n++] = e->clip;
+  }
+  return n;
+}
@@ -0,0 +1,63 @@
+#ifndef AUDIO_MIX_H
+#define AUDIO_MIX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Fixed-point mixer and chime schedule for audio_out.c.
+ * Plain C without IDF dependencies.
+ */
+
+#define AUDIO_VOICES_MAX 4
+#define AUDIO_SCHEDULE_MAX 16
+#define AUDIO_CLIP_NAME_LEN 16
+#define AUDIO_GAIN_UNITY 32768 // Q15
+
+/* A clip plays straight from where its samples are, e.g. memory mapped flash */
+typedef struct {
+  const int16_t *samples; // mono, native endian
+  uint32_t count;
+  uint16_t gain; // Q15, AUDIO_GAIN_UNITY = 1.0
+} audio_clip_t;
+
+typedef struct {
+  const audio_clip_t *clip; // NULL = free
+  uint32_t pos;
+} audio_voice_t;
+
+typedef struct {
+  audio_voice_t voices[AUDIO_VOICES_MAX];
+  uint16_t master; // Q15
+  uint32_t clipped; // samples saturated so far
+} audio_mixer_t;
+
+void audio_mixer_init(audio_mixer_t *m, uint16_t master);
+
+// Start a clip on a free voice; false if all voices play
+bool audio_mixer_start(audio_mixer_t *m, const audio_clip_t *clip);
+
+// Mix frames mono samples into out, silence once all voices end; returns voices still playing
+int audio_mixer_render(audio_mixer_t *m, int16_t *out, size_t frames);
+
+/* A chime at a model time of day; hour -1 = every hour */
+typedef struct {
+  int8_t hour;
+  uint8_t minute;
+  uint8_t clip; // index into the clip bank
+} audio_sched_entry_t;
+
+typedef struct {
+  audio_sched_entry_t entries[AUDIO_SCHEDULE_MAX];
+  uint8_t count;
+} audio_sched_t;
+
+// "HH:MM=name,*:MM=name" with names resolved by find_clip (-1 = unknown, entry skipped).
+// Returns the number of entries skipped.
+int audio_sched_parse(audio_sched_t *s, const char *text, int (*find_clip)(const char *name, int len));
+
+// Clips due at a minute of the model day (0..1439), at most max; returns the count
+int audio_sched_due(const audio_sched_t *s, uint16_t minute_of_day, uint8_t *clips, int max);
+
+#endif
@@ -0,0 +1,265 @@
+#include <stdio.h>
+#include <string.h>
+#include "audio_out.h"
+#include "audio_mix.h"
+#include "event_handler.h"
+#include "driver/i2s_std.h"
+#include "esp_partition.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_console.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char *TAG = "audio_out";
+
+#if CONFIG_AUDIO_ENABLE
+
+#define AUDIO_BLOCK_FRAMES 256
+#define AUDIO_DMA_BUFFERS 6
+#define AUDIO_QUEUE_DEPTH 8
+
+static audio_clip_t clips[AUDIO_CLIPS_MAX];
+static char clip_names[AUDIO_CLIPS_MAX][AUDIO_CLIP_NAME_LEN + 1];
+static uint8_t clip_count = 0;
+static uint32_t sample_rate = 0;
+
+static audio_mixer_t mixer;
+static audio_sched_t schedule;
+static QueueHandle_t play_queue = NULL;
+static i2s_chan_handle_t tx = NULL;
+static int16_t block[AUDIO_BLOCK_FRAMES];
+static volatile bool playing = false;
+
+static audio_stats_t stats;
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static int find_clip(const char *name, int len)
+{
+  for (int i = 0; i < clip_count; i++)
+  {
+    if ((int)strlen(clip_names[i]) == len && strncmp(clip_names[i], name, len) == 0)
+      return i;
+  }
+  return -1;
+}
+
+// The DMA sent a buffer nobody refilled; idle silence does not count
+static bool IRAM_ATTR audio_underrun(i2s_chan_handle_t handle, i2s_event_data_t *event, void *user_ctx)
+{
+  if (playing)
+  {
+    portENTER_CRITICAL_ISR(&stats_lock);
+    stats.underruns++;
+    portEXIT_CRITICAL_ISR(&stats_lock);
+  }
+  return false;
+}
+
+// Map the partition and point the clips into it, nothing is copied
+static bool load_bank(void)
+{
+  const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "audio");
+  if (!part)
+  {
+    ESP_LOGW(TAG, "No audio partition");
+    return false;
+  }
+  const void *base;
+  esp_partition_mmap_handle_t map;
+  if (esp_partition_mmap(part, 0, part->size, ESP_PARTITION_MMAP_DATA, &base, &map) != ESP_OK)
+  {
+    ESP_LOGW(TAG, "Audio partition not mapped");
+    return false;
+  }
+
+  const audio_bank_header_t *hdr = (const audio_bank_header_t *)base;
+  if (memcmp(hdr->magic, AUDIO_BANK_MAGIC, 4) != 0 || hdr->version != AUDIO_BANK_VERSION)
+  {
+    ESP_LOGW(TAG, "No clip bank in the audio partition, see tools/pack_audio.py");
+    esp_partition_munmap(map);
+    return false;
+  }
+  sample_rate = hdr->sample_rate;
+  const audio_bank_entry_t *entries = (const audio_bank_entry_t *)(hdr + 1);
+  for (int i = 0; i < hdr->count && clip_count < AUDIO_CLIPS_MAX; i++)
+  {
+    const audio_bank_entry_t *e = &entries[i];
+    if ((e->offset & 3) || e->offset + (uint64_t)e->samples * 2 > part->size)
+    {
+      ESP_LOGW(TAG, "Clip %d outside the partition", i);
+      continue;
+    }
+    clips[clip_count] = (audio_clip_t){
+        .samples = (const int16_t *)((const uint8_t *)base + e->offset),
+        .count = e->samples,
+        .gain = e->gain,
+    };
+    memcpy(clip_names[clip_count], e->name, AUDIO_CLIP_NAME_LEN);
+    clip_names[clip_count][AUDIO_CLIP_NAME_LEN] = '\0';
+    clip_count++;
+  }
+  return clip_count > 0;
+}
+
+static void audio_task(void *arg)
+{
+  uint8_t id;
+  while (1)
+  {
+    // idle until a clip is requested, the DMA repeats silence meanwhile
+    if (!playing)
+    {
+      xQueueReceive(play_queue, &id, portMAX_DELAY);
+      if (!audio_mixer_start(&mixer, &clips[id]))
+        continue;
+      playing = true;
+    }
+    while (xQueueReceive(play_queue, &id, 0) == pdTRUE)
+    {
+      if (!audio_mixer_start(&mixer, &clips[id]))
+      {
+        portENTER_CRITICAL(&stats_lock);
+        stats.dropped++;
+        portEXIT_CRITICAL(&stats_lock);
+      }
+    }
+
+    int64_t start_us = esp_timer_get_time();
+    int active = audio_mixer_render(&mixer, block, AUDIO_BLOCK_FRAMES);
+    uint32_t mix_us = (uint32_t)(esp_timer_get_time() - start_us);
+
+    size_t written;
+    i2s_channel_write(tx, block, sizeof(block), &written, portMAX_DELAY); // waits for a free DMA buffer
+
+    portENTER_CRITICAL(&stats_lock);
+    stats.blocks++;
+    stats.clipped = mixer.clipped;
+    if (mix_us > stats.mix_us_max)
+      stats.mix_us_max = mix_us;
+    portEXIT_CRITICAL(&stats_lock);
+    if (active == 0)
+      playing = false;
+  }
+}
+
+// EVENT_MODEL_MINUTE_TICK: queue the chimes of this minute
+static void minute_tick_handler(void *handler_arg, esp_event_base_t base, int32_t id, void *event_data)
+{
+  uint32_t ts = *(uint32_t *)event_data;
+  uint8_t due[AUDIO_VOICES_MAX];
+  int n = audio_sched_due(&schedule, (ts / 60) % 1440, due, AUDIO_VOICES_MAX);
+  for (int i = 0; i < n; i++)
+    xQueueSend(play_queue, &due[i], 0);
+}
+
+void audio_out_init(void)
+{
+  if (!load_bank())
+    return;
+
+  i2s_chan_config_t chan_cfg = I2S_CHANNEL_DEFAULT_CONFIG(I2S_NUM_AUTO, I2S_ROLE_MASTER);
+  chan_cfg.dma_desc_num = AUDIO_DMA_BUFFERS;
+  chan_cfg.dma_frame_num = AUDIO_BLOCK_FRAMES;
+  chan_cfg.auto_clear = true; // silence, not the last buffer again, when the mixer is late
+  ESP_ERROR_CHECK(i2s_new_channel(&chan_cfg, &tx, NULL));
+  i2s_std_config_t std_cfg = {
+      .clk_cfg = I2S_STD_CLK_DEFAULT_CONFIG(sample_rate),
+      .slot_cfg = I2S_STD_PHILIPS_SLOT_DEFAULT_CONFIG(I2S_DATA_BIT_WIDTH_16BIT, I2S_SLOT_MODE_MONO),
+      .gpio_cfg = {
+          .mclk = I2S_GPIO_UNUSED,
+          .bclk = CONFIG_AUDIO_BCLK_GPIO,
+          .ws = CONFIG_AUDIO_WS_GPIO,
+          .dout = CONFIG_AUDIO_DOUT_GPIO,
+          .din = I2S_GPIO_UNUSED,
+      },
+  };
+  ESP_ERROR_CHECK(i2s_channel_init_std_mode(tx, &std_cfg));
+  i2s_event_callbacks_t cbs = {
+      .on_send_q_ovf = audio_underrun,
+  };
+  ESP_ERROR_CHECK(i2s_channel_register_event_callback(tx, &cbs, NULL));
+  ESP_ERROR_CHECK(i2s_channel_enable(tx));
+
+  audio_mixer_init(&mixer, CONFIG_AUDIO_VOLUME * AUDIO_GAIN_UNITY / 100);
+  int skipped = audio_sched_parse(&schedule, CONFIG_AUDIO_SCHEDULE, find_clip);
+  if (skipped)
+    ESP_LOGW(TAG, "%d schedule entries skipped (format HH:MM=clip or *:MM=clip)", skipped);
+
+  play_queue = xQueueCreate(AUDIO_QUEUE_DEPTH, sizeof(uint8_t));
+  // core 0 below the LCD and tick tasks on core 1, the DMA covers the wake-up latency
+  xTaskCreatePinnedToCore(audio_task, "audio", 3072, NULL, 4, NULL, 0);
+  events_subscribe(EVENT_MODEL_MINUTE_TICK, minute_tick_handler, NULL);
+
+  ESP_LOGI(TAG, "%u clips at %lu Hz, %u chimes scheduled", clip_count, sample_rate, schedule.count);
+}
+
+bool audio_out_play(const char *name)
+{
+  if (!play_queue)
+    return false;
+  int id = find_clip(name, strlen(name));
+  if (id < 0)
+    return false;
+  uint8_t clip = (uint8_t)id;
+  return xQueueSend(play_queue, &clip, 0) == pdTRUE;
+}
+
+void audio_out_get_stats(audio_stats_t *out)
+{
+  portENTER_CRITICAL(&stats_lock);
+  *out = stats;
+  portEXIT_CRITICAL(&stats_lock);
+}
+
+static int cmd_audio(int argc, char **argv)
+{
+  if (argc == 3 && strcmp(argv[1], "play") == 0)
+  {
+    if (!audio_out_play(argv[2]))
+    {
+      printf("unknown clip or queue full\n");
+      return 1;
+    }
+  }
+
+  audio_stats_t s;
+  audio_out_get_stats(&s);
+  printf("blocks %lu, underruns %lu, dropped %lu, clipped %lu, mix us max %lu\n", s.blocks, s.underruns, s.dropped,
+         s.clipped, s.mix_us_max);
+  for (int i = 0; i < clip_count; i++)
+    printf("%s: %lu.%02lu s\n", clip_names[i], clips[i].count / sample_rate, clips[i].count % sample_rate * 100 / sample_rate);
+  return 0;
+}
+
+void audio_out_register_commands(void)
+{
+  const esp_console_cmd_t audio_cmd = {
+      .command = "audio",
+      .help = "Audio clips and underrun counters, 'audio play chime' plays a clip",
+      .hint = "[play <clip>]",
+      .func = cmd_audio,
+  };
+  ESP_ERROR_CHECK(esp_console_cmd_register(&audio_cmd));
+}
+#else
+void audio_out_init(void)
+{
+  ESP_LOGD(TAG, "Audio output disabled");
+}
+
+bool audio_out_play(const char *name)
+{
+  return false;
+}
+
+void audio_out_get_stats(audio_stats_t *out)
+{
+  memset(out, 0, sizeof(*out));
+}
+
+void audio_out_register_commands(void)
+{
+}
+#endif
@@ -0,0 +1,52 @@
+#ifndef AUDIO_OUT_H
+#define AUDIO_OUT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define AUDIO_CLIPS_MAX 16
+
+/* Clip bank in the "audio" partition, written by tools/pack_audio.py; little endian */
+#define AUDIO_BANK_MAGIC "MCAU"
+#define AUDIO_BANK_VERSION 1
+
+typedef struct {
+  char magic[4];
+  uint16_t version;
+  uint16_t count;
+  uint32_t sample_rate;
+  uint32_t reserved;
+} audio_bank_header_t;
+
+typedef struct {
+  char name[16];    // zero padded
+  uint32_t offset;  // from the start of the partition, 4 byte aligned
+  uint32_t samples; // 16 bit mono
+  uint16_t gain;    // Q15
+  uint16_t reserved[3];
+} audio_bank_entry_t;
+
+typedef struct {
+  uint32_t blocks;    // mixed blocks handed to the DMA
+  uint32_t underruns; // DMA ran dry while a clip played
+  uint32_t dropped;   // clips not started, all voices busy
+  uint32_t clipped;   // samples saturated in the mixer
+  uint32_t mix_us_max; // slowest block
+} audio_stats_t;
+
+/*
+ * Chimes and station jingles on an I2S DAC. Clips are played straight from the memory
+ * mapped partition: the mixer reads flash through the cache into one static block,
+ * i2s_channel_write() copies that into the DMA buffers. Chimes fire from a schedule on
+ * model minute ticks.
+ */
+void audio_out_init(void);
+
+// Queue a clip by name from any task, never blocks; false if unknown or the queue is full
+bool audio_out_play(const char *name);
+
+void audio_out_get_stats(audio_stats_t *out);
+
+void audio_out_register_commands(void);
+
+#endif
@@ -1,135 +1,235 @@
 #include "button_driver.h"
 #include "event_handler.h"
 #include "driver/gpio.h"
-#include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
-#include "freertos/queue.h"
+#include "esp_timer.h"
 #include "esp_log.h"
 
-#define GPIO_EVT_QUEUE_SIZE 16
-
 static const char *TAG = "button_driver";
-// List of button GPIOs
-static const int button_gpio_values[BUTTON__COUNT] = {
-    CONFIG_BUTTON_START_STOP_GPIO,
-    CONFIG_BUTTON_MENU_GPIO,
-    CONFIG_BUTTON_LEFT_GPIO,
-    CONFIG_BUTTON_RIGHT_GPIO,
-    CONFIG_BUTTON_UP_GPIO,
-    CONFIG_BUTTON_DOWN_GPIO,
-    CONFIG_BUTTON_CANCEL_GPIO,
-    CONFIG_BUTTON_OK_GPIO,
+
+/*
+ * Every button runs its own small state machine. One periodic scan samples all of them,
+ * debounces the levels and advances each machine, so a held button never delays the others:
+ * latency is bounded by the scan period plus the debounce time.
+ *
+ * A button that can start a chord (BUTTON_F_CHORD) holds its press back for
+ * CONFIG_BUTTON_CHORD_WINDOW_MS: a short tap is posted on release, a longer press when the
+ * window ends, and a press that becomes part of a chord is never posted at all.
+ */
+
+typedef enum {
+  BTN_IDLE = 0,
+  BTN_PRESSED, // down, waiting for long press
+  BTN_HELD,    // long press reached, repeating
+  BTN_WAIT,    // down, press held back for the chord window
+  BTN_CHORD,   // down as part of a chord, posts nothing
+  BTN__STATES,
+} button_state_t;
+
+typedef enum {
+  BTN_IN_DOWN = 0, // debounced press
+  BTN_IN_UP,       // debounced release
+  BTN_IN_TIMEOUT,  // state timer expired
+  BTN__INPUTS,
+} button_input_t;
+
+typedef enum {
+  BTN_TIMER_KEEP = 0,
+  BTN_TIMER_NONE,
+  BTN_TIMER_LONG,
+  BTN_TIMER_REPEAT,
+  BTN_TIMER_CHORD,
+} button_timer_t;
+
+#define BTN_NO_EVENT (-1)
+
+typedef struct {
+  button_state_t next;
+  int32_t event;
+  button_timer_t timer;
+} button_transition_t;
+
+static const button_transition_t button_fsm[BTN__STATES][BTN__INPUTS] = {
+    [BTN_IDLE] = {
+        [BTN_IN_DOWN] = {BTN_PRESSED, EVENT_BUTTON_PRESS, BTN_TIMER_LONG},
+        [BTN_IN_UP] = {BTN_IDLE, BTN_NO_EVENT, BTN_TIMER_NONE},
+        [BTN_IN_TIMEOUT] = {BTN_IDLE, BTN_NO_EVENT, BTN_TIMER_NONE},
+    },
+    [BTN_PRESSED] = {
+        [BTN_IN_DOWN] = {BTN_PRESSED, BTN_NO_EVENT, BTN_TIMER_KEEP},
+        [BTN_IN_UP] = {BTN_IDLE, EVENT_BUTTON_RELEASE, BTN_TIMER_NONE},
+        [BTN_IN_TIMEOUT] = {BTN_HELD, EVENT_BUTTON_LONG_PRESS, BTN_TIMER_REPEAT},
+    },
+    [BTN_HELD] = {
+        [BTN_IN_DOWN] = {BTN_HELD, BTN_NO_EVENT, BTN_TIMER_KEEP},
+        [BTN_IN_UP] = {BTN_IDLE, EVENT_BUTTON_RELEASE, BTN_TIMER_NONE},
+        [BTN_IN_TIMEOUT] = {BTN_HELD, EVENT_BUTTON_REPEATED_PRESS, BTN_TIMER_REPEAT},
+    },
+    [BTN_WAIT] = {
+        [BTN_IN_DOWN] = {BTN_WAIT, BTN_NO_EVENT, BTN_TIMER_KEEP},
+        [BTN_IN_UP] = {BTN_PRESSED, EVENT_BUTTON_PRESS, BTN_TIMER_NONE}, // the release follows
+        [BTN_IN_TIMEOUT] = {BTN_PRESSED, EVENT_BUTTON_PRESS, BTN_TIMER_LONG},
+    },
+    [BTN_CHORD] = {
+        [BTN_IN_DOWN] = {BTN_CHORD, BTN_NO_EVENT, BTN_TIMER_KEEP},
+        [BTN_IN_UP] = {BTN_IDLE, BTN_NO_EVENT, BTN_TIMER_NONE},
+        [BTN_IN_TIMEOUT] = {BTN_CHORD, BTN_NO_EVENT, BTN_TIMER_NONE},
+    },
+};
+
+// BTN_IDLE + BTN_IN_DOWN of a BUTTON_F_CHORD button
+static const button_transition_t button_chord_wait = {BTN_WAIT, BTN_NO_EVENT, BTN_TIMER_CHORD};
+
+typedef struct {
+  int gpio;
+  uint8_t flags;         // BUTTON_F_*
+  button_state_t state;
+  bool level;            // debounced, true = pressed
+  uint16_t bounce_ms;    // how long the raw level differs from `level`
+  uint32_t down_ms;      // debounced press, the long press counts from here
+  uint32_t deadline_ms;  // state timer, 0 = not running
+} button_ctx_t;
+
+static button_ctx_t buttons[BUTTON__COUNT] = {
+    [BUTTON_START_STOP] = {.gpio = CONFIG_BUTTON_START_STOP_GPIO, .flags = BUTTON_F_LONG},
+    [BUTTON_MENU] = {.gpio = CONFIG_BUTTON_MENU_GPIO, .flags = BUTTON_F_LONG},
+    [BUTTON_LEFT] = {.gpio = CONFIG_BUTTON_LEFT_GPIO, .flags = BUTTON_F_LONG | BUTTON_F_REPEAT},
+    [BUTTON_RIGHT] = {.gpio = CONFIG_BUTTON_RIGHT_GPIO, .flags = BUTTON_F_LONG | BUTTON_F_REPEAT},
+    [BUTTON_UP] = {.gpio = CONFIG_BUTTON_UP_GPIO, .flags = BUTTON_F_LONG | BUTTON_F_REPEAT},
+    [BUTTON_DOWN] = {.gpio = CONFIG_BUTTON_DOWN_GPIO, .flags = BUTTON_F_LONG | BUTTON_F_REPEAT},
+    [BUTTON_CANCEL] = {.gpio = CONFIG_BUTTON_CANCEL_GPIO, .flags = BUTTON_F_LONG | BUTTON_F_CHORD},
+    [BUTTON_OK] = {.gpio = CONFIG_BUTTON_OK_GPIO, .flags = BUTTON_F_LONG | BUTTON_F_CHORD},
 };
 
 /* internal state */
-static QueueHandle_t gpio_evt_queue = NULL;
-static TickType_t last_isr_tick[BUTTON__COUNT];
+static esp_timer_handle_t scan_timer = NULL;
+static uint32_t scan_ms = 0;     // time base of the state timers
+static uint8_t held_mask = 0;    // debounced levels of all buttons
+static volatile uint8_t injected_mask = 0; // see input_inject.c
 static uint32_t cfg_longpress_ms = CONFIG_BUTTON_LONG_PRESS_MS;
 static uint32_t cfg_repeat_ms = CONFIG_BUTTON_REPEAT_DELAY_MS;
 
-/* forward declaration */
-static int gpio_to_button_idx(gpio_num_t gpio);
-
-/* ISR: minimal work, apply coarse debounce, push gpio number to queue */
-static void IRAM_ATTR gpio_isr_handler(void *arg)
+static void button_feed(uint8_t idx, button_input_t input)
 {
-  uint32_t gpio_num = (uint32_t)arg;
-  TickType_t now_tick = xTaskGetTickCountFromISR();
+  button_ctx_t *b = &buttons[idx];
+  const button_transition_t *t = &button_fsm[b->state][input];
+  button_state_t prev = b->state;
 
-  int idx = gpio_to_button_idx((gpio_num_t)gpio_num);
-  if (idx < 0)
-    return;
+  if (prev == BTN_IDLE && input == BTN_IN_DOWN) {
+    b->down_ms = scan_ms;
+    if ((b->flags & BUTTON_F_CHORD) && CONFIG_BUTTON_CHORD_WINDOW_MS > 0)
+      t = &button_chord_wait;
+  }
 
-  if ((now_tick - last_isr_tick[idx]) >= pdMS_TO_TICKS(CONFIG_BUTTON_ISR_DEBOUNCE_MS))
-  {
-    last_isr_tick[idx] = now_tick;
-    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-    if (gpio_evt_queue)
-    {
-      xQueueSendFromISR(gpio_evt_queue, &gpio_num, &xHigherPriorityTaskWoken);
-      if (xHigherPriorityTaskWoken)
-        portYIELD_FROM_ISR();
-    }
+  int32_t event = t->event;
+  if (event == EVENT_BUTTON_LONG_PRESS && !(b->flags & BUTTON_F_LONG))
+    event = BTN_NO_EVENT;
+
+  button_timer_t timer = t->timer;
+  if (timer == BTN_TIMER_REPEAT && !(b->flags & BUTTON_F_REPEAT))
+    timer = BTN_TIMER_NONE;
+
+  switch (timer) {
+  case BTN_TIMER_NONE:
+    b->deadline_ms = 0;
+    break;
+  case BTN_TIMER_LONG:
+    b->deadline_ms = b->down_ms + cfg_longpress_ms;
+    break;
+  case BTN_TIMER_REPEAT:
+    b->deadline_ms = scan_ms + cfg_repeat_ms;
+    break;
+  case BTN_TIMER_CHORD:
+    b->deadline_ms = scan_ms + CONFIG_BUTTON_CHORD_WINDOW_MS;
+    break;
+  case BTN_TIMER_KEEP:
+  default:
+    break;
   }
+  b->state = t->next;
+
+  if (event != BTN_NO_EVENT)
+    events_post(event, &idx, sizeof(idx));
+
+  // a tap shorter than the chord window: press and release together
+  if (prev == BTN_WAIT && input == BTN_IN_UP)
+    button_feed(idx, BTN_IN_UP);
 }
 
-/* Main button task:
- * - receives gpio numbers from ISR
- * - validates press (active-low check + settle delay)
- * - posts EVENT_BUTTON_PRESS for all buttons
- * - for UP/DOWN:
- *     wait longpress_ms; if still held -> post EVENT_BUTTON_LONG_PRESS
- *     then post EVENT_BUTTON_REPEAT every repeat_ms until release
- *     on release post EVENT_BUTTON_RELEASE
- */
-static void button_task(void *pv)
+/* Scan: debounce all levels, then advance the machines. Runs on the esp_timer task. */
+static void button_scan(void *arg)
 {
-  uint32_t io_num;
-  while (1) {
-    if (xQueueReceive(gpio_evt_queue, &io_num, portMAX_DELAY) == pdTRUE) {
-      int idx = gpio_to_button_idx((gpio_num_t)io_num);
-      if (idx < 0) continue;
-
-      // Small settle to filter bounce more thoroughly
-      vTaskDelay(pdMS_TO_TICKS(CONFIG_BUTTON_TASK_DEBOUNCE_MS));
-
-      // Confirm it's still a press (active-low)
-      int lvl = gpio_get_level((gpio_num_t)io_num);
-      if (lvl != 0) {
-        // spurious ISR or release -- ignore (we only handle press here)
-        continue;
-      }
+  scan_ms += CONFIG_BUTTON_SCAN_PERIOD_MS;
+  uint8_t prev_mask = held_mask;
 
-      // Post immediate press event (single-step)
-      uint8_t button_id = (uint8_t)idx;
-      events_post(EVENT_BUTTON_PRESS, &button_id, sizeof(button_id));
-
-      // Only UP/DOWN have longpress/repeat/release sequence
-      if (idx == BUTTON_UP || idx == BUTTON_DOWN) {
-        // wait for longpress timeout while polling for release
-        TickType_t start = xTaskGetTickCount();
-        TickType_t deadline = start + pdMS_TO_TICKS(cfg_longpress_ms);
-        bool still_pressed = true;
-        while (xTaskGetTickCount() < deadline) {
-          vTaskDelay(pdMS_TO_TICKS(20));
-          int lvl2 = gpio_get_level((gpio_num_t)io_num);
-          if (lvl2 != 0) { still_pressed = false; break; } // released before longpress
-        }
-
-        if (!still_pressed) {
-          // released before longpress -> nothing else to post here
-          continue;
-        }
-
-        // long press detected
-        events_post(EVENT_BUTTON_LONG_PRESS, &button_id, sizeof(button_id));
-
-        // begin repeating until release
-        while (1) {
-          vTaskDelay(pdMS_TO_TICKS(cfg_repeat_ms));
-          int lvl3 = gpio_get_level((gpio_num_t)io_num);
-          if (lvl3 != 0) {
-            // released -> break and post release event
-            events_post(EVENT_BUTTON_RELEASE, &button_id, sizeof(button_id));
-            break;
-          }
-          // still held -> send repeat
-          events_post(EVENT_BUTTON_REPEATED_PRESS, &button_id, sizeof(button_id));
-        }
+  for (uint8_t i = 0; i < BUTTON__COUNT; ++i) {
+    button_ctx_t *b = &buttons[i];
+    bool raw = (injected_mask & BUTTON_MASK(i)) != 0;
+    if (b->gpio >= 0)
+      raw |= gpio_get_level((gpio_num_t)b->gpio) == 0; // active-low
+    else if (!raw && b->level == raw && b->state == BTN_IDLE)
+      continue;
+
+    if (raw == b->level) {
+      b->bounce_ms = 0;
+    } else {
+      b->bounce_ms += CONFIG_BUTTON_SCAN_PERIOD_MS;
+      if (b->bounce_ms >= CONFIG_BUTTON_DEBOUNCE_MS) {
+        b->level = raw;
+        b->bounce_ms = 0;
+        if (raw)
+          held_mask |= BUTTON_MASK(i);
+        else
+          held_mask &= ~BUTTON_MASK(i);
+        button_feed(i, raw ? BTN_IN_DOWN : BTN_IN_UP);
       }
+    }
 
-      // For other buttons we don't track release/long/repeat
+    if (b->deadline_ms != 0 && (int32_t)(scan_ms - b->deadline_ms) >= 0)
+      button_feed(i, BTN_IN_TIMEOUT);
+  }
+
+  // a button joined others that are already held; presses still held back belong to the
+  // chord and are dropped
+  if ((held_mask & ~prev_mask) && (held_mask & (held_mask - 1))) {
+    for (uint8_t i = 0; i < BUTTON__COUNT; ++i) {
+      if (buttons[i].state == BTN_WAIT) {
+        buttons[i].state = BTN_CHORD;
+        buttons[i].deadline_ms = 0;
+      }
     }
+    events_post(EVENT_BUTTON_CHORD, &held_mask, sizeof(held_mask));
   }
 }
 
+void button_set_longpress_params(uint32_t longpress_ms, uint32_t repeat_ms)
+{
+  cfg_longpress_ms = longpress_ms;
+  cfg_repeat_ms = repeat_ms;
+}
+
+void button_set_flags(button_t btn, uint8_t flags)
+{
+  if (btn < BUTTON__COUNT)
+    buttons[btn].flags = flags;
+}
+
+uint8_t button_get_held_mask(void)
+{
+  return held_mask;
+}
+
+void button_inject(uint8_t mask)
+{
+  injected_mask = mask;
+}
+
 void button_init(void)
 {
     // prepare pin mask
   uint64_t pin_mask = 0;
   for (int i = 0; i < BUTTON__COUNT; ++i) {
-    if (button_gpio_values[i] >= 0) {
-      pin_mask |= (1ULL << button_gpio_values[i]);
+    if (buttons[i].gpio >= 0) {
+      pin_mask |= (1ULL << buttons[i].gpio);
     }
   }
   if (pin_mask == 0) {
@@ -138,7 +238,7 @@ void button_init(void)
   }
 
   gpio_config_t io_conf = {
-      .intr_type = GPIO_INTR_NEGEDGE, // detect press (active-low falling edge)
+      .intr_type = GPIO_INTR_DISABLE, // sampled by the scan timer
       .mode = GPIO_MODE_INPUT,
       .pin_bit_mask = pin_mask,
       .pull_up_en = GPIO_PULLUP_ENABLE,
@@ -146,31 +246,13 @@ void button_init(void)
   };
   gpio_config(&io_conf);
 
-  // Create the event queue
-  gpio_evt_queue = xQueueCreate(GPIO_EVT_QUEUE_SIZE, sizeof(uint32_t));
-
-  // initialize last_isr_tick
-  for (int i = 0; i < BUTTON__COUNT; ++i) last_isr_tick[i] = 0;
-
-  // install ISR service and add handlers only for configured pins
-  gpio_install_isr_service(ESP_INTR_FLAG_LEVEL3);
-  for (int i = 0; i < BUTTON__COUNT; ++i) {
-    if (button_gpio_values[i] >= 0) {
-      gpio_isr_handler_add((gpio_num_t)button_gpio_values[i], gpio_isr_handler, (void *)button_gpio_values[i]);
-    }
-  }
-
-  // Create the button task
-  xTaskCreatePinnedToCore(button_task, "button_task", 4096, NULL, 10, NULL, 1);
+  const esp_timer_create_args_t scan_timer_args = {
+      .callback = button_scan,
+      .dispatch_method = ESP_TIMER_TASK,
+      .name = "button_scan",
+  };
+  ESP_ERROR_CHECK(esp_timer_create(&scan_timer_args, &scan_timer));
+  ESP_ERROR_CHECK(esp_timer_start_periodic(scan_timer, CONFIG_BUTTON_SCAN_PERIOD_MS * 1000));
 
-  ESP_LOGI(TAG, "Button handler initialized for 8 buttons");
+  ESP_LOGI(TAG, "Button scan started for %d buttons, every %d ms", BUTTON__COUNT, CONFIG_BUTTON_SCAN_PERIOD_MS);
 }
-
-/* helper: find button index by gpio number, or -1 if not found */
-static int gpio_to_button_idx(gpio_num_t gpio)
-{
-  for (int i = 0; i < BUTTON__COUNT; ++i) {
-    if (button_gpio_values[i] >= 0 && (gpio_num_t)button_gpio_values[i] == gpio) return i;
-  }
-  return -1;
-}
\ No newline at end of file
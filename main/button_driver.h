@@ -15,14 +15,29 @@ typedef enum {
   BUTTON__COUNT,
 } button_t;
 
+#define BUTTON_MASK(btn) (1U << (btn))
+
+/* per button behaviour flags */
+#define BUTTON_F_LONG (1 << 0)   // post EVENT_BUTTON_LONG_PRESS when held
+#define BUTTON_F_REPEAT (1 << 1) // post EVENT_BUTTON_REPEATED_PRESS while held
+#define BUTTON_F_CHORD (1 << 2)  // hold the press back for the chord window
 
 void button_init(void);
 
 /**
- * Configure longpress/repeat behaviour (applies only to UP/DOWN).
- * longpress_ms: time required to trigger long press (default 1500)
- * repeat_ms: interval between repeat events while held (default 200)
+ * Configure longpress/repeat timing (all buttons).
+ * longpress_ms: time required to trigger long press (default CONFIG_BUTTON_LONG_PRESS_MS)
+ * repeat_ms: interval between repeat events while held (default CONFIG_BUTTON_REPEAT_DELAY_MS)
  */
 void button_set_longpress_params(uint32_t longpress_ms, uint32_t repeat_ms);
 
-#endif
\ No newline at end of file
+/* Change the BUTTON_F_* flags of a button */
+void button_set_flags(button_t btn, uint8_t flags);
+
+/* Buttons currently held (debounced), BUTTON_MASK bits */
+uint8_t button_get_held_mask(void);
+
+/* Levels pressed in software (BUTTON_MASK bits), merged with the GPIOs on the next scan */
+void button_inject(uint8_t mask);
+
+#endif
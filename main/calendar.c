@@ -0,0 +1,125 @@
+#include <stdbool.h>
+#include "calendar.h"
+
+#define SECONDS_PER_DAY 86400
+
+// Floor division for negative values
+static int32_t floor_div(int32_t a, int32_t b)
+{
+  return a / b - (a % b != 0 && (a < 0) != (b < 0));
+}
+
+static bool is_leap(int32_t year)
+{
+  return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+uint8_t calendar_days_in_month(int32_t year, uint8_t month)
+{
+  static const uint8_t DAYS[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+  if (month == 2 && is_leap(year))
+    return 29;
+  return DAYS[(month - 1) % 12];
+}
+
+// Howard Hinnant's days_from_civil: eras of 400 years, March based years so the leap day is last
+int32_t calendar_days_from_civil(int32_t year, int32_t month, int32_t day)
+{
+  year += floor_div(month - 1, 12);
+  month = month - 1 - floor_div(month - 1, 12) * 12 + 1;
+
+  year -= month <= 2;
+  int32_t era = floor_div(year, 400);
+  int32_t yoe = year - era * 400;                                        // 0..399
+  int32_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1; // 0..365
+  int32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;                   // 0..146096
+  return era * 146097 + doe - 719468;
+}
+
+void calendar_from_ts(uint32_t ts, calendar_t *out)
+{
+  int32_t days = ts / SECONDS_PER_DAY;
+  uint32_t secs = ts % SECONDS_PER_DAY;
+  out->hour = secs / 3600;
+  out->minute = secs / 60 % 60;
+  out->second = secs % 60;
+  out->wday = (days + 4) % 7; // 1970-01-01 was a Thursday
+
+  // civil_from_days, inverse of the above
+  int32_t z = days + 719468;
+  int32_t era = z / 146097; // ts is unsigned, z stays positive
+  int32_t doe = z - era * 146097;
+  int32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  int32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  int32_t mp = (5 * doy + 2) / 153;
+  out->day = doy - (153 * mp + 2) / 5 + 1;
+  out->month = mp < 10 ? mp + 3 : mp - 9;
+  out->year = yoe + era * 400 + (out->month <= 2);
+  out->yday = days - calendar_days_from_civil(out->year, 1, 1);
+}
+
+uint32_t calendar_to_ts(int32_t year, int32_t month, int32_t day, int32_t hour, int32_t minute, int32_t second)
+{
+  int64_t ts = (int64_t)calendar_days_from_civil(year, month, day) * SECONDS_PER_DAY +
+               (int64_t)hour * 3600 + (int64_t)minute * 60 + second;
+  if (ts < 0)
+    return 0;
+  if (ts > UINT32_MAX)
+    return UINT32_MAX;
+  return (uint32_t)ts;
+}
+
+uint32_t calendar_adjust(uint32_t ts, calendar_field_t field, int32_t delta)
+{
+  calendar_t c;
+  calendar_from_ts(ts, &c);
+  int32_t year = c.year;
+  int32_t month = c.month;
+
+  switch (field)
+  {
+  case CAL_YEAR:
+    year += delta;
+    break;
+  case CAL_MONTH:
+    month += delta;
+    year += floor_div(month - 1, 12);
+    month -= floor_div(month - 1, 12) * 12;
+    break;
+  case CAL_DAY:
+    return calendar_to_ts(year, month, c.day + delta, c.hour, c.minute, c.second);
+  case CAL_HOUR:
+    return calendar_to_ts(year, month, c.day, c.hour + delta, c.minute, c.second);
+  case CAL_MINUTE:
+    return calendar_to_ts(year, month, c.day, c.hour, c.minute + delta, c.second);
+  case CAL_SECOND:
+  default:
+    return calendar_to_ts(year, month, c.day, c.hour, c.minute, c.second + delta);
+  }
+
+  // calendar_to_ts() saturates within the last year too (2106 ends in February)
+  if (year < CALENDAR_YEAR_MIN)
+    return 0;
+  if (year > CALENDAR_YEAR_MAX)
+    return UINT32_MAX;
+
+  uint8_t last = calendar_days_in_month(year, month);
+  return calendar_to_ts(year, month, c.day > last ? last : c.day, c.hour, c.minute, c.second);
+}
+
+int32_t calendar_repeat_step(calendar_field_t field, uint16_t repeats)
+{
+  // steps after 0 / 10 / 25 repeats
+  static const uint8_t STEPS[CAL__COUNT][3] = {
+      [CAL_YEAR] = {1, 5, 10},
+      [CAL_MONTH] = {1, 3, 6},
+      [CAL_DAY] = {1, 7, 7},
+      [CAL_HOUR] = {1, 3, 6},
+      [CAL_MINUTE] = {1, 5, 15},
+      [CAL_SECOND] = {1, 5, 15},
+  };
+  if (field >= CAL__COUNT)
+    return 1;
+  uint8_t tier = repeats >= 25 ? 2 : repeats >= 10 ? 1 : 0;
+  return STEPS[field][tier];
+}
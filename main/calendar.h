@@ -0,0 +1,56 @@
+#ifndef CALENDAR_H
+#define CALENDAR_H
+
+#include <stdint.h>
+
+/*
+ * Proleptic Gregorian calendar arithmetic on 32-bit unix timestamps (UTC).
+ * Plain C without libc time functions, no TZ lookups, safe from any task.
+ */
+
+#define CALENDAR_YEAR_MIN 1970
+#define CALENDAR_YEAR_MAX 2106 // UINT32_MAX is 2106-02-07 06:28:15
+
+typedef enum {
+  CAL_YEAR = 0, // order of the datetime editor cursor
+  CAL_MONTH,
+  CAL_DAY,
+  CAL_HOUR,
+  CAL_MINUTE,
+  CAL_SECOND,
+  CAL__COUNT
+} calendar_field_t;
+
+typedef struct {
+  int16_t year;  // e.g. 2025
+  uint8_t month; // 1..12
+  uint8_t day;   // 1..31
+  uint8_t hour;
+  uint8_t minute;
+  uint8_t second;
+  uint8_t wday;  // 0 = Sunday
+  uint16_t yday; // 0..365
+} calendar_t;
+
+void calendar_from_ts(uint32_t ts, calendar_t *out);
+
+// Fields out of range carry over (month 13 is January of the next year, day 0 the
+// last day of the previous month); the result is clamped to the timestamp range
+uint32_t calendar_to_ts(int32_t year, int32_t month, int32_t day, int32_t hour, int32_t minute, int32_t second);
+
+// Days since 1970-01-01 of a date, month may be out of 1..12
+int32_t calendar_days_from_civil(int32_t year, int32_t month, int32_t day);
+
+uint8_t calendar_days_in_month(int32_t year, uint8_t month);
+
+// Move one field by delta. Year and month keep the day, clamped to the length of the
+// target month (Jan 31 + 1 month = Feb 28/29); the other fields carry into the next one.
+// Past either end of the timestamp range the result stops at that end, so it never moves
+// against the sign of delta.
+uint32_t calendar_adjust(uint32_t ts, calendar_field_t field, int32_t delta);
+
+// Units per repeat of a held key: grows with the number of repeats, in steps that
+// fit the field (5/15 minutes, 6 hours, a week, a quarter...)
+int32_t calendar_repeat_step(calendar_field_t field, uint16_t repeats);
+
+#endif
@@ -0,0 +1,69 @@
+#include <stdlib.h>
+#include "encoder_accel.h"
+
+/* rate thresholds (detents/s) and their step multipliers */
+static const struct {
+  uint16_t rate;
+  uint8_t factor;
+} accel_table[] = {
+    {40, 10},
+    {20, 5},
+    {10, 2},
+};
+
+void encoder_accel_reset(encoder_accel_t *enc)
+{
+  enc->remainder = 0;
+  enc->last_ms = 0;
+  enc->rate = 0;
+  enc->dir = 0;
+}
+
+int32_t encoder_decode(encoder_accel_t *enc, int32_t count_delta, uint8_t counts_per_detent)
+{
+  if (counts_per_detent == 0)
+    counts_per_detent = 1;
+
+  enc->remainder += count_delta;
+  int32_t detents = enc->remainder / counts_per_detent; // truncates toward zero for both directions
+  enc->remainder -= detents * counts_per_detent;
+  return detents;
+}
+
+uint8_t encoder_accel_factor(uint16_t rate)
+{
+  for (size_t i = 0; i < sizeof(accel_table) / sizeof(accel_table[0]); i++)
+  {
+    if (rate >= accel_table[i].rate)
+      return accel_table[i].factor;
+  }
+  return 1;
+}
+
+int32_t encoder_accelerate(encoder_accel_t *enc, int32_t detents, uint32_t now_ms)
+{
+  if (detents == 0)
+    return 0;
+
+  int8_t dir = detents > 0 ? 1 : -1;
+  uint32_t dt = now_ms - enc->last_ms;
+
+  if (dir != enc->dir || enc->last_ms == 0 || dt >= ENCODER_ACCEL_IDLE_MS)
+  {
+    // new gesture or correction in the other direction: precise steps
+    enc->rate = 0;
+  }
+  else
+  {
+    if (dt == 0)
+      dt = 1;
+    uint32_t rate = (uint32_t)abs(detents) * 1000 / dt;
+    if (rate > UINT16_MAX)
+      rate = UINT16_MAX;
+    enc->rate = (uint16_t)((enc->rate * 3 + rate) / 4); // smooth out uneven turning
+  }
+
+  enc->dir = dir;
+  enc->last_ms = now_ms;
+  return detents * encoder_accel_factor(enc->rate);
+}
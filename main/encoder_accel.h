@@ -0,0 +1,31 @@
+#ifndef ENCODER_ACCEL_H
+#define ENCODER_ACCEL_H
+
+#include <stdint.h>
+
+/*
+ * Quadrature count to detent decoding and velocity based acceleration.
+ * Plain C without IDF dependencies, driven by encoder_driver.c.
+ */
+
+#define ENCODER_ACCEL_IDLE_MS 300 // a pause this long restarts at single steps
+
+typedef struct {
+    int32_t remainder;      // counts not yet making a full detent
+    uint32_t last_ms;       // time of the previous detent
+    uint16_t rate;          // smoothed detents per second
+    int8_t dir;             // direction of the previous detent
+} encoder_accel_t;
+
+void encoder_accel_reset(encoder_accel_t *enc);
+
+// Turn a raw count delta into whole detents, keeping the rest for the next call
+int32_t encoder_decode(encoder_accel_t *enc, int32_t count_delta, uint8_t counts_per_detent);
+
+// Scale detents by the rotation speed; reversing or pausing falls back to single steps
+int32_t encoder_accelerate(encoder_accel_t *enc, int32_t detents, uint32_t now_ms);
+
+// Multiplier for a rate in detents per second
+uint8_t encoder_accel_factor(uint16_t rate);
+
+#endif
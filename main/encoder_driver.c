@@ -0,0 +1,103 @@
+#include "encoder_driver.h"
+#include "encoder_accel.h"
+#include "event_handler.h"
+#include "driver/pulse_cnt.h"
+#include "driver/gpio.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char *TAG = "encoder";
+
+#if CONFIG_ENCODER_ENABLE
+static pcnt_unit_handle_t pcnt_unit = NULL;
+static esp_timer_handle_t poll_timer = NULL;
+static encoder_accel_t accel;
+static int last_count = 0;
+
+/* The counter runs in hardware, this only picks up the difference */
+static void encoder_poll(void *arg)
+{
+  int count = 0;
+  if (pcnt_unit_get_count(pcnt_unit, &count) != ESP_OK)
+    return;
+
+  int32_t delta = count - last_count;
+  last_count = count;
+  if (delta == 0)
+    return;
+
+  int32_t detents = encoder_decode(&accel, delta, CONFIG_ENCODER_COUNTS_PER_DETENT);
+  if (detents == 0)
+    return;
+
+  encoder_event_t evt = {
+      .detents = (int16_t)detents,
+      .steps = (int16_t)encoder_accelerate(&accel, detents, (uint32_t)(esp_timer_get_time() / 1000)),
+  };
+  events_post(EVENT_ENCODER_ROTATE, &evt, sizeof(evt));
+}
+
+void encoder_init(void)
+{
+  pcnt_unit_config_t unit_config = {
+      .high_limit = ENCODER_PCNT_LIMIT,
+      .low_limit = -ENCODER_PCNT_LIMIT,
+      .flags.accum_count = true, // keep counting across the limits
+  };
+  ESP_ERROR_CHECK(pcnt_new_unit(&unit_config, &pcnt_unit));
+
+  pcnt_glitch_filter_config_t filter_config = {
+      .max_glitch_ns = 1000,
+  };
+  ESP_ERROR_CHECK(pcnt_unit_set_glitch_filter(pcnt_unit, &filter_config));
+
+  // x4 decoding: both edges of both phases, direction from the level of the other phase
+  pcnt_chan_config_t chan_a_config = {
+      .edge_gpio_num = CONFIG_ENCODER_A_GPIO,
+      .level_gpio_num = CONFIG_ENCODER_B_GPIO,
+  };
+  pcnt_channel_handle_t chan_a = NULL;
+  ESP_ERROR_CHECK(pcnt_new_channel(pcnt_unit, &chan_a_config, &chan_a));
+  pcnt_chan_config_t chan_b_config = {
+      .edge_gpio_num = CONFIG_ENCODER_B_GPIO,
+      .level_gpio_num = CONFIG_ENCODER_A_GPIO,
+  };
+  pcnt_channel_handle_t chan_b = NULL;
+  ESP_ERROR_CHECK(pcnt_new_channel(pcnt_unit, &chan_b_config, &chan_b));
+
+  ESP_ERROR_CHECK(pcnt_channel_set_edge_action(chan_a, PCNT_CHANNEL_EDGE_ACTION_DECREASE, PCNT_CHANNEL_EDGE_ACTION_INCREASE));
+  ESP_ERROR_CHECK(pcnt_channel_set_level_action(chan_a, PCNT_CHANNEL_LEVEL_ACTION_KEEP, PCNT_CHANNEL_LEVEL_ACTION_INVERSE));
+  ESP_ERROR_CHECK(pcnt_channel_set_edge_action(chan_b, PCNT_CHANNEL_EDGE_ACTION_INCREASE, PCNT_CHANNEL_EDGE_ACTION_DECREASE));
+  ESP_ERROR_CHECK(pcnt_channel_set_level_action(chan_b, PCNT_CHANNEL_LEVEL_ACTION_KEEP, PCNT_CHANNEL_LEVEL_ACTION_INVERSE));
+
+  // with accum_count the driver adds up the overflows at the watch points
+  ESP_ERROR_CHECK(pcnt_unit_add_watch_point(pcnt_unit, ENCODER_PCNT_LIMIT));
+  ESP_ERROR_CHECK(pcnt_unit_add_watch_point(pcnt_unit, -ENCODER_PCNT_LIMIT));
+
+  // mechanical encoders switch to ground
+  gpio_pullup_en(CONFIG_ENCODER_A_GPIO);
+  gpio_pullup_en(CONFIG_ENCODER_B_GPIO);
+
+  ESP_ERROR_CHECK(pcnt_unit_enable(pcnt_unit));
+  ESP_ERROR_CHECK(pcnt_unit_clear_count(pcnt_unit));
+  ESP_ERROR_CHECK(pcnt_unit_start(pcnt_unit));
+
+  encoder_accel_reset(&accel);
+
+  const esp_timer_create_args_t poll_timer_args = {
+      .callback = encoder_poll,
+      .dispatch_method = ESP_TIMER_TASK,
+      .name = "encoder_poll",
+  };
+  ESP_ERROR_CHECK(esp_timer_create(&poll_timer_args, &poll_timer));
+  ESP_ERROR_CHECK(esp_timer_start_periodic(poll_timer, CONFIG_ENCODER_POLL_MS * 1000));
+
+  ESP_LOGI(TAG, "Encoder on GPIO %d/%d, %d counts per detent", CONFIG_ENCODER_A_GPIO, CONFIG_ENCODER_B_GPIO,
+           CONFIG_ENCODER_COUNTS_PER_DETENT);
+}
+#else
+void encoder_init(void)
+{
+  ESP_LOGD(TAG, "Encoder disabled");
+}
+#endif
@@ -0,0 +1,16 @@
+#ifndef ENCODER_DRIVER_H
+#define ENCODER_DRIVER_H
+
+#include <stdint.h>
+
+#define ENCODER_PCNT_LIMIT 10000 // counter range, the driver accumulates beyond it
+
+/* data of EVENT_ENCODER_ROTATE */
+typedef struct {
+  int16_t detents; // clicks turned, positive = clockwise
+  int16_t steps;   // detents scaled by the rotation speed
+} encoder_event_t;
+
+void encoder_init(void);
+
+#endif
@@ -12,10 +12,15 @@ enum
 {
   EVENT_MODEL_TICK,            // Event for model tick
   EVENT_MODEL_MINUTE_TICK,     // Event for model tick
+  EVENT_MODEL_TIME_SET,        // Event for a jump of the model time (edit, restore)
+  EVENT_HANDS_SET,             // Event for a correction of the slave clock hand positions
   EVENT_BUTTON_PRESS,          // Event for button press
   EVENT_BUTTON_LONG_PRESS,     // Event for button long press
   EVENT_BUTTON_REPEATED_PRESS, // Event for button repeated press
   EVENT_BUTTON_RELEASE,        // Event for button release
+  EVENT_BUTTON_CHORD,          // Event for several buttons held together (data: uint8_t mask)
+  EVENT_ENCODER_ROTATE,        // Event for encoder rotation (data: encoder_event_t)
+  EVENT_INPUT_CHANGE,          // Event for a debounced expander input change (data: input_change_t)
   EVENT_RESTART_REQUESTED,     // Event for restart requested
   EVENT_TIMER_RESUME,          // Event for timer resume
   EVENT_TIMER_PAUSE,           // Event for timer pause
@@ -0,0 +1,424 @@
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+#include "history.h"
+#include "journal.h"
+#include "event_handler.h"
+#include "timer.h"
+#include "output_driver.h"
+#include "esp_partition.h"
+#include "esp_system.h"
+#include "esp_console.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+static const char *TAG = "history";
+
+#if CONFIG_HISTORY_ENABLE
+
+#define HISTORY_BUFFER_ENTRIES 64
+#define HISTORY_FLUSH_LEVEL 48   // wake the task before the buffer runs full
+#define HISTORY_CHUNK_ENTRIES 16 // entries per flash read when scanning
+
+_Static_assert(sizeof(history_entry_t) == 16, "history entry layout");
+_Static_assert(sizeof(history_sector_t) == 16, "history sector header layout");
+
+static const esp_partition_t *part = NULL;
+static uint32_t sectors = 0;
+static uint32_t cur_sector = 0;
+static uint32_t cur_off = 0; // of the next entry in cur_sector, 0 before the first sector
+static uint32_t cur_seq = 0;
+static SemaphoreHandle_t flash_mutex = NULL;
+static TaskHandle_t history_task_handle = NULL;
+
+static history_entry_t buffer[HISTORY_BUFFER_ENTRIES];
+static uint32_t buffer_count = 0;
+static uint32_t buffer_lost = 0; // since the last overflow entry
+static portMUX_TYPE buffer_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// one flush: the buffer, the pulse counts and an overflow entry
+static history_entry_t batch[HISTORY_BUFFER_ENTRIES + 2 * OUTPUT_CLOCK_CHANNELS + 1];
+
+static uint32_t pulses_sent[OUTPUT_CLOCK_CHANNELS];
+static uint32_t pulses_missed[OUTPUT_CLOCK_CHANNELS];
+static uint32_t last_model_ts = 0;
+
+static history_stats_t stats;
+
+static history_entry_t make_entry(uint8_t type, uint8_t arg, uint32_t value)
+{
+  history_entry_t e = {
+      .real_ts = (uint32_t)time(NULL),
+      .model_ts = unix_ts,
+      .value = value,
+      .type = type,
+      .arg = arg,
+  };
+  e.check = (uint16_t)journal_crc32(0, &e, offsetof(history_entry_t, check));
+  return e;
+}
+
+static bool entry_blank(const history_entry_t *e)
+{
+  const uint8_t *p = (const uint8_t *)e;
+  for (int i = 0; i < sizeof(*e); i++)
+  {
+    if (p[i] != 0xFF)
+      return false;
+  }
+  return true;
+}
+
+// Never blocks: the entry goes to the RAM buffer, the task writes it out later
+static void history_log(uint8_t type, uint8_t arg, uint32_t value)
+{
+  history_entry_t e = make_entry(type, arg, value);
+  portENTER_CRITICAL(&buffer_lock);
+  if (buffer_count < HISTORY_BUFFER_ENTRIES)
+  {
+    buffer[buffer_count++] = e;
+    stats.logged++;
+  }
+  else
+  {
+    buffer_lost++;
+    stats.dropped++;
+  }
+  bool wake = buffer_count == HISTORY_FLUSH_LEVEL;
+  portEXIT_CRITICAL(&buffer_lock);
+  if (wake && history_task_handle)
+    xTaskNotifyGive(history_task_handle);
+}
+
+void history_count_pulse(uint8_t channel, bool sent)
+{
+  if (channel >= OUTPUT_CLOCK_CHANNELS)
+    return;
+  __atomic_fetch_add(sent ? &pulses_sent[channel] : &pulses_missed[channel], 1, __ATOMIC_RELAXED);
+}
+
+static bool read_header(uint32_t sector, history_sector_t *h)
+{
+  if (esp_partition_read(part, sector * part->erase_size, h, sizeof(*h)) != ESP_OK)
+    return false;
+  return h->magic == HISTORY_MAGIC && h->version == HISTORY_VERSION && h->entry_size == sizeof(history_entry_t);
+}
+
+// Erase the next sector of the ring and make it the one written to
+static bool start_sector(void)
+{
+  uint32_t next = (cur_sector + 1) % sectors;
+  if (esp_partition_erase_range(part, next * part->erase_size, part->erase_size) != ESP_OK)
+    return false;
+  history_sector_t h = {
+      .magic = HISTORY_MAGIC,
+      .version = HISTORY_VERSION,
+      .entry_size = sizeof(history_entry_t),
+      .seq = cur_seq + 1,
+  };
+  if (esp_partition_write(part, next * part->erase_size, &h, sizeof(h)) != ESP_OK)
+    return false;
+  cur_sector = next;
+  cur_seq = h.seq;
+  cur_off = sizeof(h);
+  return true;
+}
+
+static bool write_entries(const history_entry_t *e, uint32_t n)
+{
+  while (n > 0)
+  {
+    if (cur_off == 0 || cur_off + sizeof(*e) > part->erase_size)
+    {
+      if (!start_sector())
+        return false;
+    }
+    uint32_t room = (part->erase_size - cur_off) / sizeof(*e);
+    uint32_t k = n < room ? n : room;
+    if (esp_partition_write(part, cur_sector * part->erase_size + cur_off, e, k * sizeof(*e)) != ESP_OK)
+      return false;
+    cur_off += k * sizeof(*e);
+    e += k;
+    n -= k;
+  }
+  return true;
+}
+
+// The newest sector is the one to continue, behind its last entry
+static void history_mount(void)
+{
+  bool found = false;
+  for (uint32_t s = 0; s < sectors; s++)
+  {
+    history_sector_t h;
+    if (!read_header(s, &h))
+      continue;
+    if (found && (int32_t)(h.seq - cur_seq) <= 0)
+      continue;
+    found = true;
+    cur_sector = s;
+    cur_seq = h.seq;
+  }
+  if (!found)
+  {
+    cur_sector = sectors - 1; // the first flush starts at sector 0
+    cur_off = 0;
+    return;
+  }
+
+  history_entry_t chunk[HISTORY_CHUNK_ENTRIES];
+  cur_off = sizeof(history_sector_t);
+  while (cur_off + sizeof(history_entry_t) <= part->erase_size)
+  {
+    uint32_t n = (part->erase_size - cur_off) / sizeof(history_entry_t);
+    if (n > HISTORY_CHUNK_ENTRIES)
+      n = HISTORY_CHUNK_ENTRIES;
+    if (esp_partition_read(part, cur_sector * part->erase_size + cur_off, chunk, n * sizeof(history_entry_t)) != ESP_OK)
+      return;
+    for (uint32_t i = 0; i < n; i++)
+    {
+      if (entry_blank(&chunk[i]))
+        return;
+      cur_off += sizeof(history_entry_t); // torn entries are skipped, never written over
+    }
+  }
+}
+
+static void history_flush(void)
+{
+  portENTER_CRITICAL(&buffer_lock);
+  uint32_t n = buffer_count;
+  memcpy(batch, buffer, n * sizeof(history_entry_t));
+  buffer_count = 0;
+  uint32_t lost = buffer_lost;
+  buffer_lost = 0;
+  portEXIT_CRITICAL(&buffer_lock);
+
+  uint32_t counted = 0;
+  for (uint8_t ch = 0; ch < OUTPUT_CLOCK_CHANNELS; ch++)
+  {
+    uint32_t sent = __atomic_exchange_n(&pulses_sent[ch], 0, __ATOMIC_RELAXED);
+    uint32_t missed = __atomic_exchange_n(&pulses_missed[ch], 0, __ATOMIC_RELAXED);
+    if (sent)
+      batch[n + counted++] = make_entry(HISTORY_PULSES, ch, sent);
+    if (missed)
+      batch[n + counted++] = make_entry(HISTORY_PULSES_MISSED, ch, missed);
+  }
+  n += counted;
+  if (lost)
+    batch[n++] = make_entry(HISTORY_OVERFLOW, 0, lost);
+  if (n == 0)
+    return;
+
+  xSemaphoreTake(flash_mutex, portMAX_DELAY);
+  bool ok = write_entries(batch, n);
+  xSemaphoreGive(flash_mutex);
+  if (!ok)
+    ESP_LOGW(TAG, "Writing %lu entries to sector %lu failed", n, cur_sector);
+
+  portENTER_CRITICAL(&buffer_lock);
+  stats.logged += counted + (lost ? 1 : 0);
+  if (ok)
+  {
+    stats.written += n;
+    stats.flushes++;
+  }
+  portEXIT_CRITICAL(&buffer_lock);
+}
+
+// Batches by time, or earlier when the buffer fills up; flash waits never reach the tick path
+static void history_task(void *arg)
+{
+  while (1)
+  {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CONFIG_HISTORY_FLUSH_S * 1000));
+    history_flush();
+  }
+}
+
+static void history_event_handler(void *handler_arg, esp_event_base_t base, int32_t id, void *event_data)
+{
+  switch (id)
+  {
+  case EVENT_MODEL_TICK:
+    last_model_ts = *(uint32_t *)event_data;
+    break;
+  case EVENT_TIMER_STATE_CHANGE:
+    history_log(timer_is_running() ? HISTORY_RUN : HISTORY_PAUSE, 0, 0);
+    break;
+  case EVENT_TIMER_SCALE:
+    history_log(HISTORY_SCALE, 0, *(uint32_t *)event_data);
+    break;
+  case EVENT_MODEL_TIME_SET:
+    history_log(HISTORY_TIME_SET, 0, last_model_ts);
+    last_model_ts = unix_ts;
+    break;
+  default:
+    break;
+  }
+}
+
+void history_init(void)
+{
+  part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "history");
+  if (!part)
+  {
+    ESP_LOGW(TAG, "No history partition");
+    return;
+  }
+  sectors = part->size / part->erase_size;
+  flash_mutex = xSemaphoreCreateMutex();
+  history_mount();
+
+  last_model_ts = unix_ts;
+  history_log(HISTORY_BOOT, 0, esp_reset_reason());
+  // the state the restore left: a warm resume has posted its state change before we subscribe
+  history_log(timer_is_running() ? HISTORY_RUN : HISTORY_PAUSE, 0, 0);
+  history_log(HISTORY_SCALE, 0, timer_get_timescale());
+  events_subscribe(EVENT_MODEL_TICK, history_event_handler, NULL);
+  events_subscribe(EVENT_TIMER_STATE_CHANGE, history_event_handler, NULL);
+  events_subscribe(EVENT_TIMER_SCALE, history_event_handler, NULL);
+  events_subscribe(EVENT_MODEL_TIME_SET, history_event_handler, NULL);
+  xTaskCreatePinnedToCore(history_task, "history", 3072, NULL, 1, &history_task_handle, 0);
+
+  ESP_LOGI(TAG, "%lu sectors, continuing sector %lu (seq %lu) at %lu", sectors, cur_sector, cur_seq, cur_off);
+}
+
+void history_get_stats(history_stats_t *out)
+{
+  portENTER_CRITICAL(&buffer_lock);
+  *out = stats;
+  out->pending = buffer_count;
+  portEXIT_CRITICAL(&buffer_lock);
+  out->seq = cur_seq;
+  out->sector = cur_sector;
+  out->sectors = sectors;
+}
+
+static void print_entry(const history_entry_t *e)
+{
+  static const char hex[] = "0123456789abcdef";
+  char line[2 + 2 * sizeof(*e) + 1];
+  const uint8_t *p = (const uint8_t *)e;
+  line[0] = 'H';
+  line[1] = ' ';
+  for (int i = 0; i < sizeof(*e); i++)
+  {
+    line[2 + 2 * i] = hex[p[i] >> 4];
+    line[3 + 2 * i] = hex[p[i] & 15];
+  }
+  line[sizeof(line) - 1] = '\0';
+  printf("%s\n", line);
+}
+
+/* Oldest sector first, one hex line per entry as stored, then what still waits in RAM.
+ * The flash is read in chunks, so the writer is held up for one read at most. */
+static uint32_t history_export(void)
+{
+  uint32_t count = 0;
+  history_entry_t chunk[HISTORY_CHUNK_ENTRIES];
+  for (uint32_t i = 1; i <= sectors; i++)
+  {
+    uint32_t s = (cur_sector + i) % sectors;
+    history_sector_t h;
+    xSemaphoreTake(flash_mutex, portMAX_DELAY);
+    bool valid = read_header(s, &h);
+    xSemaphoreGive(flash_mutex);
+    if (!valid)
+      continue;
+
+    bool end = false;
+    for (uint32_t off = sizeof(h); !end && off + sizeof(history_entry_t) <= part->erase_size;)
+    {
+      uint32_t n = (part->erase_size - off) / sizeof(history_entry_t);
+      if (n > HISTORY_CHUNK_ENTRIES)
+        n = HISTORY_CHUNK_ENTRIES;
+      xSemaphoreTake(flash_mutex, portMAX_DELAY);
+      esp_err_t err = esp_partition_read(part, s * part->erase_size + off, chunk, n * sizeof(history_entry_t));
+      xSemaphoreGive(flash_mutex);
+      if (err != ESP_OK)
+        break;
+      for (uint32_t k = 0; k < n && !end; k++)
+      {
+        end = entry_blank(&chunk[k]);
+        if (!end)
+        {
+          print_entry(&chunk[k]);
+          count++;
+        }
+      }
+      off += n * sizeof(history_entry_t);
+    }
+  }
+
+  for (uint32_t k = 0;; k++)
+  {
+    portENTER_CRITICAL(&buffer_lock);
+    bool more = k < buffer_count;
+    if (more)
+      chunk[0] = buffer[k];
+    portEXIT_CRITICAL(&buffer_lock);
+    if (!more)
+      break;
+    print_entry(&chunk[0]);
+    count++;
+  }
+  return count;
+}
+
+static int cmd_history(int argc, char **argv)
+{
+  if (!part)
+  {
+    printf("no history partition\n");
+    return 1;
+  }
+  if (argc == 2 && strcmp(argv[1], "export") == 0)
+  {
+    printf("history begin\n");
+    uint32_t count = history_export();
+    printf("history end %lu\n", count);
+    return 0;
+  }
+
+  history_stats_t s;
+  history_get_stats(&s);
+  printf("sector %lu of %lu, seq %lu (each sector erased about %lu times)\n", s.sector, s.sectors, s.seq,
+         s.sectors ? s.seq / s.sectors : 0);
+  printf("logged %lu, written %lu in %lu flushes, pending %lu, dropped %lu\n", s.logged, s.written, s.flushes,
+         s.pending, s.dropped);
+  return 0;
+}
+
+void history_register_commands(void)
+{
+  const esp_console_cmd_t history_cmd = {
+      .command = "history",
+      .help = "Session history log; 'history export' streams it for tools/history_decode.py",
+      .hint = "[export]",
+      .func = cmd_history,
+  };
+  ESP_ERROR_CHECK(esp_console_cmd_register(&history_cmd));
+}
+#else
+void history_init(void)
+{
+  ESP_LOGD(TAG, "History log disabled");
+}
+
+void history_count_pulse(uint8_t channel, bool sent)
+{
+}
+
+void history_get_stats(history_stats_t *out)
+{
+  memset(out, 0, sizeof(*out));
+}
+
+void history_register_commands(void)
+{
+}
+#endif
@@ -0,0 +1,66 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Flash layout of the "history" partition, decoded by tools/history_decode.py; little
+ * endian. Every sector starts with a header, entries follow until the first blank one. */
+#define HISTORY_MAGIC 0x4C48434Du // "MCHL"
+#define HISTORY_VERSION 1
+
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t entry_size;
+  uint32_t seq;      // counts sector changes, the highest is the one written to
+  uint32_t reserved;
+} history_sector_t;
+
+typedef enum {
+  HISTORY_BOOT = 1,      // value: esp_reset_reason(), followed by RUN or PAUSE and SCALE
+  HISTORY_RUN,
+  HISTORY_PAUSE,
+  HISTORY_SCALE,         // value: new timescale
+  HISTORY_TIME_SET,      // value: model time before the jump, model_ts the new one
+  HISTORY_PULSES,        // arg: channel, value: pulses sent since the last entry
+  HISTORY_PULSES_MISSED, // arg: channel, value: pulses that could not be queued
+  HISTORY_OVERFLOW,      // value: entries lost, the buffer was full
+} history_type_t;
+
+typedef struct {
+  uint32_t real_ts;
+  uint32_t model_ts;
+  uint32_t value;
+  uint8_t type;
+  uint8_t arg;
+  uint16_t check; // low half of the CRC32 of the bytes before, tells torn entries
+} history_entry_t;
+
+typedef struct {
+  uint32_t logged;   // entries since boot
+  uint32_t written;  // entries in flash since boot
+  uint32_t flushes;  // batched flash writes
+  uint32_t dropped;  // entries lost to a full buffer
+  uint32_t pending;  // entries waiting for the next flush
+  uint32_t seq;      // of the sector written to
+  uint32_t sector;
+  uint32_t sectors;
+} history_stats_t;
+
+/*
+ * Operating session log: run, pause, scale changes, time jumps and the pulses sent per
+ * channel, stamped with real and model time. Logging only appends to a RAM buffer; a low
+ * priority task writes it out in batches to a ring of flash sectors, erasing each one in
+ * turn. Pulses are counted, not logged one by one, and summed up per flush.
+ */
+void history_init(void);
+
+// Count a clock pulse from the tick path, a few instructions and no lock
+void history_count_pulse(uint8_t channel, bool sent);
+
+void history_get_stats(history_stats_t *out);
+
+void history_register_commands(void);
+
+#endif
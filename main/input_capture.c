@@ -0,0 +1,214 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "input_capture.h"
+#include "timer.h"
+#include "driver/mcpwm_cap.h"
+#include "esp_console.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char *TAG = "input_capture";
+
+#if CONFIG_INPUT_CAPTURE_ENABLE
+
+#define CAPTURE_RING_MASK (CONFIG_INPUT_CAPTURE_RING_SIZE - 1)
+_Static_assert((CONFIG_INPUT_CAPTURE_RING_SIZE & CAPTURE_RING_MASK) == 0, "capture ring size must be a power of two");
+
+/*
+ * Single producer (the capture ISR) / single consumer ring. head is only written by
+ * the ISR, tail only by the drain, both run freely and wrap at 2^32.
+ */
+typedef struct {
+  int gpio;
+  mcpwm_cap_channel_handle_t handle;
+  capture_edge_t ring[CONFIG_INPUT_CAPTURE_RING_SIZE];
+  uint32_t head;
+  uint32_t tail;
+  capture_stats_t stats;
+  // maps capture ticks to esp_timer time, renewed by the first edge a second or more after
+  // the last renewal, so the tick delta stays far below the counter wrap (~53 s at 80 MHz)
+  uint32_t anchor_ticks;
+  int64_t anchor_us;
+} capture_channel_t;
+
+static capture_channel_t channels[INPUT_CAPTURE_CHANNELS_MAX];
+static uint8_t channel_count = 0;
+static mcpwm_cap_timer_handle_t cap_timer = NULL;
+static uint32_t ticks_per_us = 80;
+
+static bool IRAM_ATTR capture_isr(mcpwm_cap_channel_handle_t cap_chan, const mcpwm_capture_event_data_t *edata, void *user_ctx)
+{
+  capture_channel_t *ch = (capture_channel_t *)user_ctx;
+  uint32_t ticks = edata->cap_value;
+  int64_t now_us = esp_timer_get_time();
+
+  // The anchor carries the interrupt latency (a few us), spacing between edges is exact.
+  // Its age comes from esp_timer: after a quiet gap the tick delta may have wrapped and
+  // look small.
+  if (ch->anchor_us == 0 || now_us - ch->anchor_us >= 1000000)
+  {
+    ch->anchor_ticks = ticks;
+    ch->anchor_us = now_us;
+  }
+  int64_t real_us = ch->anchor_us + (ticks - ch->anchor_ticks) / ticks_per_us;
+
+  uint32_t head = ch->head;
+  uint32_t used = head - __atomic_load_n(&ch->tail, __ATOMIC_ACQUIRE);
+  if (used >= CONFIG_INPUT_CAPTURE_RING_SIZE)
+  {
+    ch->stats.overflows++;
+    return false;
+  }
+
+  capture_edge_t *e = &ch->ring[head & CAPTURE_RING_MASK];
+  e->real_us = real_us;
+  e->model_us = timer_model_time_us(real_us);
+  e->ticks = ticks;
+  e->channel = ch - channels;
+  e->level = edata->cap_edge == MCPWM_CAP_EDGE_POS;
+  __atomic_store_n(&ch->head, head + 1, __ATOMIC_RELEASE);
+
+  ch->stats.edges++;
+  if (used + 1 > ch->stats.high_water)
+    ch->stats.high_water = used + 1;
+  return false;
+}
+
+size_t input_capture_drain(uint8_t channel, capture_edge_t *out, size_t max)
+{
+  if (channel >= channel_count)
+    return 0;
+
+  capture_channel_t *ch = &channels[channel];
+  uint32_t tail = ch->tail;
+  uint32_t avail = __atomic_load_n(&ch->head, __ATOMIC_ACQUIRE) - tail;
+  size_t n = avail < max ? avail : max;
+
+  // at most two copies, the part up to the end of the ring and the wrapped rest
+  size_t first = CONFIG_INPUT_CAPTURE_RING_SIZE - (tail & CAPTURE_RING_MASK);
+  if (first > n)
+    first = n;
+  memcpy(out, &ch->ring[tail & CAPTURE_RING_MASK], first * sizeof(*out));
+  memcpy(out + first, ch->ring, (n - first) * sizeof(*out));
+
+  __atomic_store_n(&ch->tail, tail + n, __ATOMIC_RELEASE);
+  return n;
+}
+
+bool input_capture_get_stats(uint8_t channel, capture_stats_t *out)
+{
+  if (channel >= channel_count)
+    return false;
+  *out = channels[channel].stats;
+  return true;
+}
+
+uint8_t input_capture_get_channel_count(void)
+{
+  return channel_count;
+}
+
+void input_capture_init(void)
+{
+  mcpwm_capture_timer_config_t timer_config = {
+      .clk_src = MCPWM_CAPTURE_CLK_SRC_DEFAULT,
+      .group_id = 0,
+  };
+  ESP_ERROR_CHECK(mcpwm_new_capture_timer(&timer_config, &cap_timer));
+  uint32_t resolution_hz = 0;
+  ESP_ERROR_CHECK(mcpwm_capture_timer_get_resolution(cap_timer, &resolution_hz));
+  ticks_per_us = resolution_hz / 1000000;
+
+  // GPIO list from the config, e.g. "2,18"
+  const char *p = CONFIG_INPUT_CAPTURE_GPIOS;
+  while (*p && channel_count < INPUT_CAPTURE_CHANNELS_MAX)
+  {
+    char *end;
+    long gpio = strtol(p, &end, 10);
+    if (end == p)
+      break;
+    p = *end == ',' ? end + 1 : end;
+
+    capture_channel_t *ch = &channels[channel_count];
+    mcpwm_capture_channel_config_t chan_config = {
+        .gpio_num = (int)gpio,
+        .prescale = 1,
+        .flags.pos_edge = true,
+        .flags.neg_edge = true,
+        .flags.pull_up = true,
+    };
+    ESP_ERROR_CHECK(mcpwm_new_capture_channel(cap_timer, &chan_config, &ch->handle));
+    mcpwm_capture_event_callbacks_t cbs = {
+        .on_cap = capture_isr,
+    };
+    ESP_ERROR_CHECK(mcpwm_capture_channel_register_event_callbacks(ch->handle, &cbs, ch));
+    ESP_ERROR_CHECK(mcpwm_capture_channel_enable(ch->handle));
+    ch->gpio = (int)gpio;
+    channel_count++;
+  }
+
+  ESP_ERROR_CHECK(mcpwm_capture_timer_enable(cap_timer));
+  ESP_ERROR_CHECK(mcpwm_capture_timer_start(cap_timer));
+  ESP_LOGI(TAG, "%u capture channel(s) at %lu Hz, ring of %d edges each", channel_count, resolution_hz,
+           CONFIG_INPUT_CAPTURE_RING_SIZE);
+}
+
+static int cmd_capture(int argc, char **argv)
+{
+  bool dump = argc > 1 && strcmp(argv[1], "dump") == 0;
+  for (uint8_t i = 0; i < channel_count; i++)
+  {
+    capture_stats_t s;
+    input_capture_get_stats(i, &s);
+    printf("ch%u gpio %d: edges %lu, overflows %lu, high water %lu/%d\n", i, channels[i].gpio,
+           s.edges, s.overflows, s.high_water, CONFIG_INPUT_CAPTURE_RING_SIZE);
+    if (!dump)
+      continue;
+
+    capture_edge_t batch[16];
+    size_t n;
+    while ((n = input_capture_drain(i, batch, 16)) > 0)
+    {
+      for (size_t k = 0; k < n; k++)
+        printf("  %c real %lld us, model %lld us\n", batch[k].level ? '+' : '-', batch[k].real_us, batch[k].model_us);
+    }
+  }
+  return 0;
+}
+
+void input_capture_register_commands(void)
+{
+  const esp_console_cmd_t capture_cmd = {
+      .command = "capture",
+      .help = "Capture channel counters, 'capture dump' drains and prints the waiting edges",
+      .hint = "[dump]",
+      .func = cmd_capture,
+  };
+  ESP_ERROR_CHECK(esp_console_cmd_register(&capture_cmd));
+}
+#else
+void input_capture_init(void)
+{
+  ESP_LOGD(TAG, "Input capture disabled");
+}
+
+uint8_t input_capture_get_channel_count(void)
+{
+  return 0;
+}
+
+size_t input_capture_drain(uint8_t channel, capture_edge_t *out, size_t max)
+{
+  return 0;
+}
+
+bool input_capture_get_stats(uint8_t channel, capture_stats_t *out)
+{
+  return false;
+}
+
+void input_capture_register_commands(void)
+{
+}
+#endif
@@ -0,0 +1,36 @@
+#ifndef INPUT_CAPTURE_H
+#define INPUT_CAPTURE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define INPUT_CAPTURE_CHANNELS_MAX 3 // capture channels of one MCPWM group
+
+/* One edge, stamped by the MCPWM capture timer in hardware */
+typedef struct {
+  int64_t real_us;  // esp_timer time of the edge
+  int64_t model_us; // model time of the edge (unix_ts in us)
+  uint32_t ticks;   // raw capture timer count, exact spacing between edges of a channel
+  uint8_t channel;
+  uint8_t level;    // level after the edge, 1 = rising
+} capture_edge_t;
+
+typedef struct {
+  uint32_t edges;      // edges put into the ring
+  uint32_t overflows;  // edges dropped because the ring was full
+  uint32_t high_water; // most edges waiting in the ring
+} capture_stats_t;
+
+void input_capture_init(void);
+
+uint8_t input_capture_get_channel_count(void);
+
+// Move up to max edges of a channel into out, oldest first. One consumer per channel.
+size_t input_capture_drain(uint8_t channel, capture_edge_t *out, size_t max);
+
+bool input_capture_get_stats(uint8_t channel, capture_stats_t *out);
+
+void input_capture_register_commands(void);
+
+#endif
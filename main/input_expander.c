@@ -0,0 +1,299 @@
+#include <stdio.h>
+#include <string.h>
+#include "input_expander.h"
+#include "event_handler.h"
+#include "lcd_driver.h"
+#include "driver/i2c_master.h"
+#include "driver/gpio.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_console.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char *TAG = "input_expander";
+
+#if CONFIG_INPUT_EXPANDER_ENABLE
+
+// MCP23017 registers, IOCON.BANK = 0 (A/B interleaved, sequential addressing)
+#define MCP_IODIRA 0x00
+#define MCP_GPINTENA 0x04
+#define MCP_IOCON 0x0A
+#define MCP_GPPUA 0x0C
+#define MCP_GPIOA 0x12
+#define MCP_IOCON_MIRROR 0x40 // INTA = INTA | INTB
+#define MCP_IOCON_ODR 0x04    // open drain INT, several expanders share one line
+
+// MCP23017 and PCF8575 both answer on 0x20..0x27 only
+_Static_assert(CONFIG_INPUT_EXPANDER_BASE_ADDR + CONFIG_INPUT_EXPANDER_COUNT <= 0x28,
+               "input expander addresses beyond 0x27");
+
+typedef struct {
+  uint8_t address;
+  i2c_master_dev_handle_t dev;
+  uint16_t raw;       // last read levels
+  uint16_t stable;    // debounced levels
+  int64_t changed_us; // last change of raw
+} expander_t;
+
+static expander_t expanders[CONFIG_INPUT_EXPANDER_COUNT];
+static uint8_t expander_count = 0;
+static TaskHandle_t expander_task_handle = NULL;
+static input_expander_stats_t stats;
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void IRAM_ATTR expander_isr(void *arg)
+{
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(expander_task_handle, &woken);
+  portENTER_CRITICAL_ISR(&stats_lock);
+  stats.interrupts++;
+  portEXIT_CRITICAL_ISR(&stats_lock);
+  portYIELD_FROM_ISR(woken);
+}
+
+static esp_err_t expander_write16(expander_t *e, uint8_t reg, uint16_t value)
+{
+  uint8_t buf[3] = {reg, value & 0xFF, value >> 8};
+  return i2c_master_transmit(e->dev, buf, sizeof(buf), LCD_I2C_TIMEOUT_MS);
+}
+
+static esp_err_t expander_setup(expander_t *e)
+{
+#if CONFIG_INPUT_EXPANDER_MCP23017
+  esp_err_t err = expander_write16(e, MCP_IOCON, (MCP_IOCON_MIRROR | MCP_IOCON_ODR) * 0x0101);
+  if (err == ESP_OK)
+    err = expander_write16(e, MCP_IODIRA, 0xFFFF); // all inputs
+  if (err == ESP_OK)
+    err = expander_write16(e, MCP_GPPUA, 0xFFFF); // contacts switch to ground
+  if (err == ESP_OK)
+    err = expander_write16(e, MCP_GPINTENA, 0xFFFF); // interrupt on any change
+  return err;
+#else
+  // PCF8575: quasi-bidirectional, writing ones makes the pins weak pulled-up inputs
+  uint8_t ones[2] = {0xFF, 0xFF};
+  return i2c_master_transmit(e->dev, ones, sizeof(ones), LCD_I2C_TIMEOUT_MS);
+#endif
+}
+
+// One burst read of all 16 pins, this also clears the INT output
+static esp_err_t expander_read(expander_t *e, uint16_t *levels)
+{
+  uint8_t buf[2];
+#if CONFIG_INPUT_EXPANDER_MCP23017
+  uint8_t reg = MCP_GPIOA;
+  esp_err_t err = i2c_master_transmit_receive(e->dev, &reg, 1, buf, sizeof(buf), LCD_I2C_TIMEOUT_MS);
+#else
+  esp_err_t err = i2c_master_receive(e->dev, buf, sizeof(buf), LCD_I2C_TIMEOUT_MS);
+#endif
+  if (err == ESP_OK)
+    *levels = buf[0] | (buf[1] << 8);
+  return err;
+}
+
+// Read every expander, the shared INT line does not tell which one changed
+static void expander_scan(void)
+{
+  lcd_bus_lock();
+  int64_t start = esp_timer_get_time();
+  uint32_t errors = 0;
+  for (uint8_t i = 0; i < expander_count; i++)
+  {
+    expander_t *e = &expanders[i];
+    uint16_t levels;
+    if (expander_read(e, &levels) != ESP_OK)
+    {
+      errors++;
+      continue;
+    }
+    if (levels != e->raw)
+    {
+      e->raw = levels;
+      e->changed_us = start;
+    }
+  }
+  lcd_bus_unlock();
+  uint32_t us = (uint32_t)(esp_timer_get_time() - start);
+
+  portENTER_CRITICAL(&stats_lock);
+  stats.scans++;
+  stats.scan_us_last = us;
+  if (us > stats.scan_us_max)
+    stats.scan_us_max = us;
+  stats.scan_us_total += us;
+  stats.errors += errors;
+  portEXIT_CRITICAL(&stats_lock);
+}
+
+// Post the inputs that were stable for the debounce time, true while any still settles
+static bool expander_debounce(int64_t now)
+{
+  bool settling = false;
+  for (uint8_t i = 0; i < expander_count; i++)
+  {
+    expander_t *e = &expanders[i];
+    uint16_t diff = e->raw ^ e->stable;
+    if (diff == 0)
+      continue;
+    if (now - e->changed_us < CONFIG_INPUT_EXPANDER_DEBOUNCE_MS * 1000)
+    {
+      settling = true;
+      continue;
+    }
+
+    // the event queue is short and posts do not wait: one event per expander, not per pin
+    e->stable = e->raw;
+    input_change_t change = {
+        .expander = i,
+        .changed = diff,
+        .active = (uint16_t)~e->stable,
+    };
+    events_post(EVENT_INPUT_CHANGE, &change, sizeof(change));
+    portENTER_CRITICAL(&stats_lock);
+    stats.changes += __builtin_popcount(diff);
+    portEXIT_CRITICAL(&stats_lock);
+  }
+  return settling;
+}
+
+static void expander_task(void *arg)
+{
+  TickType_t wait = pdMS_TO_TICKS(INPUT_EXPANDER_RESCAN_MS);
+  while (true)
+  {
+    ulTaskNotifyTake(pdTRUE, wait);
+    expander_scan();
+    bool settling = expander_debounce(esp_timer_get_time());
+    wait = pdMS_TO_TICKS(settling ? CONFIG_INPUT_EXPANDER_DEBOUNCE_MS : INPUT_EXPANDER_RESCAN_MS);
+  }
+}
+
+void input_expander_init(void)
+{
+  i2c_master_bus_handle_t bus = lcd_get_i2c_bus();
+  for (uint8_t i = 0; i < CONFIG_INPUT_EXPANDER_COUNT; i++)
+  {
+    uint8_t address = CONFIG_INPUT_EXPANDER_BASE_ADDR + i;
+    if (lcd_uses_address(address))
+    {
+      ESP_LOGW(TAG, "0x%02x belongs to a display, skipping", address);
+      continue;
+    }
+    lcd_bus_lock();
+    esp_err_t err = i2c_master_probe(bus, address, LCD_I2C_TIMEOUT_MS);
+    lcd_bus_unlock();
+    if (err != ESP_OK)
+    {
+      ESP_LOGW(TAG, "No expander at 0x%02x, skipping", address);
+      continue;
+    }
+
+    expander_t *e = &expanders[expander_count];
+    i2c_device_config_t dev_config = {
+        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+        .device_address = address,
+        .scl_speed_hz = I2C_MASTER_FREQ_HZ};
+    ESP_ERROR_CHECK(i2c_master_bus_add_device(bus, &dev_config, &e->dev));
+    e->address = address;
+    lcd_bus_lock();
+    err = expander_setup(e);
+    if (err == ESP_OK)
+      err = expander_read(e, &e->raw);
+    lcd_bus_unlock();
+    if (err != ESP_OK)
+    {
+      ESP_LOGW(TAG, "Expander at 0x%02x not responding, skipping", address);
+      i2c_master_bus_rm_device(e->dev);
+      continue;
+    }
+    e->stable = e->raw; // no events for the power-up levels
+    expander_count++;
+  }
+  portENTER_CRITICAL(&stats_lock);
+  stats.expanders = expander_count;
+  portEXIT_CRITICAL(&stats_lock);
+  if (expander_count == 0)
+  {
+    ESP_LOGW(TAG, "No input expanders found");
+    return;
+  }
+
+  // the first scan shows what the inputs cost on the bus shared with the displays
+  expander_scan();
+  ESP_LOGI(TAG, "%u expander(s), %u inputs, scan %lu us (%lu us each)", expander_count,
+           expander_count * INPUT_EXPANDER_PINS, stats.scan_us_last, stats.scan_us_last / expander_count);
+
+  xTaskCreatePinnedToCore(expander_task, "input_expander", 3072, NULL, 6, &expander_task_handle, 1);
+
+  gpio_config_t int_config = {
+      .pin_bit_mask = 1ULL << CONFIG_INPUT_EXPANDER_INT_GPIO,
+      .mode = GPIO_MODE_INPUT,
+      .pull_up_en = GPIO_PULLUP_ENABLE, // open drain INT
+      .pull_down_en = GPIO_PULLDOWN_DISABLE,
+      .intr_type = GPIO_INTR_NEGEDGE,
+  };
+  ESP_ERROR_CHECK(gpio_config(&int_config));
+  esp_err_t err = gpio_install_isr_service(0);
+  if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) // already installed by another driver
+    ESP_ERROR_CHECK(err);
+  ESP_ERROR_CHECK(gpio_isr_handler_add(CONFIG_INPUT_EXPANDER_INT_GPIO, expander_isr, NULL));
+}
+
+bool input_expander_get(uint16_t input)
+{
+  uint8_t idx = input / INPUT_EXPANDER_PINS;
+  if (idx >= expander_count)
+    return false;
+  return !(expanders[idx].stable & (1 << (input % INPUT_EXPANDER_PINS)));
+}
+
+void input_expander_get_stats(input_expander_stats_t *out)
+{
+  portENTER_CRITICAL(&stats_lock);
+  *out = stats;
+  portEXIT_CRITICAL(&stats_lock);
+}
+
+static int cmd_inputs(int argc, char **argv)
+{
+  input_expander_stats_t s;
+  input_expander_get_stats(&s);
+  printf("expanders %u, interrupts %lu, scans %lu, changes %lu, errors %lu\n",
+         s.expanders, s.interrupts, s.scans, s.changes, s.errors);
+  if (s.scans > 0 && s.expanders > 0)
+    printf("scan us: last %lu, avg %lu, max %lu, per expander %lu\n", s.scan_us_last,
+           (uint32_t)(s.scan_us_total / s.scans), s.scan_us_max, (uint32_t)(s.scan_us_total / s.scans / s.expanders));
+  for (uint8_t i = 0; i < expander_count; i++)
+    printf("0x%02x: active %04x\n", expanders[i].address, (uint16_t)~expanders[i].stable);
+  return 0;
+}
+
+void input_expander_register_commands(void)
+{
+  const esp_console_cmd_t inputs_cmd = {
+      .command = "inputs",
+      .help = "Expander input states and scan timing",
+      .func = cmd_inputs,
+  };
+  ESP_ERROR_CHECK(esp_console_cmd_register(&inputs_cmd));
+}
+#else
+void input_expander_init(void)
+{
+  ESP_LOGD(TAG, "Input expanders disabled");
+}
+
+bool input_expander_get(uint16_t input)
+{
+  return false;
+}
+
+void input_expander_get_stats(input_expander_stats_t *out)
+{
+  memset(out, 0, sizeof(*out));
+}
+
+void input_expander_register_commands(void)
+{
+}
+#endif
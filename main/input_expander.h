@@ -0,0 +1,39 @@
+#ifndef INPUT_EXPANDER_H
+#define INPUT_EXPANDER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define INPUT_EXPANDER_MAX 8          // 3 address pins
+#define INPUT_EXPANDER_PINS 16        // MCP23017 and PCF8575 are both 16 bit
+#define INPUT_EXPANDER_RESCAN_MS 1000 // idle rescan, recovers a missed INT edge
+
+/* data of EVENT_INPUT_CHANGE, one event for all pins of an expander that changed together */
+typedef struct {
+  uint8_t expander; // index, input number = expander * 16 + pin
+  uint16_t changed; // pins with a new debounced state
+  uint16_t active;  // all pins of the expander, set = contact closed (pin pulled low)
+} input_change_t;
+
+typedef struct {
+  uint8_t expanders;      // expanders answering on the bus
+  uint32_t interrupts;    // INT edges seen
+  uint32_t scans;         // burst reads of all expanders
+  uint32_t scan_us_last;  // time of one scan over all expanders
+  uint32_t scan_us_max;
+  uint64_t scan_us_total;
+  uint32_t changes;       // debounced pin changes, posted as one event per expander
+  uint32_t errors;        // failed reads
+} input_expander_stats_t;
+
+// Needs the I2C bus, call after i2c_initialize()
+void input_expander_init(void);
+
+// Debounced state of an input, false for unknown inputs
+bool input_expander_get(uint16_t input);
+
+void input_expander_get_stats(input_expander_stats_t *out);
+
+void input_expander_register_commands(void);
+
+#endif
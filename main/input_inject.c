@@ -0,0 +1,259 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "input_inject.h"
+#include "button_driver.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_console.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char *TAG = "input_inject";
+
+static const char *BUTTON_NAMES[BUTTON__COUNT] = {
+    [BUTTON_START_STOP] = "startstop",
+    [BUTTON_MENU] = "menu",
+    [BUTTON_LEFT] = "left",
+    [BUTTON_RIGHT] = "right",
+    [BUTTON_UP] = "up",
+    [BUTTON_DOWN] = "down",
+    [BUTTON_CANCEL] = "cancel",
+    [BUTTON_OK] = "ok",
+};
+
+static QueueHandle_t script_queue = NULL;
+static uint8_t inject_mask = 0;
+
+/* latency probe: armed by an injected press, each stage is taken once */
+static volatile int64_t probe_start_us = 0;
+static volatile uint8_t probe_done = 0; // bit per stage
+static input_latency_stat_t latency[INPUT_LAT__COUNT];
+static portMUX_TYPE latency_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void input_latency_mark(input_latency_stage_t stage)
+{
+  if (probe_start_us == 0)
+    return;
+
+  portENTER_CRITICAL(&latency_lock);
+  // stages are taken in order, a frame sent before the state changed does not count
+  bool in_order = stage == 0 || (probe_done & (1 << (stage - 1)));
+  if (probe_start_us != 0 && in_order && !(probe_done & (1 << stage)))
+  {
+    uint32_t us = (uint32_t)(esp_timer_get_time() - probe_start_us);
+    input_latency_stat_t *s = &latency[stage];
+    if (s->count == 0 || us < s->min_us)
+      s->min_us = us;
+    if (us > s->max_us)
+      s->max_us = us;
+    s->total_us += us;
+    s->count++;
+    probe_done |= 1 << stage;
+    if (stage == INPUT_LAT__COUNT - 1)
+      probe_start_us = 0;
+  }
+  portEXIT_CRITICAL(&latency_lock);
+}
+
+void input_latency_get(input_latency_stage_t stage, input_latency_stat_t *out)
+{
+  portENTER_CRITICAL(&latency_lock);
+  *out = latency[stage];
+  portEXIT_CRITICAL(&latency_lock);
+}
+
+void input_latency_reset(void)
+{
+  portENTER_CRITICAL(&latency_lock);
+  memset(latency, 0, sizeof(latency));
+  probe_start_us = 0;
+  portEXIT_CRITICAL(&latency_lock);
+}
+
+static int button_by_name(const char *name)
+{
+  for (int i = 0; i < BUTTON__COUNT; i++)
+  {
+    if (strcasecmp(name, BUTTON_NAMES[i]) == 0)
+      return i;
+  }
+  return -1;
+}
+
+static void inject_set(int btn, bool pressed)
+{
+  if (pressed)
+  {
+    inject_mask |= BUTTON_MASK(btn);
+    // measure from the level change, debounce time included
+    portENTER_CRITICAL(&latency_lock);
+    probe_start_us = esp_timer_get_time();
+    probe_done = 0;
+    portEXIT_CRITICAL(&latency_lock);
+  }
+  else
+  {
+    inject_mask &= ~BUTTON_MASK(btn);
+  }
+  button_inject(inject_mask);
+}
+
+/* Parse and optionally execute a script. Waits are relative to the previous step's
+   deadline, so the timing does not drift with the execution time of the steps. */
+static bool script_exec(char *script, bool run)
+{
+  TickType_t wake = xTaskGetTickCount();
+  char *save = NULL;
+
+  for (char *step = strtok_r(script, ";", &save); step; step = strtok_r(NULL, ";", &save))
+  {
+    char cmd[8] = "";
+    char arg[12] = "";
+    int ms = -1;
+    int n = sscanf(step, " %7s %11s %d", cmd, arg, &ms);
+    if (n <= 0)
+      continue;
+
+    if (strcmp(cmd, "wait") == 0)
+    {
+      ms = atoi(arg);
+      if (n < 2 || ms <= 0)
+        return false;
+      if (run)
+        vTaskDelayUntil(&wake, pdMS_TO_TICKS(ms));
+      continue;
+    }
+
+    int btn = button_by_name(arg);
+    if (n < 2 || btn < 0)
+      return false;
+
+    if (strcmp(cmd, "down") == 0 || strcmp(cmd, "up") == 0)
+    {
+      if (run)
+        inject_set(btn, cmd[0] == 'd');
+    }
+    else if (strcmp(cmd, "tap") == 0 || strcmp(cmd, "hold") == 0)
+    {
+      if (ms <= 0)
+      {
+        if (cmd[0] == 'h')
+          return false;
+        ms = 100;
+      }
+      if (run)
+      {
+        inject_set(btn, true);
+        vTaskDelayUntil(&wake, pdMS_TO_TICKS(ms));
+        inject_set(btn, false);
+      }
+    }
+    else
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void inject_player_task(void *pv)
+{
+  char script[INPUT_SCRIPT_MAX + 1];
+  for (;;)
+  {
+    if (xQueueReceive(script_queue, script, portMAX_DELAY) != pdTRUE)
+      continue;
+    ESP_LOGI(TAG, "Playing: %s", script);
+    script_exec(script, true);
+    // never leave a button stuck
+    inject_mask = 0;
+    button_inject(0);
+  }
+}
+
+bool input_inject_run(const char *script)
+{
+  char buf[INPUT_SCRIPT_MAX + 1];
+  strlcpy(buf, script, sizeof(buf));
+  if (!script_exec(buf, false))
+    return false;
+
+  strlcpy(buf, script, sizeof(buf));
+  return script_queue && xQueueSend(script_queue, buf, 0) == pdTRUE;
+}
+
+void input_inject_init(void)
+{
+  script_queue = xQueueCreate(1, INPUT_SCRIPT_MAX + 1);
+  xTaskCreatePinnedToCore(inject_player_task, "inject_player", 3072, NULL, 9, NULL, 1);
+}
+
+// -----------------
+// Console commands
+// -----------------
+
+static int cmd_inject(int argc, char **argv)
+{
+  if (argc < 2)
+  {
+    printf("usage: inject <step>[; <step>...]\n");
+    return 1;
+  }
+
+  char script[INPUT_SCRIPT_MAX + 1] = "";
+  for (int i = 1; i < argc; i++)
+  {
+    if (i > 1)
+      strlcat(script, " ", sizeof(script));
+    strlcat(script, argv[i], sizeof(script));
+  }
+
+  if (!input_inject_run(script))
+  {
+    printf("invalid script or player busy\n");
+    return 1;
+  }
+  return 0;
+}
+
+static int cmd_latency(int argc, char **argv)
+{
+  static const char *STAGE_NAMES[INPUT_LAT__COUNT] = {"dispatch", "state", "frame"};
+
+  if (argc > 1 && strcmp(argv[1], "reset") == 0)
+  {
+    input_latency_reset();
+    return 0;
+  }
+
+  printf("%-9s %6s %9s %9s %9s\n", "stage", "count", "min_us", "avg_us", "max_us");
+  for (int i = 0; i < INPUT_LAT__COUNT; i++)
+  {
+    input_latency_stat_t s;
+    input_latency_get(i, &s);
+    printf("%-9s %6lu %9lu %9lu %9lu\n", STAGE_NAMES[i], s.count, s.min_us,
+           s.count ? (uint32_t)(s.total_us / s.count) : 0, s.max_us);
+  }
+  return 0;
+}
+
+void input_inject_register_commands(void)
+{
+  const esp_console_cmd_t inject_cmd = {
+      .command = "inject",
+      .help = "Play a button script, e.g. inject tap menu; wait 300; hold down 1500; tap ok",
+      .hint = "<script>",
+      .func = cmd_inject,
+  };
+  ESP_ERROR_CHECK(esp_console_cmd_register(&inject_cmd));
+
+  const esp_console_cmd_t latency_cmd = {
+      .command = "latency",
+      .help = "Injected press to dispatch / state change / LCD frame latency, 'latency reset' clears",
+      .hint = "[reset]",
+      .func = cmd_latency,
+  };
+  ESP_ERROR_CHECK(esp_console_cmd_register(&latency_cmd));
+}
@@ -0,0 +1,50 @@
+#ifndef INPUT_INJECT_H
+#define INPUT_INJECT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Scripted button input for reproducible UI runs. Injected levels are merged with the
+ * GPIO levels in the button scan, so they take the same debounce and state machine path
+ * as real presses.
+ *
+ * Script: steps separated by ';'
+ *   down <btn>         press and keep pressed
+ *   up <btn>           release
+ *   tap <btn> [ms]     press, wait (default 100 ms), release
+ *   hold <btn> <ms>    same as tap, for long press / repeat
+ *   wait <ms>
+ * Buttons: startstop menu left right up down cancel ok
+ */
+
+#define INPUT_SCRIPT_MAX 200
+
+typedef enum {
+  INPUT_LAT_DISPATCH = 0, // EVENT_BUTTON_* reached the state machine
+  INPUT_LAT_STATE,        // state_ctx changed
+  INPUT_LAT_FRAME,        // next LCD frame of the main display completely sent
+  INPUT_LAT__COUNT,
+} input_latency_stage_t;
+
+typedef struct {
+  uint32_t count;
+  uint32_t min_us;
+  uint32_t max_us;
+  uint64_t total_us;
+} input_latency_stat_t;
+
+void input_inject_init(void);
+
+// Queue a script for the player task; false if the player is busy or the script is invalid
+bool input_inject_run(const char *script);
+
+// Record a pipeline stage of the injected press in flight (cheap when nothing is measured)
+void input_latency_mark(input_latency_stage_t stage);
+
+void input_latency_get(input_latency_stage_t stage, input_latency_stat_t *out);
+void input_latency_reset(void);
+
+void input_inject_register_commands(void);
+
+#endif
@@ -0,0 +1,194 @@
+#include <string.h>
+#include "journal.h"
+
+#define JOURNAL_MAGIC 0x524A434Du // "MCJR"
+#define JOURNAL_VERSION 1
+
+/* Flash layout of a record, little endian; the CRC follows the padded payload */
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t length;
+  uint32_t seq;
+  uint32_t erases;
+} journal_header_t;
+
+_Static_assert(sizeof(journal_header_t) == JOURNAL_HEADER_SIZE, "journal header layout");
+
+static uint32_t record_size(uint16_t len)
+{
+  return JOURNAL_HEADER_SIZE + ((len + 3u) & ~3u) + 4;
+}
+
+uint32_t journal_crc32(uint32_t crc, const void *data, uint32_t len)
+{
+  const uint8_t *p = (const uint8_t *)data;
+  crc = ~crc;
+  while (len--)
+  {
+    crc ^= *p++;
+    for (int k = 0; k < 8; k++)
+      crc = (crc >> 1) ^ (0xEDB88320u & -(crc & 1));
+  }
+  return ~crc;
+}
+
+uint32_t journal_slot_size(uint16_t payload_len)
+{
+  uint32_t size = JOURNAL_SLOT_MIN;
+  while (size < record_size(payload_len))
+    size *= 2;
+  return size;
+}
+
+// Header and CRC check of the record at addr; buf gets the whole record
+static bool read_record(const journal_flash_t *f, uint32_t addr, uint32_t slot_size, uint8_t *buf)
+{
+  journal_header_t *h = (journal_header_t *)buf;
+  if (!f->read(f->ctx, addr, buf, JOURNAL_HEADER_SIZE))
+    return false;
+  if (h->magic != JOURNAL_MAGIC || h->version != JOURNAL_VERSION || h->length > JOURNAL_PAYLOAD_MAX)
+    return false;
+  uint32_t size = record_size(h->length);
+  if (size > slot_size)
+    return false;
+  if (!f->read(f->ctx, addr + JOURNAL_HEADER_SIZE, buf + JOURNAL_HEADER_SIZE, size - JOURNAL_HEADER_SIZE))
+    return false;
+  uint32_t crc;
+  memcpy(&crc, buf + size - 4, 4);
+  return crc == journal_crc32(0, buf, size - 4);
+}
+
+static bool is_blank(const journal_flash_t *f, uint32_t addr, uint32_t len)
+{
+  uint8_t buf[JOURNAL_SLOT_MAX];
+  for (uint32_t done = 0; done < len; done += sizeof(buf))
+  {
+    uint32_t n = len - done < sizeof(buf) ? len - done : sizeof(buf);
+    if (!f->read(f->ctx, addr + done, buf, n))
+      return false;
+    for (uint32_t i = 0; i < n; i++)
+    {
+      if (buf[i] != 0xFF)
+        return false;
+    }
+  }
+  return true;
+}
+
+uint16_t journal_mount(journal_t *j, const journal_flash_t *flash, uint16_t payload_len, void *out)
+{
+  memset(j, 0, sizeof(*j));
+  j->flash = *flash;
+  j->payload_len = payload_len;
+  j->stats.slot_size = journal_slot_size(payload_len);
+
+  uint8_t buf[JOURNAL_SLOT_MAX];
+  bool found = false;
+  uint32_t best_end = 0;
+  for (uint32_t size = JOURNAL_SLOT_MIN; size <= JOURNAL_SLOT_MAX; size *= 2)
+  {
+    for (uint32_t addr = 0; addr + size <= flash->size; addr += size)
+    {
+      if (!read_record(flash, addr, size, buf))
+        continue;
+      const journal_header_t *h = (const journal_header_t *)buf;
+      if (found && (int32_t)(h->seq - j->stats.seq) <= 0)
+        continue;
+      found = true;
+      j->stats.seq = h->seq;
+      j->stats.erases = h->erases;
+      j->last_len = h->length;
+      memcpy(j->last, buf + JOURNAL_HEADER_SIZE, h->length);
+      best_end = addr + record_size(h->length);
+    }
+  }
+  if (!found)
+    return 0;
+
+  // continue behind the newest record, aligned to the current slot size
+  uint32_t slots = flash->size / j->stats.slot_size;
+  j->stats.slot = ((best_end + j->stats.slot_size - 1) / j->stats.slot_size) % slots;
+  uint16_t found_len = j->last_len;
+  memcpy(out, j->last, found_len < payload_len ? found_len : payload_len);
+  if (found_len != payload_len)
+    j->last_len = 0; // layout changed, the next append must not compare against it
+  return found_len;
+}
+
+bool journal_prepare(journal_t *j)
+{
+  const journal_flash_t *f = &j->flash;
+  uint32_t slot_size = j->stats.slot_size;
+  uint32_t slots = f->size / slot_size;
+  for (uint32_t tries = 0; tries < slots && !j->ready; tries++)
+  {
+    uint32_t addr = j->stats.slot * slot_size;
+    if (addr % f->sector_size == 0)
+    {
+      // the oldest records live here, the newest one is in another sector; erased ahead
+      // before a reboot it reads blank already
+      if (!is_blank(f, addr, f->sector_size))
+      {
+        if (!f->erase(f->ctx, addr, f->sector_size))
+          return false;
+        j->stats.erases++;
+      }
+      j->ready = true;
+    }
+    else if (is_blank(f, addr, slot_size))
+    {
+      j->ready = true;
+    }
+    else
+    {
+      j->stats.torn++; // left over from a cut write, never program over it
+      j->stats.slot = (j->stats.slot + 1) % slots;
+    }
+  }
+  return j->ready;
+}
+
+journal_result_t journal_append(journal_t *j, const void *payload)
+{
+  if (j->last_len == j->payload_len && memcmp(j->last, payload, j->payload_len) == 0)
+  {
+    j->stats.skipped++;
+    return JOURNAL_UNCHANGED;
+  }
+
+  // normally done after the previous append already
+  if (!journal_prepare(j))
+    return JOURNAL_ERROR;
+
+  const journal_flash_t *f = &j->flash;
+  uint32_t addr = j->stats.slot * j->stats.slot_size;
+  j->stats.slot = (j->stats.slot + 1) % (f->size / j->stats.slot_size);
+  j->ready = false;
+
+  uint8_t buf[JOURNAL_SLOT_MAX];
+  uint32_t size = record_size(j->payload_len);
+  memset(buf, 0, size);
+  journal_header_t h = {
+      .magic = JOURNAL_MAGIC,
+      .version = JOURNAL_VERSION,
+      .length = j->payload_len,
+      .seq = j->stats.seq + 1,
+      .erases = j->stats.erases,
+  };
+  memcpy(buf, &h, sizeof(h));
+  memcpy(buf + JOURNAL_HEADER_SIZE, payload, j->payload_len);
+  uint32_t crc = journal_crc32(0, buf, size - 4);
+  memcpy(buf + size - 4, &crc, 4);
+  if (!f->write(f->ctx, addr, buf, size))
+    return JOURNAL_ERROR;
+
+  j->stats.seq++;
+  j->stats.writes++;
+  memcpy(j->last, payload, j->payload_len);
+  j->last_len = j->payload_len;
+
+  // erase ahead now rather than in the next append; a failure shows there again
+  journal_prepare(j);
+  return JOURNAL_WRITTEN;
+}
@@ -0,0 +1,75 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Append-only journal of one fixed-size record on NOR flash. Every write goes to the
+ * next blank slot, the record carries a sequence number and a CRC, and mounting picks
+ * the newest valid record; a torn write or erase only ever loses the record in flight.
+ * The next slot is kept ready: once a sector is full the following one is erased right
+ * away, so an append is a single program operation (the power-fail save relies on it).
+ * Sectors are erased in turn, so the whole area wears evenly.
+ * Plain C: flash access comes through journal_flash_t, used by storage.c.
+ */
+
+#define JOURNAL_PAYLOAD_MAX 236   // fits the largest slot
+#define JOURNAL_HEADER_SIZE 16
+#define JOURNAL_SLOT_MIN 32
+#define JOURNAL_SLOT_MAX 256
+#define JOURNAL_WEAR_CYCLES 100000 // rated erase cycles of a sector
+
+typedef struct {
+  bool (*read)(void *ctx, uint32_t addr, void *buf, uint32_t len);
+  bool (*write)(void *ctx, uint32_t addr, const void *buf, uint32_t len);
+  bool (*erase)(void *ctx, uint32_t addr, uint32_t len);
+  void *ctx;
+  uint32_t size;        // whole sectors, at least two
+  uint32_t sector_size;
+} journal_flash_t;
+
+typedef struct {
+  uint32_t seq;          // of the newest record
+  uint32_t slot;         // where the next record goes
+  uint32_t slot_size;
+  uint32_t writes;       // records written since boot
+  uint32_t skipped;      // appends without a change
+  uint32_t torn;         // damaged slots skipped since boot
+  uint32_t erases;       // sector erases over the journal's life, kept in the records
+} journal_stats_t;
+
+typedef struct {
+  journal_flash_t flash;
+  uint16_t payload_len;
+  uint8_t last[JOURNAL_PAYLOAD_MAX];
+  uint16_t last_len;     // 0 = nothing stored yet
+  bool ready;            // the slot at stats.slot is blank, its sector erased if it starts one
+  journal_stats_t stats;
+} journal_t;
+
+typedef enum {
+  JOURNAL_WRITTEN = 0,
+  JOURNAL_UNCHANGED,
+  JOURNAL_ERROR,
+} journal_result_t;
+
+uint32_t journal_crc32(uint32_t crc, const void *data, uint32_t len);
+
+// Slot size for a payload: header, payload and CRC rounded up to a power of two
+uint32_t journal_slot_size(uint16_t payload_len);
+
+// Scan the flash for the newest valid record, at any slot size so records of an older
+// firmware are found too. Returns its payload length (out gets at most payload_len and
+// is left alone past it), 0 if there is none.
+uint16_t journal_mount(journal_t *j, const journal_flash_t *flash, uint16_t payload_len, void *out);
+
+// Make the next slot programmable: skip torn slots, erase the sector it starts. Appends do
+// this by themselves after each record, call it after mounting to have the first one
+// ready too. False on a flash error.
+bool journal_prepare(journal_t *j);
+
+// Write a record unless it equals the newest one
+journal_result_t journal_append(journal_t *j, const void *payload);
+
+#endif
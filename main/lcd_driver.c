@@ -2,7 +2,13 @@
 #include <stdio.h>
 #include <string.h>
 #include <rom/ets_sys.h>
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "freertos/semphr.h"
 #include "lcd_driver.h"
+#include "lcd_widget.h"
+#include "lcd_mirror.h"
+#include "input_inject.h"
 #include "event_handler.h"
 #include "timer.h" // for unix_ts
 #include "state_machine.h"
@@ -32,44 +38,175 @@ static const char *RESTART_SCREEN_CONTENT =
     "    Model Clock     "
     "    v0.1            ";
 
+// Hand a failed display write up to the caller; the display is offline from then on
+#define LCD_TRY(x)          \
+  do                        \
+  {                         \
+    esp_err_t err_ = (x);   \
+    if (err_ != ESP_OK)     \
+      return err_;          \
+  } while (0)
+
+static const uint8_t COMMAND_SHIFT_LEFT = 0b00011000; // Cursor/display shift: display, left
+
+/* Ticker running through one DDRAM line */
+typedef struct
+{
+  bool active;
+  bool reload;   // line has to be written completely
+  bool rows_only; // the other line is in use, steps rewrite the visible rows instead of shifting
+  uint8_t line;  // DDRAM line, row % 2
+  uint16_t len;  // text length incl. padding
+  uint16_t head; // text index shown in the first column of the line
+  int64_t next_step_us;
+  char text[LCD_TICKER_MAX + LCD_TICKER_GAP + 1];
+} lcd_ticker_t;
+
+#if CONFIG_LCD_ADAPTIVE_TIMING
+/* Instruction execution times, datasheet worst case until calibrated */
+typedef struct
+{
+  uint32_t exec_us; // most instructions and data writes (37 us typ.)
+  uint32_t home_us; // clear display / return home (1.52 ms typ.)
+  bool busy_flag;   // busy flag is readable through the backpack
+} lcd_timing_t;
+#endif
+
+/* One HD44780 + PCF8574 backpack on the shared bus */
+typedef struct
+{
+  const char *name;
+  uint8_t address;
+  uint8_t cols;
+  uint8_t rows;
+  lcd_screen_state_t screen; // assigned screen
+  bool present;              // answered the probe at init
+  bool online;               // cleared on a write error until the display is recovered
+  int64_t retry_at_us;       // next recovery attempt, 0 = no outage
+  uint32_t backoff_ms;
+  i2c_master_dev_handle_t dev;
+  uint8_t backlight;
+  char buffer[LCD_BUFFER_DEPTH][LCD_BUFFER_SIZE]; // what is on the glass / what should be
+  uint32_t dirty[LCD_ROWS];                       // per row: cells written since last sent
+  const lcd_screen_def_t *screen_def;             // screen currently composed
+  lcd_widget_t widgets[LCD_WIDGETS_MAX];          // retained widgets of screen_def
+  uint32_t deficit;                               // scheduler credit in wire bytes
+  int64_t frame_start_us;                         // first transfer of the frame in flight, 0 = idle
+  lcd_display_stats_t stats;
+  char ddram[LCD_DDRAM_LINES][LCD_DDRAM_LINE_LEN]; // controller memory incl. the off-screen cells
+  uint8_t shift;                                   // display shift, left steps modulo the line length
+  lcd_ticker_t ticker;
+  lcd_ticker_t ticker_req; // set by lcd_ticker_start/stop, taken over by the LCD task
+  bool ticker_req_pending;
+#if CONFIG_LCD_ADAPTIVE_TIMING
+  lcd_timing_t timing;
+  int64_t ready_at_us; // earliest time the controller accepts the next write
+#endif
+} lcd_display_t;
+
+#define LCD_BUFFER_SHOWN 0
+#define LCD_BUFFER_DRAW 1
+
+#if CONFIG_LCD_ADAPTIVE_TIMING
+#define LCD_DISPLAY_TIMING_INIT .timing = {.exec_us = LCD_EXEC_US_DEFAULT, .home_us = LCD_HOME_US_DEFAULT, .busy_flag = false},
+#else
+#define LCD_DISPLAY_TIMING_INIT
+#endif
+
+#define LCD_STATION_DISPLAY(n, addr)      \
+  {                                       \
+      .name = "station" #n,               \
+      .address = (addr),                  \
+      .cols = CONFIG_LCD_STATION_COLS,    \
+      .rows = CONFIG_LCD_STATION_ROWS,    \
+      .screen = LCD_SCREEN_STATION,       \
+      .backlight = LCD_BACKLIGHT,         \
+      LCD_DISPLAY_TIMING_INIT}
+
+static lcd_display_t lcd_displays[] = {
+    {
+        .name = "main",
+        .address = LCD_I2C_ADDRESS,
+        .cols = LCD_COLS,
+        .rows = LCD_ROWS,
+        .screen = LCD_SCREEN_CONTROL,
+        .backlight = LCD_BACKLIGHT,
+        LCD_DISPLAY_TIMING_INIT},
+#if CONFIG_LCD_STATION_COUNT >= 1
+    LCD_STATION_DISPLAY(1, CONFIG_LCD_STATION1_ADDRESS),
+#endif
+#if CONFIG_LCD_STATION_COUNT >= 2
+    LCD_STATION_DISPLAY(2, CONFIG_LCD_STATION2_ADDRESS),
+#endif
+#if CONFIG_LCD_STATION_COUNT >= 3
+    LCD_STATION_DISPLAY(3, CONFIG_LCD_STATION3_ADDRESS),
+#endif
+};
+#define LCD_DISPLAY_COUNT (sizeof(lcd_displays) / sizeof(lcd_displays[0]))
+
 static TaskHandle_t lcd_task_handle = NULL;
-static i2c_master_dev_handle_t i2c_device_handle = NULL;
+static portMUX_TYPE lcd_ticker_lock = portMUX_INITIALIZER_UNLOCKED;
 static i2c_master_bus_handle_t i2c_bus_handle = NULL;
-static uint8_t lcd_backlight_status = LCD_BACKLIGHT;
+static SemaphoreHandle_t i2c_bus_mutex = NULL; // see lcd_bus_lock()
 
-static char lcd_buffer[LCD_BUFFER_DEPTH][LCD_BUFFER_SIZE]; // 2x80-byte buffer for the LCD
-static uint8_t lcd_buffer_index_active = 0;
-static uint8_t lcd_buffer_index_draw = 1;
 static bool isRendering = false;
 //static bool next_render_requested = false;
 
+/* drawing target of the screen functions */
+static lcd_display_t *lcd_target = &lcd_displays[0];
 static uint8_t cursor_col = 0;
 static uint8_t cursor_row = 0;
 
+/* scheduler state */
+static uint8_t lcd_rr_next = 1;       // station served first in the next round
+static int64_t lcd_window_start_us = 0; // bus utilization window
+static uint64_t lcd_window_busy_us = 0;
+static uint8_t lcd_bus_utilization = 0; // percent, last completed window
+
+/* benchmark */
+static volatile bool lcd_bench_requested = false;
+static lcd_bench_result_t lcd_bench_result;
+
 // Forward declarations
 
-void lcd_set_cursor_position(uint8_t col, uint8_t row);
-void lcd_set_cursor(uint8_t col, uint8_t row);
-void lcd_clear_buffer(void);
-void lcd_write_character(char c);
-void lcd_write_text(const char *str);
-void lcd_write_textf(const char *str, size_t size, ...);
-void lcd_write_buffer(const char *buffer, size_t size);
-void lcd_toggle_backlight(bool state);
 void lcd_render(void);
 void lcd_render_cycle();
 void lcd_update_task(void *pvParameter);
 
-void constant_screen(const char *content);
-void screen_clock(void);
-void screen_settings(void);
-void screen_editing(void);
+void screen_splash(lcd_widget_t *w);
+void screen_restarting(lcd_widget_t *w);
+void screen_clock(lcd_widget_t *w);
+void screen_settings(lcd_widget_t *w);
+void screen_edit_datetime(lcd_widget_t *w);
+void screen_edit_timescale(lcd_widget_t *w);
 void screen_lcd_test(void);
-
-static void lcd_init_cycle(void);
-static esp_err_t i2c_send_with_toggle(uint8_t data);
-static esp_err_t i2c_send_4bit_data(uint8_t data, uint8_t rs);
-static bool compare_double_buffer(void);
+void screen_lcd_bench(lcd_widget_t *w);
+void screen_station(lcd_widget_t *w);
+static const lcd_screen_def_t *lcd_screen_for(const lcd_display_t *disp);
+
+static esp_err_t lcd_init_cycle(lcd_display_t *disp);
+static void lcd_recover(lcd_display_t *disp);
+static void lcd_compose(lcd_display_t *disp);
+static uint32_t lcd_flush(lcd_display_t *disp, uint32_t credit);
+static void lcd_update_stats(void);
+static esp_err_t lcd_set_cursor_position(lcd_display_t *disp, uint8_t col, uint8_t row);
+static esp_err_t lcd_set_ddram_address(lcd_display_t *disp, uint8_t line, uint8_t pos);
+static esp_err_t i2c_send_with_toggle(lcd_display_t *disp, uint8_t data);
+static esp_err_t i2c_send_4bit_data(lcd_display_t *disp, uint8_t data, uint8_t rs);
+static esp_err_t lcd_set_backlight(lcd_display_t *disp, bool state);
+static esp_err_t lcd_transmit(lcd_display_t *disp, const uint8_t *data, size_t len);
+static void lcd_delay_us(lcd_display_t *disp, uint32_t us);
+static void lcd_run_benchmark(void);
+static void lcd_ticker_apply_request(lcd_display_t *disp);
+static uint32_t lcd_ticker_flush(lcd_display_t *disp, uint32_t credit);
+
+#if CONFIG_LCD_ADAPTIVE_TIMING
+static void lcd_wait_ready(lcd_display_t *disp);
+static void lcd_set_busy_for(lcd_display_t *disp, uint32_t us);
+static esp_err_t lcd_read_busy_flag(lcd_display_t *disp, bool *busy);
+static esp_err_t lcd_poll_busy_flag(lcd_display_t *disp, uint32_t timeout_us);
+static esp_err_t lcd_calibrate_timing(lcd_display_t *disp);
+#endif
 
 static void lcd_event_handler(void *handler_arg, esp_event_base_t base, int32_t id, void *event_data);
 
@@ -81,56 +218,266 @@ void lcd_render_cycle()
   }
   isRendering = true;
 
-  switch (state_ctx.state)
+  if (lcd_bench_requested)
   {
-  case STATE_INIT:
-    constant_screen(SPLASH_SCREEN_CONTENT);
-    break;
-  case STATE_RESTART:
-    constant_screen(RESTART_SCREEN_CONTENT);
-    break;
-  case STATE_CLOCK:
-    screen_clock();
-    break;
-  case STATE_MENU:
-    screen_settings();
-    break;
-  case STATE_EDIT:
-    screen_editing();
-    break;
-  case STATE_LCD_TEST:
-    screen_lcd_test();
-    break;
-  default:
-    break;
+    lcd_run_benchmark();
+    lcd_bench_requested = false;
+  }
+
+  for (uint8_t i = 0; i < LCD_DISPLAY_COUNT; i++)
+  {
+    if (!lcd_displays[i].present)
+      continue;
+    if (!lcd_displays[i].online)
+      lcd_recover(&lcd_displays[i]);
+    lcd_ticker_apply_request(&lcd_displays[i]);
+    if (lcd_displays[i].online)
+      lcd_compose(&lcd_displays[i]);
   }
+  lcd_target = &lcd_displays[0];
 
   lcd_render();
+#if CONFIG_LCD_MIRROR
+  lcd_mirror_frame(lcd_displays[0].buffer[LCD_BUFFER_DRAW], lcd_displays[0].cols, lcd_displays[0].rows);
+#endif
   isRendering = false;
 }
 
-// Render the buffer to the LCD
-void lcd_render(void)
+// Bring the draw buffer of a display up to date. Only widgets whose data changed are
+// redrawn; entering another screen clears the buffer and redraws all of its widgets.
+static void lcd_compose(lcd_display_t *disp)
 {
-  // Compare the two buffers
-  if (compare_double_buffer())
+  lcd_target = disp;
+
+  const lcd_screen_def_t *def = lcd_screen_for(disp);
+  if (def != disp->screen_def)
+  {
+    disp->screen_def = def;
+    memcpy(disp->widgets, def->layout, def->count * sizeof(lcd_widget_t));
+    for (uint8_t i = 0; i < def->count; i++)
+      lcd_widget_invalidate(&disp->widgets[i]);
+    lcd_clear_buffer();
+  }
+
+  if (def->render)
   {
+    def->render();
     return;
   }
 
-  // Swap the buffers
-  lcd_buffer_index_active = lcd_buffer_index_draw;
-  lcd_buffer_index_draw = (lcd_buffer_index_draw + 1) % LCD_BUFFER_DEPTH;
+  def->update(disp->widgets);
+  for (uint8_t i = 0; i < def->count; i++)
+  {
+    if (disp->widgets[i].dirty)
+      lcd_widget_draw(&disp->widgets[i]);
+  }
+}
+
+// Send the changed cells of all displays. The main display goes first and is not limited,
+// the stations share the remaining bus budget of the frame round-robin, so a station with a
+// large diff spreads it over several frames instead of delaying the clock.
+void lcd_render(void)
+{
+  int64_t start = esp_timer_get_time();
+
+  lcd_flush(&lcd_displays[0], UINT32_MAX);
 
-  // Send the buffer to the LCD
-  for (uint8_t row = 0; row < LCD_ROWS; row++)
+  if (LCD_DISPLAY_COUNT > 1)
+  {
+    uint32_t budget = LCD_BUS_BYTES_PER_FRAME * CONFIG_LCD_BUS_BUDGET_PCT / 100;
+    uint32_t quantum = budget / (LCD_DISPLAY_COUNT - 1);
+
+    for (uint8_t n = 0; n < LCD_DISPLAY_COUNT - 1; n++)
+    {
+      lcd_display_t *disp = &lcd_displays[1 + (lcd_rr_next - 1 + n) % (LCD_DISPLAY_COUNT - 1)];
+      if (!disp->present || !disp->online)
+        continue;
+
+      // unused credit does not pile up beyond one extra quantum
+      disp->deficit += quantum;
+      if (disp->deficit > 2 * quantum)
+        disp->deficit = 2 * quantum;
+      disp->deficit -= lcd_flush(disp, disp->deficit);
+    }
+    lcd_rr_next = 1 + lcd_rr_next % (LCD_DISPLAY_COUNT - 1);
+  }
+
+  lcd_window_busy_us += esp_timer_get_time() - start;
+  lcd_update_stats();
+}
+
+// Cost of writing one byte (command or character) to a backpack, in bytes on the wire
+static inline uint32_t lcd_write_cost(void)
+{
+  return LCD_WIRE_BYTES_PER_WRITE;
+}
+
+// DDRAM position of a visible cell within its line, the display shift moves the window
+static inline uint8_t lcd_ddram_pos(const lcd_display_t *disp, uint8_t row, uint8_t col)
+{
+  return ((row / 2) * disp->cols + col + disp->shift) % LCD_DDRAM_LINE_LEN;
+}
+
+static inline bool lcd_row_in_ticker(const lcd_display_t *disp, uint8_t row)
+{
+  return disp->ticker.active && row % 2 == disp->ticker.line;
+}
+
+// A cell is pending when it was written since it was last sent and differs from the glass.
+// Cells without a dirty bit always match what is shown.
+static inline bool lcd_cell_pending(const lcd_display_t *disp, uint8_t row, uint8_t col)
+{
+  uint16_t idx = row * disp->cols + col;
+  return (disp->dirty[row] & (1UL << col)) &&
+         disp->buffer[LCD_BUFFER_SHOWN][idx] != disp->buffer[LCD_BUFFER_DRAW][idx];
+}
+
+// Send runs of changed cells until the display is in sync or the credit is used up.
+// Returns the wire bytes spent.
+static uint32_t lcd_flush(lcd_display_t *disp, uint32_t credit)
+{
+  if (!disp->present || !disp->online)
+    return 0;
+
+  char *shown = disp->buffer[LCD_BUFFER_SHOWN];
+  const char *draw = disp->buffer[LCD_BUFFER_DRAW];
+  uint32_t spent = 0;
+  bool dirty = false;
+  int64_t start = esp_timer_get_time();
+
+  if (disp->ticker.active)
+    spent += lcd_ticker_flush(disp, credit);
+
+  for (uint8_t row = 0; row < disp->rows; row++)
   {
-    lcd_set_cursor_position(0, row);
-    for (uint8_t col = 0; col < LCD_COLS; col++)
+    if (lcd_row_in_ticker(disp, row))
+      continue;
+
+    uint8_t col = 0;
+    while (col < disp->cols && (disp->dirty[row] >> col) != 0)
     {
-      ESP_ERROR_CHECK(i2c_send_4bit_data(lcd_buffer[lcd_buffer_index_active][row * LCD_COLS + col], LCD_RS_DATA));
+      if (!lcd_cell_pending(disp, row, col))
+      {
+        disp->dirty[row] &= ~(1UL << col);
+        col++;
+        continue;
+      }
+
+      // run of changed cells; a single unchanged cell is cheaper to resend than to skip
+      uint8_t end = col + 1;
+      while (end < disp->cols)
+      {
+        if (lcd_cell_pending(disp, row, end))
+          end++;
+        else if (end + 1 < disp->cols && lcd_cell_pending(disp, row, end + 1))
+          end += 2;
+        else
+          break;
+      }
+
+      // the address counter does not wrap within a DDRAM line
+      uint8_t wrap = col + LCD_DDRAM_LINE_LEN - lcd_ddram_pos(disp, row, col);
+      if (end > wrap)
+        end = wrap;
+
+      uint32_t len = end - col;
+      if (spent + (len + 1) * lcd_write_cost() > credit)
+      {
+        // send what fits, the rest goes out in a later frame
+        uint32_t left = (credit - spent) / lcd_write_cost();
+        if (left < 2)
+        {
+          dirty = true;
+          goto out;
+        }
+        len = left - 1;
+        end = col + len;
+        dirty = true;
+      }
+
+      if (disp->frame_start_us == 0)
+        disp->frame_start_us = start;
+
+      spent += (len + 1) * lcd_write_cost();
+      if (lcd_set_cursor_position(disp, col, row) != ESP_OK)
+      {
+        // display went offline, it is redrawn completely once recovered
+        dirty = true;
+        goto out;
+      }
+      for (uint8_t c = col; c < end; c++)
+      {
+        uint16_t i = row * disp->cols + c;
+        if (i2c_send_4bit_data(disp, draw[i], LCD_RS_DATA) != ESP_OK)
+        {
+          dirty = true;
+          goto out;
+        }
+        shown[i] = draw[i];
+        disp->ddram[row % 2][lcd_ddram_pos(disp, row, c)] = draw[i];
+        disp->dirty[row] &= ~(1UL << c);
+      }
+      col = end;
     }
   }
+
+out:
+  disp->stats.bytes += spent;
+  disp->stats.busy_us += esp_timer_get_time() - start;
+
+  if (!dirty && disp->frame_start_us != 0)
+  {
+    // frame complete: from its first transfer until the display is in sync
+    uint32_t frame_us = (uint32_t)(esp_timer_get_time() - disp->frame_start_us);
+    disp->frame_start_us = 0;
+    disp->stats.frames++;
+    disp->stats.frame_us_last = frame_us;
+    disp->stats.frame_us_total += frame_us;
+    if (frame_us > disp->stats.frame_us_max)
+      disp->stats.frame_us_max = frame_us;
+    if (disp == &lcd_displays[0])
+      input_latency_mark(INPUT_LAT_FRAME);
+  }
+
+  return spent;
+}
+
+static void lcd_update_stats(void)
+{
+  int64_t now = esp_timer_get_time();
+  if (lcd_window_start_us == 0)
+  {
+    lcd_window_start_us = now;
+    return;
+  }
+
+  int64_t window = now - lcd_window_start_us;
+  if (window < LCD_STATS_PERIOD_S * 1000000LL)
+    return;
+
+  lcd_bus_utilization = (uint8_t)(lcd_window_busy_us * 100 / window);
+  lcd_window_start_us = now;
+  lcd_window_busy_us = 0;
+
+  ESP_LOGI(TAG, "Bus utilization %u%%", lcd_bus_utilization);
+  for (uint8_t i = 0; i < LCD_DISPLAY_COUNT; i++)
+  {
+    const lcd_display_t *disp = &lcd_displays[i];
+    if (!disp->present)
+      continue;
+    ESP_LOGI(TAG, "  %s@0x%02x: frames=%lu last=%luus avg=%luus max=%luus bytes=%lu errors=%lu",
+             disp->name, disp->address, disp->stats.frames, disp->stats.frame_us_last,
+             disp->stats.frames ? (uint32_t)(disp->stats.frame_us_total / disp->stats.frames) : 0,
+             disp->stats.frame_us_max, disp->stats.bytes, disp->stats.errors);
+    if (disp->stats.errors)
+      ESP_LOGI(TAG, "  %s@0x%02x: %s, retries=%lu outages=%lu recoveries=%lu", disp->name, disp->address,
+               disp->online ? "online" : "offline", disp->stats.retries, disp->stats.outages, disp->stats.recoveries);
+  }
+#if CONFIG_LCD_MIRROR
+  lcd_mirror_stats_t mirror;
+  lcd_mirror_get_stats(&mirror);
+  ESP_LOGI(TAG, "  mirror: keyframes=%lu deltas=%lu bytes=%lu", mirror.keyframes, mirror.deltas, mirror.bytes);
+#endif
 }
 
 void lcd_update_task(void *pvParameter)
@@ -140,11 +487,19 @@ void lcd_update_task(void *pvParameter)
   // Wait for the current render to finish
   while (isRendering)
     vTaskDelay(pdMS_TO_TICKS(10));
-  
+
   for (;;)
   {
+    // a running ticker needs its steps in between the frames
+    uint32_t wait_ms = 1000 / LCD_FPS;
+    for (uint8_t i = 0; i < LCD_DISPLAY_COUNT; i++)
+    {
+      if (lcd_displays[i].ticker.active && wait_ms > CONFIG_LCD_TICKER_STEP_MS)
+        wait_ms = CONFIG_LCD_TICKER_STEP_MS;
+    }
+
     // Wait until either timeout (frame) or a notification triggers immediate render
-    if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000 / LCD_FPS)) > 0)
+    if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait_ms)) > 0)
     {
       // notification: render immediately
       lcd_render_cycle();
@@ -157,159 +512,548 @@ void lcd_update_task(void *pvParameter)
   }
 }
 
-// -----------------
-// LCD Screens
-// -----------------
+uint8_t lcd_get_display_count(void)
+{
+  return LCD_DISPLAY_COUNT;
+}
 
-void constant_screen(const char *content)
+bool lcd_get_display_stats(uint8_t idx, lcd_display_stats_t *out)
 {
-  // Display the splash screen on the LCD
-  lcd_clear_buffer();
-  lcd_set_cursor(0, 0);
-  lcd_write_buffer(content, strlen(content));
+  if (idx >= LCD_DISPLAY_COUNT || !lcd_displays[idx].present)
+    return false;
+  *out = lcd_displays[idx].stats;
+  return true;
 }
 
-void screen_clock(void)
+bool lcd_is_display_online(uint8_t idx)
 {
-  lcd_clear_buffer();
+  return idx < LCD_DISPLAY_COUNT && lcd_displays[idx].present && lcd_displays[idx].online;
+}
 
-  // Real time in the first line
-  lcd_set_cursor(0, 0);
-  char bufR[21];
-  time_t now = time(NULL);
-  format_datetime_lcd(now, bufR, sizeof(bufR));
-  lcd_write_buffer(bufR, strlen(bufR));
+uint8_t lcd_get_bus_utilization(void)
+{
+  return lcd_bus_utilization;
+}
 
-  // Model time in the second line
-  lcd_set_cursor(0, 1);
-  char bufM[21];
-  format_datetime_lcd(unix_ts, bufM, sizeof(bufM));
-  lcd_write_buffer(bufM, strlen(bufM));
+i2c_master_bus_handle_t lcd_get_i2c_bus(void)
+{
+  return i2c_bus_handle;
+}
 
-  // App state in the last line
-  lcd_set_cursor(0, 3);
-  if (timer_is_running())
+bool lcd_uses_address(uint8_t address)
+{
+  for (uint8_t i = 0; i < LCD_DISPLAY_COUNT; i++)
   {
-    lcd_write_text("RUNNING");
+    if (lcd_displays[i].address == address)
+      return true;
   }
-  else
+  return false;
+}
+
+// The driver queues single transfers of all devices on the bus, but not the bus reset of
+// lcd_recover(): it must not hit another device in the middle of a transaction.
+void lcd_bus_lock(void)
+{
+  xSemaphoreTake(i2c_bus_mutex, portMAX_DELAY);
+}
+
+void lcd_bus_unlock(void)
+{
+  xSemaphoreGive(i2c_bus_mutex);
+}
+
+// -----------------
+// Ticker
+// -----------------
+
+bool lcd_ticker_start(uint8_t display, uint8_t row, const char *text)
+{
+  if (display >= LCD_DISPLAY_COUNT || row >= lcd_displays[display].rows)
+    return false;
+
+  lcd_display_t *disp = &lcd_displays[display];
+  size_t len = strnlen(text, LCD_TICKER_MAX);
+
+  portENTER_CRITICAL(&lcd_ticker_lock);
+  memset(&disp->ticker_req, 0, sizeof(disp->ticker_req));
+  memcpy(disp->ticker_req.text, text, len);
+  // a short text is shown once per loop, a long one gets a gap before it starts over
+  size_t padded = len + LCD_TICKER_GAP;
+  if (padded < LCD_DDRAM_LINE_LEN)
+    padded = LCD_DDRAM_LINE_LEN;
+  memset(disp->ticker_req.text + len, ' ', padded - len);
+  disp->ticker_req.len = padded;
+  disp->ticker_req.line = row % 2;
+  disp->ticker_req.active = true;
+  disp->ticker_req.reload = true;
+  disp->ticker_req_pending = true;
+  portEXIT_CRITICAL(&lcd_ticker_lock);
+
+  if (lcd_task_handle)
+    xTaskNotifyGive(lcd_task_handle);
+  return true;
+}
+
+void lcd_ticker_stop(uint8_t display)
+{
+  if (display >= LCD_DISPLAY_COUNT)
+    return;
+
+  portENTER_CRITICAL(&lcd_ticker_lock);
+  lcd_displays[display].ticker_req.active = false;
+  lcd_displays[display].ticker_req_pending = true;
+  portEXIT_CRITICAL(&lcd_ticker_lock);
+
+  if (lcd_task_handle)
+    xTaskNotifyGive(lcd_task_handle);
+}
+
+// Resync the shown buffer of the given rows with the DDRAM mirror and mark the cells that
+// differ from the draw buffer
+static void lcd_resync_rows(lcd_display_t *disp, bool ticker_line)
+{
+  for (uint8_t row = 0; row < disp->rows; row++)
   {
-    lcd_write_text("PAUSED");
+    if ((row % 2 == disp->ticker.line) != ticker_line)
+      continue;
+    for (uint8_t col = 0; col < disp->cols; col++)
+    {
+      uint16_t i = row * disp->cols + col;
+      disp->buffer[LCD_BUFFER_SHOWN][i] = disp->ddram[row % 2][lcd_ddram_pos(disp, row, col)];
+      if (disp->buffer[LCD_BUFFER_SHOWN][i] != disp->buffer[LCD_BUFFER_DRAW][i])
+        disp->dirty[row] |= 1UL << col;
+    }
   }
-  lcd_set_cursor(17, 3);
-  lcd_write_text("x");
-  uint32_t app_scale = timer_get_timescale();
-  lcd_write_textf("%02d", 2, app_scale);
 }
 
-void screen_settings(void)
+// Take over a start/stop request from another task
+static void lcd_ticker_apply_request(lcd_display_t *disp)
 {
-  lcd_clear_buffer();
+  if (!disp->ticker_req_pending)
+    return;
 
-  int count = get_menu_count();
-  int start = get_menu_scroll_top();
+  bool was_active = disp->ticker.active;
+  uint8_t old_line = disp->ticker.line;
 
-  int max_start = count > LCD_ROWS ? count - LCD_ROWS : 0;
+  portENTER_CRITICAL(&lcd_ticker_lock);
+  disp->ticker = disp->ticker_req;
+  disp->ticker_req_pending = false;
+  portEXIT_CRITICAL(&lcd_ticker_lock);
 
-  // clamp start into valid range:
-  if (start < 0)
-    start = 0;
-  if (start > max_start)
-    start = max_start;
+  if (was_active && (!disp->ticker.active || old_line != disp->ticker.line))
+  {
+    // the rows of the old line show the screen again, drawn from the mirror
+    uint8_t line = disp->ticker.line;
+    disp->ticker.line = old_line;
+    lcd_resync_rows(disp, true);
+    disp->ticker.line = line;
+  }
+}
 
-  int selected = get_menu_selected();
+// Character the ticker wants at a DDRAM position of its line
+static inline char lcd_ticker_char(const lcd_display_t *disp, uint8_t pos)
+{
+  const lcd_ticker_t *t = &disp->ticker;
+  uint8_t offset = (pos + LCD_DDRAM_LINE_LEN - disp->shift) % LCD_DDRAM_LINE_LEN;
+  return t->text[(t->head + offset) % t->len];
+}
 
-  for (int row = 0; row < LCD_ROWS; ++row)
+// The display shift moves both DDRAM lines. It only pays off while the other line is blank,
+// on the glass and in the draw buffer; otherwise every step would resend that line too.
+static bool lcd_other_line_blank(const lcd_display_t *disp)
+{
+  uint8_t other = 1 - disp->ticker.line;
+  for (uint8_t pos = 0; pos < LCD_DDRAM_LINE_LEN; pos++)
   {
-    int idx = start + row;
-    if (idx >= count)
-      break;
+    if (disp->ddram[other][pos] != ' ')
+      return false;
+  }
+  for (uint8_t row = other; row < disp->rows; row += 2)
+  {
+    for (uint8_t col = 0; col < disp->cols; col++)
+    {
+      if (disp->buffer[LCD_BUFFER_DRAW][row * disp->cols + col] != ' ')
+        return false;
+    }
+  }
+  return true;
+}
+
+static void lcd_ticker_advance(lcd_ticker_t *t, int64_t now)
+{
+  t->head = (t->head + 1) % t->len;
+  t->next_step_us += CONFIG_LCD_TICKER_STEP_MS * 1000LL;
+  if (t->next_step_us < now)
+    t->next_step_us = now + CONFIG_LCD_TICKER_STEP_MS * 1000LL;
+}
 
-    // cursor caret
-    if (selected == idx)
+// Step without the display shift: rewrite the visible rows of the ticker line
+static uint32_t lcd_ticker_step_rows(lcd_display_t *disp, uint32_t credit, int64_t now)
+{
+  lcd_ticker_t *t = &disp->ticker;
+  uint8_t rows = (disp->rows - t->line + 1) / 2;
+  uint32_t cost = rows * (disp->cols + 2) * lcd_write_cost();
+  if (cost > credit)
+    return 0;
+
+  lcd_ticker_advance(t, now);
+  for (uint8_t row = t->line; row < disp->rows; row += 2)
+  {
+    for (uint8_t col = 0; col < disp->cols; col++)
     {
-      lcd_set_cursor(0, row);
-      lcd_write_character((char)0x7E);
+      uint8_t pos = lcd_ddram_pos(disp, row, col);
+      // the address counter does not wrap within a DDRAM line
+      if ((col == 0 || pos == 0) && lcd_set_ddram_address(disp, t->line, pos) != ESP_OK)
+        return cost;
+      char c = lcd_ticker_char(disp, pos);
+      if (i2c_send_4bit_data(disp, c, LCD_RS_DATA) != ESP_OK)
+        return cost;
+      disp->ddram[t->line][pos] = c;
     }
+  }
+  return cost;
+}
 
-    // menu item
-    const menu_entry_t *item = get_menu_item(idx);
-    if (item)
+// Load the text into the ticker line, then advance it one step per CONFIG_LCD_TICKER_STEP_MS:
+// one shift command plus the cell that just left the window, which becomes the end of the
+// loop. All rows move with the shift, so this is only done while the other line is blank;
+// otherwise the visible rows of the ticker line are rewritten per step.
+// Returns the wire bytes spent.
+static uint32_t lcd_ticker_flush(lcd_display_t *disp, uint32_t credit)
+{
+  lcd_ticker_t *t = &disp->ticker;
+  char *line = disp->ddram[t->line];
+  int64_t now = esp_timer_get_time();
+
+  if (t->reload)
+  {
+    uint32_t cost = (LCD_DDRAM_LINE_LEN + 1) * lcd_write_cost();
+    if (cost > credit)
+      return 0;
+
+    if (lcd_set_ddram_address(disp, t->line, 0) != ESP_OK)
+      return cost;
+    for (uint8_t pos = 0; pos < LCD_DDRAM_LINE_LEN; pos++)
     {
-      lcd_set_cursor(2, row);
-      lcd_write_buffer(item->label, strnlen(item->label, LCD_COLS - 2)); // safe length
+      line[pos] = lcd_ticker_char(disp, pos);
+      if (i2c_send_4bit_data(disp, line[pos], LCD_RS_DATA) != ESP_OK)
+        return cost;
     }
+    t->reload = false;
+    t->rows_only = false;
+    t->next_step_us = now + CONFIG_LCD_TICKER_STEP_MS * 1000LL;
+    return cost;
   }
 
-  if (start > 0)
+  if (now < t->next_step_us)
+    return 0;
+
+  bool blank = lcd_other_line_blank(disp);
+  if (t->rows_only && blank)
   {
-    lcd_set_cursor(LCD_COLS - 1, 0);
-    lcd_write_text("^");
+    // back to shifting; the off-screen cells were not kept up to date meanwhile
+    t->reload = true;
+    return 0;
   }
-  if (start + LCD_ROWS < count)
+  t->rows_only = !blank;
+  if (t->rows_only)
+    return lcd_ticker_step_rows(disp, credit, now);
+
+  if (3 * lcd_write_cost() > credit)
+    return 0;
+
+  uint32_t spent = lcd_write_cost();
+  if (i2c_send_4bit_data(disp, COMMAND_SHIFT_LEFT, LCD_RS_CMD) != ESP_OK)
+    return spent;
+  uint8_t left = disp->shift;
+  disp->shift = (disp->shift + 1) % LCD_DDRAM_LINE_LEN;
+  lcd_ticker_advance(t, now);
+
+  char c = lcd_ticker_char(disp, left);
+  if (line[left] != c)
   {
-    lcd_set_cursor(LCD_COLS - 1, LCD_ROWS - 1);
-    lcd_write_text("v");
+    spent += 2 * lcd_write_cost();
+    if (lcd_set_ddram_address(disp, t->line, left) != ESP_OK ||
+        i2c_send_4bit_data(disp, c, LCD_RS_DATA) != ESP_OK)
+      return spent;
+    line[left] = c;
   }
+
+  return spent;
 }
 
-void screen_editing(void)
+// -----------------
+// Benchmark
+// -----------------
+
+void lcd_bench_start(void)
 {
-  edit_mode_t mode = get_edit_mode();
-  lcd_clear_buffer();
-  
-  // Headline
-  lcd_set_cursor(0, 0);
-  if (mode == EDIT_REALTIME)
+  lcd_bench_requested = true;
+  if (lcd_task_handle)
+    xTaskNotifyGive(lcd_task_handle);
+}
+
+bool lcd_bench_get_result(lcd_bench_result_t *out)
+{
+  *out = lcd_bench_result;
+  return lcd_bench_result.valid;
+}
+
+// Worst case: every cell changes on every frame
+static void bench_frame_worst(uint32_t frame)
+{
+  for (uint8_t i = 0; i < LCD_BUFFER_SIZE; i++)
   {
-    lcd_write_text("Realtime:");
+    lcd_set_cursor(i % LCD_COLS, i / LCD_COLS);
+    lcd_write_character('A' + (i + frame) % 26);
   }
-  else if (mode == EDIT_MODELTIME)
+}
+
+// Typical: the clock screen with real and model time ticking, model time at 1:4
+static void bench_frame_typical(uint32_t frame)
+{
+  char buf[21];
+  format_datetime_lcd(DEFAULT_REAL_TS + frame, buf, sizeof(buf));
+  lcd_set_cursor(0, 0);
+  lcd_write_text(buf);
+  format_datetime_lcd(DEFAULT_UNIX_TS + frame * 4, buf, sizeof(buf));
+  lcd_set_cursor(0, 1);
+  lcd_write_text(buf);
+  lcd_set_cursor(0, 3);
+  lcd_write_text("RUNNING          x04");
+}
+
+// Stream frames as fast as the bus allows and record the counter deltas
+static void bench_phase(lcd_display_t *disp, void (*frame_fn)(uint32_t), uint32_t frames, lcd_bench_phase_t *out)
+{
+  lcd_display_stats_t before = disp->stats;
+  int64_t start = esp_timer_get_time();
+
+  for (uint32_t f = 0; f < frames; f++)
   {
-    lcd_write_text("Modeltime:");
+    frame_fn(f);
+    lcd_flush(disp, UINT32_MAX);
   }
-  else if (mode == EDIT_TIMESCALE)
+
+  out->frames = frames;
+  out->elapsed_us = (uint32_t)(esp_timer_get_time() - start);
+  out->bytes = disp->stats.bytes - before.bytes;
+  out->errors = disp->stats.errors - before.errors;
+  out->delay_us = (uint32_t)(disp->stats.delay_us - before.delay_us);
+}
+
+static void bench_log_phase(const char *name, const lcd_bench_phase_t *p)
+{
+  ESP_LOGI(TAG, "  %-7s %lu frames in %lu us: %lu.%lu fps, %lu B/frame, %lu errors, delay %lu us (%lu us/frame)",
+           name, p->frames, p->elapsed_us, LCD_BENCH_FPS_X10(p) / 10, LCD_BENCH_FPS_X10(p) % 10,
+           p->bytes / p->frames, p->errors, p->delay_us, p->delay_us / p->frames);
+}
+
+// Runs on the LCD task, the other displays are not updated meanwhile
+static void lcd_run_benchmark(void)
+{
+  lcd_display_t *disp = &lcd_displays[0];
+  if (!disp->online)
   {
-    lcd_write_text("Timescale:");
+    ESP_LOGW(TAG, "Benchmark skipped, %s is offline", disp->name);
+    return;
   }
-  
+  lcd_target = disp;
 
-  // Time
-  if (mode == EDIT_REALTIME || mode == EDIT_MODELTIME)
-  {
-    lcd_set_cursor(0, 1);
-    int32_t ts_val = get_edit_timestamp();
-    struct tm tm;
-    ts_to_tm(ts_val, &tm);
-    lcd_write_textf("%04d-%02d-%02d  %02d:%02d:%02d", 20, tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+#if CONFIG_LCD_ADAPTIVE_TIMING
+  const char *timing = "adaptive";
+#else
+  const char *timing = "fixed";
+#endif
+  ESP_LOGI(TAG, "Benchmark on %s@0x%02x, I2C %d Hz, %s timing", disp->name, disp->address, I2C_MASTER_FREQ_HZ, timing);
 
-    int8_t cursor = get_edit_cursor();
-    // positions: 0, 5, 8, 12, 15, 18
-    if (cursor == 0)
-      lcd_set_cursor(0, 2);
-    else if ( cursor < 3)
-      lcd_set_cursor(2 + cursor * 3, 2);
-    else
-      lcd_set_cursor(3 + cursor * 3, 2);
-    
-    lcd_write_text(cursor == 0 ? "^^^^" : "^^");
-  }
-  else if (mode == EDIT_TIMESCALE)
+  lcd_clear_buffer();
+  bench_phase(disp, bench_frame_worst, LCD_BENCH_FRAMES_WORST, &lcd_bench_result.worst);
+  lcd_clear_buffer();
+  lcd_flush(disp, UINT32_MAX);
+  bench_phase(disp, bench_frame_typical, LCD_BENCH_FRAMES_TYPICAL, &lcd_bench_result.typical);
+  lcd_bench_result.valid = true;
+
+  bench_log_phase("worst", &lcd_bench_result.worst);
+  bench_log_phase("typical", &lcd_bench_result.typical);
+
+  // redraw whatever screen comes next from scratch
+  disp->screen_def = NULL;
+}
+
+// -----------------
+// LCD Screens
+// -----------------
+
+/* Splash / restart: four constant rows */
+static const lcd_widget_t CONSTANT_LAYOUT[] = {
+    LCD_LABEL(0, 0, LCD_COLS),
+    LCD_LABEL(0, 1, LCD_COLS),
+    LCD_LABEL(0, 2, LCD_COLS),
+    LCD_LABEL(0, 3, LCD_COLS),
+};
+
+static void constant_screen(lcd_widget_t *w, const char *content)
+{
+  for (uint8_t row = 0; row < LCD_ROWS; row++)
+    lcd_widget_set_text(&w[row], content + row * LCD_COLS);
+}
+
+void screen_splash(lcd_widget_t *w)
+{
+  constant_screen(w, SPLASH_SCREEN_CONTENT);
+}
+
+void screen_restarting(lcd_widget_t *w)
+{
+  constant_screen(w, RESTART_SCREEN_CONTENT);
+}
+
+/* Clock: real time, model time, run state and timescale */
+enum
+{
+  CLOCK_REAL,
+  CLOCK_MODEL,
+  CLOCK_STATE,
+  CLOCK_X,
+  CLOCK_SCALE,
+};
+static const lcd_widget_t CLOCK_LAYOUT[] = {
+    [CLOCK_REAL] = LCD_TIME(0, 0, 20, LCD_TIME_DATETIME),
+    [CLOCK_MODEL] = LCD_TIME(0, 1, 20, LCD_TIME_DATETIME),
+    [CLOCK_STATE] = LCD_LABEL(0, 3, 7),
+    [CLOCK_X] = LCD_LABEL(17, 3, 1),
+    [CLOCK_SCALE] = LCD_NUMBER(18, 3, 2, "%02d"),
+};
+
+void screen_clock(lcd_widget_t *w)
+{
+  lcd_widget_set_time(&w[CLOCK_REAL], time(NULL));
+  lcd_widget_set_time(&w[CLOCK_MODEL], unix_ts);
+  lcd_widget_set_text(&w[CLOCK_STATE], timer_is_running() ? "RUNNING" : "PAUSED");
+  lcd_widget_set_text(&w[CLOCK_X], "x");
+  lcd_widget_set_number(&w[CLOCK_SCALE], timer_get_timescale());
+}
+
+/* Settings menu */
+static const char *menu_item_label(int idx)
+{
+  const menu_entry_t *item = get_menu_item(idx);
+  return item ? item->label : NULL;
+}
+
+static const lcd_widget_t SETTINGS_LAYOUT[] = {
+    LCD_MENU_LIST(0, 0, LCD_COLS, LCD_ROWS, menu_item_label),
+};
+
+void screen_settings(lcd_widget_t *w)
+{
+  int count = get_menu_count();
+  int start = get_menu_scroll_top();
+
+  int max_start = count > LCD_ROWS ? count - LCD_ROWS : 0;
+
+  // clamp start into valid range:
+  if (start < 0)
+    start = 0;
+  if (start > max_start)
+    start = max_start;
+
+  lcd_widget_set_list(&w[0], get_menu_selected(), start, count);
+}
+
+/* Editors: headline, value, cursor marks and the button hints */
+enum
+{
+  EDIT_HEADLINE,
+  EDIT_VALUE,
+  EDIT_MARKS,
+  EDIT_BACK,
+  EDIT_OK,
+};
+static const lcd_widget_t EDIT_DATETIME_LAYOUT[] = {
+    [EDIT_HEADLINE] = LCD_LABEL(0, 0, LCD_COLS),
+    [EDIT_VALUE] = LCD_TIME(0, 1, 20, LCD_TIME_DATETIME),
+    [EDIT_MARKS] = LCD_LABEL(0, 2, LCD_COLS),
+    [EDIT_BACK] = LCD_LABEL(0, 3, 4),
+    [EDIT_OK] = LCD_LABEL(16, 3, 2),
+};
+static const lcd_widget_t EDIT_TIMESCALE_LAYOUT[] = {
+    [EDIT_HEADLINE] = LCD_LABEL(0, 0, LCD_COLS),
+    [EDIT_VALUE] = LCD_NUMBER(9, 1, 2, "%02d"),
+    [EDIT_MARKS] = LCD_LABEL(9, 2, 2),
+    [EDIT_BACK] = LCD_LABEL(0, 3, 4),
+    [EDIT_OK] = LCD_LABEL(16, 3, 2),
+};
+
+void screen_edit_datetime(lcd_widget_t *w)
+{
+  lcd_widget_set_text(&w[EDIT_HEADLINE], get_edit_mode() == EDIT_REALTIME ? "Realtime:" : "Modeltime:");
+  lcd_widget_set_time(&w[EDIT_VALUE], get_edit_timestamp());
+
+  // positions: 0, 5, 8, 12, 15, 18
+  int8_t cursor = get_edit_cursor();
+  int pos;
+  if (cursor == 0)
+    pos = 0;
+  else if (cursor < 3)
+    pos = 2 + cursor * 3;
+  else
+    pos = 3 + cursor * 3;
+
+  char marks[LCD_COLS + 1];
+  snprintf(marks, sizeof(marks), "%*s%s", pos, "", cursor == 0 ? "^^^^" : "^^");
+  lcd_widget_set_text(&w[EDIT_MARKS], marks);
+
+  lcd_widget_set_text(&w[EDIT_BACK], "BACK");
+  lcd_widget_set_text(&w[EDIT_OK], "OK");
+}
+
+void screen_edit_timescale(lcd_widget_t *w)
+{
+  lcd_widget_set_text(&w[EDIT_HEADLINE], "Timescale:");
+  lcd_widget_set_number(&w[EDIT_VALUE], get_edit_timescale());
+  lcd_widget_set_text(&w[EDIT_MARKS], "^^");
+  lcd_widget_set_text(&w[EDIT_BACK], "BACK");
+  lcd_widget_set_text(&w[EDIT_OK], "OK");
+}
+
+/* Benchmark results */
+static const lcd_widget_t BENCH_LAYOUT[] = {
+    LCD_LABEL(0, 0, LCD_COLS),
+    LCD_LABEL(0, 1, LCD_COLS),
+    LCD_LABEL(0, 2, LCD_COLS),
+    LCD_LABEL(0, 3, LCD_COLS),
+};
+
+void screen_lcd_bench(lcd_widget_t *w)
+{
+  lcd_bench_result_t r;
+  char line[LCD_COLS + 1];
+
+  snprintf(line, sizeof(line), "Bench %3dkHz  OK=run", I2C_MASTER_FREQ_HZ / 1000);
+  lcd_widget_set_text(&w[0], line);
+
+  if (!lcd_bench_get_result(&r))
   {
-    lcd_set_cursor(9, 1);
-    uint32_t timescale = get_edit_timescale();
-    lcd_write_textf("%02d", 2, timescale);
-    lcd_set_cursor(9, 2);
-    lcd_write_text("^^");
+    lcd_widget_set_text(&w[1], "Running...");
+    lcd_widget_set_text(&w[2], "");
+    lcd_widget_set_text(&w[3], "");
+    return;
   }
 
-  // buttons
-  lcd_set_cursor(0, 3);
-  lcd_write_text("BACK");
-  lcd_set_cursor(16, 3);
-  lcd_write_text("OK");
+  snprintf(line, sizeof(line), "Worst %3lu.%lufps %3luB", LCD_BENCH_FPS_X10(&r.worst) / 10,
+           LCD_BENCH_FPS_X10(&r.worst) % 10, r.worst.bytes / r.worst.frames);
+  lcd_widget_set_text(&w[1], line);
+  snprintf(line, sizeof(line), "Typ   %3lu.%lufps %3luB", LCD_BENCH_FPS_X10(&r.typical) / 10,
+           LCD_BENCH_FPS_X10(&r.typical) % 10, r.typical.bytes / r.typical.frames);
+  lcd_widget_set_text(&w[2], line);
+  snprintf(line, sizeof(line), "Err %-3lu Dly %5luus", r.worst.errors + r.typical.errors,
+           r.worst.delay_us / r.worst.frames);
+  lcd_widget_set_text(&w[3], line);
 }
 
+/* Character table, drawn completely each frame */
 void screen_lcd_test(void)
 {
   lcd_clear_buffer();
@@ -335,6 +1079,84 @@ void screen_lcd_test(void)
   }
 }
 
+/* Compact model time for the small station displays (16x2 and up) */
+enum
+{
+  STATION_TIME,
+  STATION_DATE,
+  STATION_STATE,
+};
+#if CONFIG_LCD_STATION_COUNT > 0
+static const lcd_widget_t STATION_LAYOUT[] = {
+    [STATION_TIME] = LCD_TIME((CONFIG_LCD_STATION_COLS - 8) / 2, 0, 8, LCD_TIME_HMS),
+    [STATION_DATE] = LCD_TIME(0, 1, 10, LCD_TIME_DATE),
+    [STATION_STATE] = LCD_LABEL(CONFIG_LCD_STATION_COLS - 4, 1, 4),
+};
+#else
+static const lcd_widget_t STATION_LAYOUT[] = {
+    [STATION_TIME] = LCD_TIME(6, 0, 8, LCD_TIME_HMS),
+    [STATION_DATE] = LCD_TIME(0, 1, 10, LCD_TIME_DATE),
+    [STATION_STATE] = LCD_LABEL(LCD_COLS - 4, 1, 4),
+};
+#endif
+
+void screen_station(lcd_widget_t *w)
+{
+  lcd_widget_set_time(&w[STATION_TIME], unix_ts);
+  lcd_widget_set_time(&w[STATION_DATE], unix_ts);
+  lcd_widget_set_text(&w[STATION_STATE], timer_is_running() ? "" : "STOP");
+}
+
+#define LCD_SCREEN_DEF(layout, fn) {layout, sizeof(layout) / sizeof(layout[0]), fn, NULL}
+
+static const lcd_screen_def_t SCREEN_SPLASH = LCD_SCREEN_DEF(CONSTANT_LAYOUT, screen_splash);
+static const lcd_screen_def_t SCREEN_RESTARTING = LCD_SCREEN_DEF(CONSTANT_LAYOUT, screen_restarting);
+static const lcd_screen_def_t SCREEN_CLOCK = LCD_SCREEN_DEF(CLOCK_LAYOUT, screen_clock);
+static const lcd_screen_def_t SCREEN_SETTINGS = LCD_SCREEN_DEF(SETTINGS_LAYOUT, screen_settings);
+static const lcd_screen_def_t SCREEN_EDIT_DATETIME = LCD_SCREEN_DEF(EDIT_DATETIME_LAYOUT, screen_edit_datetime);
+static const lcd_screen_def_t SCREEN_EDIT_TIMESCALE = LCD_SCREEN_DEF(EDIT_TIMESCALE_LAYOUT, screen_edit_timescale);
+static const lcd_screen_def_t SCREEN_STATION = LCD_SCREEN_DEF(STATION_LAYOUT, screen_station);
+static const lcd_screen_def_t SCREEN_LCD_TEST = {NULL, 0, NULL, screen_lcd_test};
+static const lcd_screen_def_t SCREEN_LCD_BENCH = LCD_SCREEN_DEF(BENCH_LAYOUT, screen_lcd_bench);
+
+// Screen for the assignment of a display; the control display follows the UI state
+static const lcd_screen_def_t *lcd_screen_for(const lcd_display_t *disp)
+{
+  switch (disp->screen)
+  {
+  case LCD_SCREEN_SPLASH:
+    return &SCREEN_SPLASH;
+  case LCD_SCREEN_RESTARTING:
+    return &SCREEN_RESTARTING;
+  case LCD_SCREEN_CLOCK:
+    return &SCREEN_CLOCK;
+  case LCD_SCREEN_SETTINGS:
+    return &SCREEN_SETTINGS;
+  case LCD_SCREEN_STATION:
+    return &SCREEN_STATION;
+  case LCD_SCREEN_CONTROL:
+  default:
+    break;
+  }
+
+  switch (state_ctx.state)
+  {
+  case STATE_INIT:
+    return &SCREEN_SPLASH;
+  case STATE_RESTART:
+    return &SCREEN_RESTARTING;
+  case STATE_MENU:
+    return &SCREEN_SETTINGS;
+  case STATE_EDIT:
+    return get_edit_mode() == EDIT_TIMESCALE ? &SCREEN_EDIT_TIMESCALE : &SCREEN_EDIT_DATETIME;
+  case STATE_LCD_TEST:
+    return get_lcd_test_page() == 0 ? &SCREEN_LCD_BENCH : &SCREEN_LCD_TEST;
+  case STATE_CLOCK:
+  default:
+    return &SCREEN_CLOCK;
+  }
+}
+
 // -----------------
 // Initialization
 // -----------------
@@ -350,41 +1172,133 @@ void i2c_initialize(void)
       .glitch_ignore_cnt = 7,
       .flags.enable_internal_pullup = true};
   ESP_ERROR_CHECK(i2c_new_master_bus(&i2c_bus_config, &i2c_bus_handle));
+  i2c_bus_mutex = xSemaphoreCreateMutex();
   ESP_LOGI(TAG, "I2C bus initialized");
 
-  i2c_device_config_t i2c_device_config = {
-      .dev_addr_length = I2C_ADDR_BIT_LEN_7,
-      .device_address = LCD_I2C_ADDRESS,
-      .scl_speed_hz = I2C_MASTER_FREQ_HZ};
-  ESP_ERROR_CHECK(i2c_master_bus_add_device(i2c_bus_handle, &i2c_device_config, &i2c_device_handle));
-  ESP_LOGI(TAG, "I2C device added");
+  for (uint8_t i = 0; i < LCD_DISPLAY_COUNT; i++)
+  {
+    lcd_display_t *disp = &lcd_displays[i];
+
+    // stations are optional, a missing one must not stop the clock
+    if (i > 0 && i2c_master_probe(i2c_bus_handle, disp->address, 50) != ESP_OK)
+    {
+      ESP_LOGW(TAG, "No display at 0x%02x (%s), skipping", disp->address, disp->name);
+      continue;
+    }
+
+    i2c_device_config_t i2c_device_config = {
+        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+        .device_address = disp->address,
+        .scl_speed_hz = I2C_MASTER_FREQ_HZ};
+    ESP_ERROR_CHECK(i2c_master_bus_add_device(i2c_bus_handle, &i2c_device_config, &disp->dev));
+    disp->present = true;
+    disp->online = true; // the main display is not probed, a missing one is recovered later
+    ESP_LOGI(TAG, "I2C device added: %s@0x%02x (%ux%u)", disp->name, disp->address, disp->cols, disp->rows);
+  }
   vTaskDelay(pdMS_TO_TICKS(50)); // Wait for LCD to power up
   ESP_LOGI(TAG, "I2C device initialized");
 }
 
-static void lcd_init_cycle(void)
+static esp_err_t lcd_init_cycle(lcd_display_t *disp)
 {
   // Initialize the LCD
-  ESP_ERROR_CHECK(i2c_send_with_toggle(lcd_backlight_status | LCD_ENABLE_OFF | LCD_RW_WRITE | LCD_RS_CMD));
-  ESP_ERROR_CHECK(i2c_send_with_toggle(COMMAND_8BIT_MODE | lcd_backlight_status | LCD_ENABLE_OFF | LCD_RW_WRITE | LCD_RS_CMD));
-  ESP_ERROR_CHECK(i2c_send_with_toggle(COMMAND_8BIT_MODE | lcd_backlight_status | LCD_ENABLE_OFF | LCD_RW_WRITE | LCD_RS_CMD));
-  ESP_ERROR_CHECK(i2c_send_with_toggle(COMMAND_8BIT_MODE | lcd_backlight_status | LCD_ENABLE_OFF | LCD_RW_WRITE | LCD_RS_CMD));
-  ESP_ERROR_CHECK(i2c_send_with_toggle(COMMAND_4BIT_MODE | lcd_backlight_status | LCD_ENABLE_OFF | LCD_RW_WRITE | LCD_RS_CMD));
+  LCD_TRY(i2c_send_with_toggle(disp, disp->backlight | LCD_ENABLE_OFF | LCD_RW_WRITE | LCD_RS_CMD));
+  LCD_TRY(i2c_send_with_toggle(disp, COMMAND_8BIT_MODE | disp->backlight | LCD_ENABLE_OFF | LCD_RW_WRITE | LCD_RS_CMD));
+#if CONFIG_LCD_ADAPTIVE_TIMING
+  lcd_set_busy_for(disp, 4100); // reset sequence, the busy flag is not valid yet
+#endif
+  LCD_TRY(i2c_send_with_toggle(disp, COMMAND_8BIT_MODE | disp->backlight | LCD_ENABLE_OFF | LCD_RW_WRITE | LCD_RS_CMD));
+#if CONFIG_LCD_ADAPTIVE_TIMING
+  lcd_set_busy_for(disp, 100);
+#endif
+  LCD_TRY(i2c_send_with_toggle(disp, COMMAND_8BIT_MODE | disp->backlight | LCD_ENABLE_OFF | LCD_RW_WRITE | LCD_RS_CMD));
+#if CONFIG_LCD_ADAPTIVE_TIMING
+  lcd_set_busy_for(disp, LCD_EXEC_US_DEFAULT);
+#endif
+  LCD_TRY(i2c_send_with_toggle(disp, COMMAND_4BIT_MODE | disp->backlight | LCD_ENABLE_OFF | LCD_RW_WRITE | LCD_RS_CMD));
+#if CONFIG_LCD_ADAPTIVE_TIMING
+  lcd_set_busy_for(disp, LCD_EXEC_US_DEFAULT);
+#endif
 
   for (uint8_t i = 0; i < sizeof(INIT_COMMANDS); i++)
   {
-    ESP_ERROR_CHECK(i2c_send_4bit_data(INIT_COMMANDS[i], LCD_RS_CMD));
-    ets_delay_us(1000);
+    LCD_TRY(i2c_send_4bit_data(disp, INIT_COMMANDS[i], LCD_RS_CMD));
+#if !CONFIG_LCD_ADAPTIVE_TIMING
+    lcd_delay_us(disp, 1000);
+#endif
   }
 
-  lcd_toggle_backlight(true);
-  lcd_clear_buffer();
+#if CONFIG_LCD_ADAPTIVE_TIMING
+  LCD_TRY(lcd_calibrate_timing(disp));
+#endif
+
+  LCD_TRY(lcd_set_backlight(disp, true));
+
+  // the controller was just cleared
+  memset(disp->buffer[LCD_BUFFER_SHOWN], ' ', LCD_BUFFER_SIZE);
+  memset(disp->buffer[LCD_BUFFER_DRAW], ' ', LCD_BUFFER_SIZE);
+  memset(disp->dirty, 0, sizeof(disp->dirty));
+  memset(disp->ddram, ' ', sizeof(disp->ddram));
+  disp->shift = 0;
+  disp->ticker.reload = true;
+  disp->screen_def = NULL;
+  return ESP_OK;
+}
+
+// Called each cycle while a display is offline. The first call starts the outage, later ones
+// try to bring the display back with growing intervals: bus reset (frees a slave holding SDA
+// after a half-done transfer), probe and a full re-init. Re-init clears the buffers and the
+// screen, so the next frame redraws everything.
+static void lcd_recover(lcd_display_t *disp)
+{
+  int64_t now = esp_timer_get_time();
+
+  if (disp->retry_at_us == 0)
+  {
+    disp->stats.outages++;
+    disp->backoff_ms = LCD_RECOVERY_BACKOFF_MIN_MS;
+    disp->retry_at_us = now + disp->backoff_ms * 1000LL;
+    ESP_LOGW(TAG, "%s@0x%02x: I/O failed, display offline", disp->name, disp->address);
+    return;
+  }
+  if (now < disp->retry_at_us)
+    return;
+
+  lcd_bus_lock();
+  i2c_master_bus_reset(i2c_bus_handle);
+  esp_err_t probe = i2c_master_probe(i2c_bus_handle, disp->address, LCD_I2C_TIMEOUT_MS);
+  lcd_bus_unlock();
+  if (probe == ESP_OK)
+  {
+    disp->online = true;
+    if (lcd_init_cycle(disp) == ESP_OK)
+    {
+      disp->retry_at_us = 0;
+      disp->stats.recoveries++;
+      ESP_LOGI(TAG, "%s@0x%02x: display back online", disp->name, disp->address);
+      return;
+    }
+  }
+
+  disp->online = false;
+  disp->backoff_ms *= 2;
+  if (disp->backoff_ms > LCD_RECOVERY_BACKOFF_MAX_MS)
+    disp->backoff_ms = LCD_RECOVERY_BACKOFF_MAX_MS;
+  disp->retry_at_us = esp_timer_get_time() + disp->backoff_ms * 1000LL;
+  ESP_LOGD(TAG, "%s@0x%02x: recovery failed, next try in %lu ms", disp->name, disp->address, disp->backoff_ms);
 }
 
 void lcd_initialize(void)
 {
+#if CONFIG_LCD_MIRROR
+  lcd_mirror_init();
+#endif
 
-  lcd_init_cycle();
+  for (uint8_t i = 0; i < LCD_DISPLAY_COUNT; i++)
+  {
+    if (lcd_displays[i].present)
+      lcd_init_cycle(&lcd_displays[i]); // failures are picked up by lcd_recover()
+  }
 
   lcd_render();
   lcd_render_cycle();
@@ -399,63 +1313,190 @@ void lcd_initialize(void)
 // Utility functions
 // -----------------
 
-static bool compare_double_buffer(void)
+static esp_err_t i2c_send_with_toggle(lcd_display_t *disp, uint8_t data)
 {
-  // Compare the two double buffers
-  for (uint8_t row = 0; row < LCD_ROWS; row++)
+  // Helper function to toggle the enable bit
+  uint8_t data_with_enable = data | LCD_ENABLE;
+#if CONFIG_LCD_ADAPTIVE_TIMING
+  // One I2C byte (90 us at 100 kHz) is already longer than the enable pulse width,
+  // so both edges go out in a single transfer
+  uint8_t edges[2] = {data_with_enable, data_with_enable & ~LCD_ENABLE};
+  lcd_wait_ready(disp);
+  LCD_TRY(lcd_transmit(disp, edges, sizeof(edges)));
+#else
+  LCD_TRY(lcd_transmit(disp, &data_with_enable, 1));
+  lcd_delay_us(disp, 50);
+
+  data_with_enable &= ~LCD_ENABLE;
+  LCD_TRY(lcd_transmit(disp, &data_with_enable, 1));
+  lcd_delay_us(disp, 50);
+#endif
+
+  return ESP_OK;
+}
+
+static esp_err_t i2c_send_4bit_data(lcd_display_t *disp, uint8_t data, uint8_t rs)
+{
+  // Send a byte of data to the LCD in 4-bit mode
+  uint8_t nibbles[2] = {
+      (data & 0xF0) | rs | disp->backlight | LCD_RW_WRITE,
+      ((data << 4) & 0xF0) | rs | disp->backlight | LCD_RW_WRITE};
+#if CONFIG_LCD_ADAPTIVE_TIMING
+  // Both nibbles in one transfer, the instruction starts on the last falling edge
+  uint8_t edges[4] = {
+      nibbles[0] | LCD_ENABLE, nibbles[0],
+      nibbles[1] | LCD_ENABLE, nibbles[1]};
+  lcd_wait_ready(disp);
+  LCD_TRY(lcd_transmit(disp, edges, sizeof(edges)));
+
+  bool slow = (rs == LCD_RS_CMD) && (data & 0xFE) <= 0x02; // clear display / return home
+  lcd_set_busy_for(disp, slow ? disp->timing.home_us : disp->timing.exec_us);
+#else
+  LCD_TRY(i2c_send_with_toggle(disp, nibbles[0]));
+  LCD_TRY(i2c_send_with_toggle(disp, nibbles[1]));
+#endif
+
+  return ESP_OK;
+}
+
+#if CONFIG_LCD_ADAPTIVE_TIMING
+// Mark the controller busy for the given time from now
+static void lcd_set_busy_for(lcd_display_t *disp, uint32_t us)
+{
+  disp->ready_at_us = esp_timer_get_time() + us;
+}
+
+// Wait until the previous instruction has finished. The I2C transfers in between
+// usually took longer already, so this mostly returns immediately.
+static void lcd_wait_ready(lcd_display_t *disp)
+{
+  int64_t remaining = disp->ready_at_us - esp_timer_get_time();
+  if (remaining <= 0)
+    return;
+
+#if CONFIG_LCD_BUSY_FLAG_POLL
+  // A busy flag read costs two I2C transfers, only worth it for the slow instructions
+  if (disp->timing.busy_flag && remaining > LCD_BUSY_POLL_MIN_US)
   {
-    for (uint8_t col = 0; col < LCD_COLS; col++)
+    if (lcd_poll_busy_flag(disp, remaining + LCD_BUSY_TIMEOUT_US) == ESP_OK)
     {
-      if (lcd_buffer[lcd_buffer_index_active][row * LCD_COLS + col] != lcd_buffer[lcd_buffer_index_draw][row * LCD_COLS + col])
-        return false;
+      disp->ready_at_us = 0;
+      return;
     }
+    remaining = disp->ready_at_us - esp_timer_get_time();
+    if (remaining <= 0)
+      return;
   }
-  return true;
+#endif
+
+  lcd_delay_us(disp, (uint32_t)remaining);
 }
 
-static esp_err_t i2c_send_with_toggle(uint8_t data)
+// Read the busy flag (DB7) through the PCF8574. The data pins have to be written high
+// first so the quasi-bidirectional port lets the LCD drive them.
+static esp_err_t lcd_read_busy_flag(lcd_display_t *disp, bool *busy)
 {
-  // Helper function to toggle the enable bit
-  uint8_t data_with_enable = data | LCD_ENABLE;
-  ESP_ERROR_CHECK(i2c_master_transmit(i2c_device_handle, &data_with_enable, 1, -1));
-  ets_delay_us(50);
+  uint8_t read_cmd = 0xF0 | disp->backlight | LCD_RW_READ | LCD_RS_CMD;
+  uint8_t strobe[2] = {read_cmd, read_cmd | LCD_ENABLE};
+  uint8_t port = 0;
+  if (!disp->online)
+    return ESP_ERR_INVALID_STATE;
+  esp_err_t err = i2c_master_transmit_receive(disp->dev, strobe, sizeof(strobe), &port, 1, LCD_I2C_TIMEOUT_MS);
+  if (err != ESP_OK)
+  {
+    disp->stats.errors++;
+    return err;
+  }
 
-  data_with_enable &= ~LCD_ENABLE;
-  ESP_ERROR_CHECK(i2c_master_transmit(i2c_device_handle, &data_with_enable, 1, -1));
-  ets_delay_us(50);
+  // Finish the 4-bit read cycle (low nibble is ignored), then put the port back to write mode
+  uint8_t tail[4] = {read_cmd, read_cmd | LCD_ENABLE, read_cmd, disp->backlight | LCD_RW_WRITE};
+  err = lcd_transmit(disp, tail, sizeof(tail));
+  if (err != ESP_OK)
+    return err;
 
+  *busy = (port & LCD_DB7) != 0;
   return ESP_OK;
 }
 
-static esp_err_t i2c_send_4bit_data(uint8_t data, uint8_t rs)
+static esp_err_t lcd_poll_busy_flag(lcd_display_t *disp, uint32_t timeout_us)
 {
-  // Send a byte of data to the LCD in 4-bit mode
-  uint8_t nibbles[2] = {
-      (data & 0xF0) | rs | lcd_backlight_status | LCD_RW_WRITE,
-      ((data << 4) & 0xF0) | rs | lcd_backlight_status | LCD_RW_WRITE};
-  ESP_ERROR_CHECK(i2c_send_with_toggle(nibbles[0]));
-  ESP_ERROR_CHECK(i2c_send_with_toggle(nibbles[1]));
+  int64_t start = esp_timer_get_time();
+  bool busy = true;
+  while (busy)
+  {
+    esp_err_t err = lcd_read_busy_flag(disp, &busy);
+    if (err != ESP_OK)
+      return err;
+    if (busy && esp_timer_get_time() - start > timeout_us)
+      return ESP_ERR_TIMEOUT;
+  }
+  return ESP_OK;
+}
+
+// Measure the controller speed at boot. Clear display is the only instruction slow enough
+// to be timed over I2C, the other execution times scale with the same oscillator.
+// If the busy flag cannot be read (R/W tied low on the backpack) the datasheet values stay.
+static esp_err_t lcd_calibrate_timing(lcd_display_t *disp)
+{
+  uint8_t clear_hi = 0x00 | disp->backlight | LCD_RW_WRITE | LCD_RS_CMD;
+  uint8_t clear_lo = 0x10 | disp->backlight | LCD_RW_WRITE | LCD_RS_CMD;
+  uint8_t edges[4] = {clear_hi | LCD_ENABLE, clear_hi, clear_lo | LCD_ENABLE, clear_lo};
+
+  lcd_wait_ready(disp);
+  LCD_TRY(lcd_transmit(disp, edges, sizeof(edges)));
+  int64_t start = esp_timer_get_time();
+
+  // Busy has to be seen at least once, otherwise the reads just return our own pull-ups
+  bool busy = false;
+  bool readable = lcd_read_busy_flag(disp, &busy) == ESP_OK && busy &&
+                  lcd_poll_busy_flag(disp, LCD_HOME_US_DEFAULT + LCD_BUSY_TIMEOUT_US) == ESP_OK;
+  uint32_t clear_us = (uint32_t)(esp_timer_get_time() - start);
+
+  if (!readable)
+  {
+    disp->timing.busy_flag = false;
+    lcd_set_busy_for(disp, LCD_HOME_US_DEFAULT);
+    ESP_LOGW(TAG, "%s: busy flag not readable, using datasheet timing (exec=%lu us, home=%lu us)",
+             disp->name, disp->timing.exec_us, disp->timing.home_us);
+    return disp->online ? ESP_OK : ESP_ERR_INVALID_STATE;
+  }
 
+  uint32_t home_us = clear_us * (100 + CONFIG_LCD_TIMING_MARGIN_PCT) / 100;
+  uint32_t exec_us = home_us * 37 / 1520;
+  if (exec_us < LCD_EXEC_US_MIN)
+    exec_us = LCD_EXEC_US_MIN;
+
+  disp->timing.home_us = home_us;
+  disp->timing.exec_us = exec_us;
+  disp->timing.busy_flag = true;
+  disp->ready_at_us = 0;
+  ESP_LOGI(TAG, "%s: timing calibrated, clear=%lu us, exec=%lu us, home=%lu us",
+           disp->name, clear_us, exec_us, home_us);
   return ESP_OK;
 }
+#endif
 
-void lcd_set_cursor_position(uint8_t col, uint8_t row)
+static esp_err_t lcd_set_cursor_position(lcd_display_t *disp, uint8_t col, uint8_t row)
 {
   // Set the cursor position on the LCD
-  if (col >= LCD_COLS)
-    col = LCD_COLS - 1;
-  if (row >= LCD_ROWS)
-    row = LCD_ROWS - 1;
+  if (col >= disp->cols)
+    col = disp->cols - 1;
+  if (row >= disp->rows)
+    row = disp->rows - 1;
 
-  static const uint8_t row_offsets[] = LCD_ROW_OFFSET;
-  uint8_t data = 0x80 | (col + row_offsets[row]);
-  ESP_ERROR_CHECK(i2c_send_4bit_data(data, LCD_RS_CMD));
+  // rows 2 and 3 continue rows 0 and 1 in DDRAM (0x14/0x54 on 20x4, 0x10/0x50 on 16x4)
+  return lcd_set_ddram_address(disp, row % 2, lcd_ddram_pos(disp, row, col));
+}
+
+static esp_err_t lcd_set_ddram_address(lcd_display_t *disp, uint8_t line, uint8_t pos)
+{
+  return i2c_send_4bit_data(disp, 0x80 | (line * 0x40 + pos), LCD_RS_CMD);
 }
 
 void lcd_set_cursor(uint8_t col, uint8_t row)
 {
   // Update the cursor position in the buffer
-  if (col < LCD_COLS && row < LCD_ROWS)
+  if (col < lcd_target->cols && row < lcd_target->rows)
   {
     cursor_col = col;
     cursor_row = row;
@@ -464,22 +1505,24 @@ void lcd_set_cursor(uint8_t col, uint8_t row)
 
 void lcd_clear_buffer(void)
 {
-  memset(lcd_buffer[lcd_buffer_index_draw], ' ', LCD_BUFFER_SIZE);
+  memset(lcd_target->buffer[LCD_BUFFER_DRAW], ' ', LCD_BUFFER_SIZE);
+  for (uint8_t row = 0; row < lcd_target->rows; row++)
+    lcd_target->dirty[row] = (1UL << lcd_target->cols) - 1;
   lcd_set_cursor(0, 0);
 }
 
 void lcd_write_character(char c)
 {
-  // ESP_LOGI(TAG, "idx: %d", lcd_buffer_index_draw);
   // Write a single character to the buffer
-  if (cursor_col < LCD_COLS && cursor_row < LCD_ROWS)
+  if (cursor_col < lcd_target->cols && cursor_row < lcd_target->rows)
   {
-    lcd_buffer[lcd_buffer_index_draw][cursor_row * LCD_COLS + cursor_col] = c;
+    lcd_target->buffer[LCD_BUFFER_DRAW][cursor_row * lcd_target->cols + cursor_col] = c;
+    lcd_target->dirty[cursor_row] |= 1UL << cursor_col;
     cursor_col++;
-    if (cursor_col >= LCD_COLS)
+    if (cursor_col >= lcd_target->cols)
     {
       cursor_col = 0;
-      cursor_row = (cursor_row + 1) % LCD_ROWS;
+      cursor_row = (cursor_row + 1) % lcd_target->rows;
     }
   }
 }
@@ -512,17 +1555,60 @@ void lcd_write_buffer(const char *buffer, size_t size)
 }
 
 void lcd_toggle_backlight(bool state)
+{
+  lcd_set_backlight(lcd_target, state);
+}
+
+static esp_err_t lcd_set_backlight(lcd_display_t *disp, bool state)
 {
   // Control the LCD backlight
   if (state)
   {
-    lcd_backlight_status |= LCD_BACKLIGHT;
+    disp->backlight |= LCD_BACKLIGHT;
   }
   else
   {
-    lcd_backlight_status &= ~LCD_BACKLIGHT;
+    disp->backlight &= ~LCD_BACKLIGHT;
   }
-  ESP_ERROR_CHECK(i2c_master_transmit(i2c_device_handle, &lcd_backlight_status, 1, -1));
+  return lcd_transmit(disp, &disp->backlight, 1);
+}
+
+// All writes to a backpack go through here. A failed transfer is repeated a few times,
+// if it keeps failing the display goes offline and further writes return at once
+// until lcd_recover() brings it back.
+static esp_err_t lcd_transmit(lcd_display_t *disp, const uint8_t *data, size_t len)
+{
+  if (!disp->online)
+    return ESP_ERR_INVALID_STATE;
+
+  esp_err_t err = ESP_FAIL;
+  for (uint8_t attempt = 0; attempt <= LCD_IO_RETRIES; attempt++)
+  {
+    if (attempt > 0)
+      disp->stats.retries++;
+#if CONFIG_LCD_FAULT_INJECT_PCT > 0
+    if (esp_random() % 100 < CONFIG_LCD_FAULT_INJECT_PCT)
+    {
+      err = ESP_ERR_TIMEOUT;
+      disp->stats.errors++;
+      continue;
+    }
+#endif
+    err = i2c_master_transmit(disp->dev, data, len, LCD_I2C_TIMEOUT_MS);
+    if (err == ESP_OK)
+      return ESP_OK;
+    disp->stats.errors++;
+  }
+
+  disp->online = false;
+  return err;
+}
+
+// Fixed waits, accounted so the benchmark can show what they cost
+static void lcd_delay_us(lcd_display_t *disp, uint32_t us)
+{
+  ets_delay_us(us);
+  disp->stats.delay_us += us;
 }
 
 // -----------------
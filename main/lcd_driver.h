@@ -13,6 +13,7 @@
 #define I2C_MASTER_SCL_IO     9
 #define I2C_MASTER_FREQ_HZ    100000
 #define LCD_I2C_ADDRESS       0x27
+#define LCD_I2C_TIMEOUT_MS    50
 
 // LCD commands
 #define WRITE_BIT           I2C_MASTER_WRITE
@@ -31,24 +32,112 @@
 #define LCD_DB5 (1 << 5) // Data bit 5
 #define LCD_DB4 (1 << 4) // Data bit 4
 
+// HD44780 execution times, used until calibrated (adaptive timing only)
+#define LCD_EXEC_US_DEFAULT 50    // 37 us + margin
+#define LCD_HOME_US_DEFAULT 2000  // 1.52 ms + margin
+#define LCD_EXEC_US_MIN 20        // lower bound for calibrated execution time
+#define LCD_BUSY_POLL_MIN_US 400  // shorter waits are cheaper than a busy flag read
+#define LCD_BUSY_TIMEOUT_US 10000 // give up polling after this
+
 #define LCD_FPS 2 // Frames per second
 #define LCD_COLS 20
 #define LCD_ROWS 4
 #define LCD_ROW_OFFSET {0x00, 0x40, 0x14, 0x54} // Row offsets for 20x4 LCD
 #define LCD_BUFFER_SIZE (LCD_COLS * LCD_ROWS)
 #define LCD_BUFFER_DEPTH 2 // Double buffering
+#define LCD_DDRAM_LINES 2     // HD44780 DDRAM: two lines of 40 cells, rows 2/3 continue rows 0/1
+#define LCD_DDRAM_LINE_LEN 40
+#define LCD_TICKER_MAX 120    // ticker text length
+#define LCD_TICKER_GAP 4      // blanks between the end and the start of a looping ticker text
+
+// Render scheduler
+#if CONFIG_LCD_ADAPTIVE_TIMING
+#define LCD_WIRE_BYTES_PER_WRITE 5 // address + 4 nibble edges in one transfer
+#else
+#define LCD_WIRE_BYTES_PER_WRITE 8 // 4 single-byte transfers
+#endif
+#define LCD_BUS_BYTES_PER_FRAME (I2C_MASTER_FREQ_HZ / 9 / LCD_FPS) // 9 clocks per byte incl. ACK
+#define LCD_STATS_PERIOD_S 60 // bus utilization window and stats log period
+
+// Display I/O errors
+#define LCD_IO_RETRIES 2                    // repeats of a failed transfer before the display goes offline
+#define LCD_RECOVERY_BACKOFF_MIN_MS 500     // first recovery attempt after an outage
+#define LCD_RECOVERY_BACKOFF_MAX_MS 30000   // doubled after each failed attempt up to this
 
 typedef enum {
     LCD_SCREEN_SPLASH = 0,
     LCD_SCREEN_RESTARTING,
     LCD_SCREEN_CLOCK,
     LCD_SCREEN_SETTINGS,
+    LCD_SCREEN_STATION, // compact model time for station displays
+    LCD_SCREEN_CONTROL, // follows the UI state machine (main display)
     LCD_SCREEN_MAX
 } lcd_screen_state_t;
 #define LCD_SCREEN_START_SCREEN LCD_SCREEN_CLOCK
 
+typedef struct {
+    uint32_t frames;         // frames brought fully in sync
+    uint32_t frame_us_last;  // first transfer until in sync, may span several rounds
+    uint32_t frame_us_max;
+    uint64_t frame_us_total;
+    uint32_t bytes;          // bytes on the wire
+    uint64_t busy_us;        // time spent transmitting
+    uint32_t errors;         // failed I2C transfers
+    uint64_t delay_us;       // time spent in fixed delays (ets_delay_us)
+    uint32_t retries;        // transfers repeated after an error
+    uint32_t outages;        // times the display went offline
+    uint32_t recoveries;     // times it came back (bus reset, probe and re-init)
+} lcd_display_stats_t;
+
+// Benchmark (main display)
+#define LCD_BENCH_FRAMES_WORST 20
+#define LCD_BENCH_FRAMES_TYPICAL 50
+#define LCD_BENCH_FPS_X10(p) ((p)->elapsed_us ? (uint32_t)((uint64_t)(p)->frames * 10000000ULL / (p)->elapsed_us) : 0)
+
+typedef struct {
+    uint32_t frames;
+    uint32_t elapsed_us;
+    uint32_t bytes;    // on the wire
+    uint32_t errors;   // failed I2C transfers
+    uint32_t delay_us; // spent in ets_delay_us
+} lcd_bench_phase_t;
+
+typedef struct {
+    lcd_bench_phase_t worst;   // every cell changes
+    lcd_bench_phase_t typical; // clock screen ticking
+    bool valid;
+} lcd_bench_result_t;
+
 void i2c_initialize(void);
 void lcd_initialize(void);
 
+// Drawing into the draw buffer of the display being composed
+void lcd_set_cursor(uint8_t col, uint8_t row);
+void lcd_clear_buffer(void);
+void lcd_write_character(char c);
+void lcd_write_text(const char *str);
+void lcd_write_textf(const char *str, size_t size, ...);
+void lcd_write_buffer(const char *buffer, size_t size);
+void lcd_toggle_backlight(bool state);
+
+uint8_t lcd_get_display_count(void);
+bool lcd_get_display_stats(uint8_t idx, lcd_display_stats_t *out);
+bool lcd_is_display_online(uint8_t idx);
+uint8_t lcd_get_bus_utilization(void); // percent of the last stats window
+i2c_master_bus_handle_t lcd_get_i2c_bus(void); // shared with other I2C devices (input expanders)
+bool lcd_uses_address(uint8_t address);        // a configured display has it, present or not
+// Other devices on the bus hold this around their transactions, lcd_recover() around the bus reset
+void lcd_bus_lock(void);
+void lcd_bus_unlock(void);
+
+// Ticker: the text scrolls through the DDRAM line of the row with the display shift
+// instruction, one command per step. The line is owned by the ticker, on 4-row displays
+// that is row and row +/- 2 (the text continues on the second row).
+bool lcd_ticker_start(uint8_t display, uint8_t row, const char *text);
+void lcd_ticker_stop(uint8_t display);
+
+void lcd_bench_start(void); // runs on the LCD task before the next frame
+bool lcd_bench_get_result(lcd_bench_result_t *out);
+
 
 #endif
\ No newline at end of file
@@ -0,0 +1,134 @@
+#include <string.h>
+#include "driver/uart.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "lcd_mirror.h"
+#include "lcd_driver.h"
+
+static const char *TAG = "LCD_MIRROR";
+
+static char mirror_cells[LCD_BUFFER_SIZE]; // frame the receiver has
+static bool mirror_valid = false;
+static int64_t mirror_keyframe_us = 0;
+static uint8_t mirror_seq = 0;
+static lcd_mirror_stats_t mirror_stats;
+
+static uint8_t crc8(uint8_t crc, const uint8_t *data, size_t len)
+{
+  for (size_t i = 0; i < len; i++)
+  {
+    crc ^= data[i];
+    for (uint8_t bit = 0; bit < 8; bit++)
+      crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+  }
+  return crc;
+}
+
+static void mirror_send(uint8_t type, const uint8_t *payload, uint8_t len)
+{
+  uint8_t header[LCD_MIRROR_HEADER_SIZE] = {LCD_MIRROR_SYNC0, LCD_MIRROR_SYNC1, type, mirror_seq++, len};
+  uint8_t crc = crc8(crc8(0, &header[2], 3), payload, len);
+
+  uart_write_bytes(CONFIG_LCD_MIRROR_UART_NUM, header, sizeof(header));
+  uart_write_bytes(CONFIG_LCD_MIRROR_UART_NUM, payload, len);
+  uart_write_bytes(CONFIG_LCD_MIRROR_UART_NUM, &crc, 1);
+  mirror_stats.bytes += sizeof(header) + len + 1;
+}
+
+static void mirror_send_keyframe(const char *cells, uint8_t cols, uint8_t rows)
+{
+  uint8_t payload[2 + LCD_BUFFER_SIZE];
+  uint16_t size = cols * rows;
+
+  payload[0] = cols;
+  payload[1] = rows;
+  memcpy(&payload[2], cells, size);
+  mirror_send(LCD_MIRROR_KEYFRAME, payload, 2 + size);
+
+  memcpy(mirror_cells, cells, size);
+  mirror_valid = true;
+  mirror_keyframe_us = esp_timer_get_time();
+  mirror_stats.keyframes++;
+}
+
+void lcd_mirror_frame(const char *cells, uint8_t cols, uint8_t rows)
+{
+  uint16_t size = cols * rows;
+  if (size > LCD_BUFFER_SIZE)
+    return;
+
+  if (!mirror_valid || esp_timer_get_time() - mirror_keyframe_us >= CONFIG_LCD_MIRROR_KEYFRAME_S * 1000000LL)
+  {
+    mirror_send_keyframe(cells, cols, rows);
+    return;
+  }
+
+  uint8_t payload[LCD_MIRROR_MAX_PAYLOAD];
+  uint16_t len = 0;
+  uint16_t pos = 0;
+
+  while (pos < size)
+  {
+    if (cells[pos] == mirror_cells[pos])
+    {
+      pos++;
+      continue;
+    }
+
+    // run of changed cells; one unchanged cell is cheaper to repeat than a new run header
+    uint16_t end = pos + 1;
+    while (end < size)
+    {
+      if (cells[end] != mirror_cells[end])
+        end++;
+      else if (end + 1 < size && cells[end + 1] != mirror_cells[end + 1])
+        end += 2;
+      else
+        break;
+    }
+
+    uint16_t count = end - pos;
+    if (len + 2 + count > 2 + size)
+    {
+      // the delta got bigger than the frame itself
+      mirror_send_keyframe(cells, cols, rows);
+      return;
+    }
+    payload[len++] = pos;
+    payload[len++] = count;
+    memcpy(&payload[len], &cells[pos], count);
+    len += count;
+    pos = end;
+  }
+
+  if (len == 0)
+    return;
+
+  mirror_send(LCD_MIRROR_DELTA, payload, len);
+  memcpy(mirror_cells, cells, size);
+  mirror_stats.deltas++;
+}
+
+void lcd_mirror_get_stats(lcd_mirror_stats_t *out)
+{
+  *out = mirror_stats;
+}
+
+void lcd_mirror_init(void)
+{
+  uart_config_t uart_config = {
+      .baud_rate = CONFIG_LCD_MIRROR_BAUD,
+      .data_bits = UART_DATA_8_BITS,
+      .parity = UART_PARITY_DISABLE,
+      .stop_bits = UART_STOP_BITS_1,
+      .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
+      .source_clk = UART_SCLK_DEFAULT};
+
+  // TX only; the RX buffer is required by the driver
+  ESP_ERROR_CHECK(uart_driver_install(CONFIG_LCD_MIRROR_UART_NUM, 256, 1024, 0, NULL, 0));
+  ESP_ERROR_CHECK(uart_param_config(CONFIG_LCD_MIRROR_UART_NUM, &uart_config));
+  ESP_ERROR_CHECK(uart_set_pin(CONFIG_LCD_MIRROR_UART_NUM, CONFIG_LCD_MIRROR_TX_GPIO, UART_PIN_NO_CHANGE,
+                               UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE));
+  ESP_LOGI(TAG, "LCD mirror on UART%d, TX GPIO %d, %d baud", CONFIG_LCD_MIRROR_UART_NUM, CONFIG_LCD_MIRROR_TX_GPIO,
+           CONFIG_LCD_MIRROR_BAUD);
+}
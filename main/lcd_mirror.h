@@ -0,0 +1,35 @@
+#ifndef LCD_MIRROR_H
+#define LCD_MIRROR_H
+
+#include <stdint.h>
+
+/*
+ * Mirror of the main display over a UART, decoded by tools/lcd_mirror_decode.py.
+ *
+ * Packet: 0xA5 0x5A | type | seq | len | payload[len] | crc8
+ *   crc8:  polynomial 0x07, init 0x00, over type, seq, len and payload
+ *   seq:   increments per packet, a gap tells the receiver to wait for a keyframe
+ *   'K' keyframe: cols, rows, cols*rows characters
+ *   'D' delta:    runs of {pos, count, characters[count]}, pos = row * cols + col
+ */
+#define LCD_MIRROR_SYNC0 0xA5
+#define LCD_MIRROR_SYNC1 0x5A
+#define LCD_MIRROR_KEYFRAME 'K'
+#define LCD_MIRROR_DELTA 'D'
+#define LCD_MIRROR_HEADER_SIZE 5
+#define LCD_MIRROR_MAX_PAYLOAD 255
+
+typedef struct {
+    uint32_t keyframes;
+    uint32_t deltas;
+    uint32_t bytes; // on the UART, framing included
+} lcd_mirror_stats_t;
+
+void lcd_mirror_init(void);
+
+// Send the difference to the previous frame, or a keyframe when it is due
+void lcd_mirror_frame(const char *cells, uint8_t cols, uint8_t rows);
+
+void lcd_mirror_get_stats(lcd_mirror_stats_t *out);
+
+#endif
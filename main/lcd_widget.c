@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "lcd_widget.h"
+#include "timer.h"
+
+void lcd_widget_invalidate(lcd_widget_t *w)
+{
+  w->dirty = true;
+}
+
+void lcd_widget_set_text(lcd_widget_t *w, const char *text)
+{
+  size_t len = strnlen(text, w->width);
+  if (w->valid && strncmp(w->text, text, len) == 0 && w->text[len] == '\0')
+    return;
+
+  memcpy(w->text, text, len);
+  w->text[len] = '\0';
+  w->valid = true;
+  w->dirty = true;
+}
+
+void lcd_widget_set_time(lcd_widget_t *w, uint32_t ts)
+{
+  if (w->valid && w->value.ts == ts)
+    return;
+
+  struct tm tm;
+  ts_to_tm(ts, &tm);
+  switch (w->time_format)
+  {
+  case LCD_TIME_HMS:
+    snprintf(w->text, sizeof(w->text), "%02d:%02d:%02d", tm.tm_hour, tm.tm_min, tm.tm_sec);
+    break;
+  case LCD_TIME_DATE:
+    snprintf(w->text, sizeof(w->text), "%04d-%02d-%02d", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday);
+    break;
+  case LCD_TIME_DATETIME:
+  default:
+    snprintf(w->text, sizeof(w->text), "%04d-%02d-%02d  %02d:%02d:%02d",
+             tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+    break;
+  }
+  w->value.ts = ts;
+  w->valid = true;
+  w->dirty = true;
+}
+
+void lcd_widget_set_number(lcd_widget_t *w, int32_t value)
+{
+  if (w->valid && w->value.number == value)
+    return;
+
+  snprintf(w->text, sizeof(w->text), w->number_format ? w->number_format : "%d", (int)value);
+  w->value.number = value;
+  w->valid = true;
+  w->dirty = true;
+}
+
+void lcd_widget_set_list(lcd_widget_t *w, int8_t selected, int8_t top, int8_t count)
+{
+  if (w->valid && w->value.list.selected == selected && w->value.list.top == top && w->value.list.count == count)
+    return;
+
+  w->value.list.selected = selected;
+  w->value.list.top = top;
+  w->value.list.count = count;
+  w->valid = true;
+  w->dirty = true;
+}
+
+// Text widgets: text left aligned, rest of the region blanked
+static void draw_text(const lcd_widget_t *w)
+{
+  size_t len = strnlen(w->text, w->width);
+  lcd_set_cursor(w->col, w->row);
+  lcd_write_buffer(w->text, len);
+  for (size_t i = len; i < w->width; i++)
+    lcd_write_character(' ');
+}
+
+// Menu list: caret in column 0, label from column 2, scroll marks in the last column
+static void draw_menu_list(const lcd_widget_t *w)
+{
+  int start = w->value.list.top;
+  int count = w->value.list.count;
+
+  for (int row = 0; row < w->height; ++row)
+  {
+    int idx = start + row;
+    const char *label = (idx < count && w->item_label) ? w->item_label(idx) : NULL;
+
+    char line[LCD_COLS + 1];
+    memset(line, ' ', w->width);
+    line[w->width] = '\0';
+    if (label)
+    {
+      if (idx == w->value.list.selected)
+        line[0] = (char)0x7E;
+      size_t len = strnlen(label, w->width - 2); // safe length
+      memcpy(&line[2], label, len);
+    }
+    if (row == 0 && start > 0)
+      line[w->width - 1] = '^';
+    if (row == w->height - 1 && start + w->height < count)
+      line[w->width - 1] = 'v';
+
+    lcd_set_cursor(w->col, w->row + row);
+    lcd_write_buffer(line, w->width);
+  }
+}
+
+void lcd_widget_draw(lcd_widget_t *w)
+{
+  switch (w->type)
+  {
+  case LCD_WIDGET_MENU_LIST:
+    draw_menu_list(w);
+    break;
+  case LCD_WIDGET_LABEL:
+  case LCD_WIDGET_TIME:
+  case LCD_WIDGET_NUMBER:
+  default:
+    draw_text(w);
+    break;
+  }
+  w->dirty = false;
+}
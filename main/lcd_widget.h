@@ -0,0 +1,80 @@
+#ifndef LCD_WIDGET_H
+#define LCD_WIDGET_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "lcd_driver.h"
+
+#define LCD_WIDGETS_MAX 8 // per screen
+
+typedef enum {
+    LCD_WIDGET_LABEL = 0,
+    LCD_WIDGET_TIME,
+    LCD_WIDGET_NUMBER,
+    LCD_WIDGET_MENU_LIST,
+} lcd_widget_type_t;
+
+typedef enum {
+    LCD_TIME_DATETIME = 0, // "YYYY-MM-DD  HH:MM:SS" (20 chars)
+    LCD_TIME_HMS,          // "HH:MM:SS"
+    LCD_TIME_DATE,         // "YYYY-MM-DD"
+} lcd_time_format_t;
+
+/*
+ * A widget owns a fixed region of the screen and remembers the value it shows.
+ * Setters only mark it dirty when the value changes, the renderer redraws dirty
+ * widgets only.
+ */
+typedef struct {
+    lcd_widget_type_t type;
+    uint8_t col;
+    uint8_t row;
+    uint8_t width;
+    uint8_t height;
+    lcd_time_format_t time_format;      // LCD_WIDGET_TIME
+    const char *number_format;          // LCD_WIDGET_NUMBER, printf format for one int
+    const char *(*item_label)(int idx); // LCD_WIDGET_MENU_LIST
+
+    /* retained state */
+    bool dirty;
+    bool valid; // a value was set since the screen was entered
+    union {
+        uint32_t ts;
+        int32_t number;
+        struct {
+            int8_t selected;
+            int8_t top;
+            int8_t count;
+        } list;
+    } value;
+    char text[LCD_COLS + 1];
+} lcd_widget_t;
+
+#define LCD_LABEL(c, r, w) \
+    {.type = LCD_WIDGET_LABEL, .col = (c), .row = (r), .width = (w), .height = 1}
+#define LCD_TIME(c, r, w, fmt) \
+    {.type = LCD_WIDGET_TIME, .col = (c), .row = (r), .width = (w), .height = 1, .time_format = (fmt)}
+#define LCD_NUMBER(c, r, w, fmt) \
+    {.type = LCD_WIDGET_NUMBER, .col = (c), .row = (r), .width = (w), .height = 1, .number_format = (fmt)}
+#define LCD_MENU_LIST(c, r, w, h, label_fn) \
+    {.type = LCD_WIDGET_MENU_LIST, .col = (c), .row = (r), .width = (w), .height = (h), .item_label = (label_fn)}
+
+/* Screen definition: widget layout plus the function that feeds it with data.
+   Screens without widgets draw everything in render() on each frame. */
+typedef struct {
+    const lcd_widget_t *layout;
+    uint8_t count;
+    void (*update)(lcd_widget_t *widgets);
+    void (*render)(void);
+} lcd_screen_def_t;
+
+void lcd_widget_set_text(lcd_widget_t *w, const char *text);
+void lcd_widget_set_time(lcd_widget_t *w, uint32_t ts);
+void lcd_widget_set_number(lcd_widget_t *w, int32_t value);
+void lcd_widget_set_list(lcd_widget_t *w, int8_t selected, int8_t top, int8_t count);
+void lcd_widget_invalidate(lcd_widget_t *w);
+
+// Draw the widget region into the current draw target and clear its dirty flag
+void lcd_widget_draw(lcd_widget_t *w);
+
+#endif
@@ -0,0 +1,143 @@
+#include <math.h>
+#include <string.h>
+#include "light_curve.h"
+
+#define MIN_PER_DAY 1440
+
+static const char *gradient_names[LIGHT_GRADIENT__COUNT] = {"sky", "street", "interior"};
+
+static uint16_t wrap_minute(int minute)
+{
+  return (uint16_t)((minute % MIN_PER_DAY + MIN_PER_DAY) % MIN_PER_DAY);
+}
+
+static int add_stop(light_stop_t *stops, int count, int max, int minute, uint8_t r, uint8_t g, uint8_t b)
+{
+  if (count >= max)
+    return count;
+  stops[count] = (light_stop_t){.minute = wrap_minute(minute), .r = r, .g = g, .b = b};
+  return count + 1;
+}
+
+int light_gradient_stops(light_gradient_t g, const light_sun_t *sun, light_stop_t *stops, int max)
+{
+  int rise = sun->sunrise_min;
+  int set = sun->sunset_min;
+  int n = 0;
+
+  switch (g)
+  {
+  case LIGHT_GRADIENT_SKY:
+    n = add_stop(stops, n, max, rise - 45, 2, 3, 14); // night blue until dawn
+    n = add_stop(stops, n, max, rise, 150, 60, 22);
+    n = add_stop(stops, n, max, rise + 60, 255, 215, 170);
+    n = add_stop(stops, n, max, rise + 150, 255, 250, 240);
+    n = add_stop(stops, n, max, set - 150, 255, 250, 240);
+    n = add_stop(stops, n, max, set - 60, 255, 200, 140);
+    n = add_stop(stops, n, max, set, 160, 55, 28);
+    n = add_stop(stops, n, max, set + 45, 2, 3, 14);
+    break;
+  case LIGHT_GRADIENT_STREET:
+    n = add_stop(stops, n, max, rise - 15, 255, 160, 60);
+    n = add_stop(stops, n, max, rise + 15, 0, 0, 0);
+    n = add_stop(stops, n, max, set - 15, 0, 0, 0);
+    n = add_stop(stops, n, max, set + 15, 255, 160, 60);
+    break;
+  case LIGHT_GRADIENT_INTERIOR:
+    n = add_stop(stops, n, max, rise - 60, 0, 0, 0);
+    n = add_stop(stops, n, max, rise - 30, 220, 160, 90);
+    n = add_stop(stops, n, max, rise + 60, 0, 0, 0);
+    n = add_stop(stops, n, max, set - 30, 0, 0, 0);
+    n = add_stop(stops, n, max, set, 255, 180, 100);
+    n = add_stop(stops, n, max, 22 * 60 + 30, 255, 180, 100);
+    n = add_stop(stops, n, max, 23 * 60 + 30, 0, 0, 0); // lights out
+    break;
+  default:
+    return 0;
+  }
+
+  // sort by minute, stops near midnight may have wrapped
+  for (int i = 1; i < n; i++)
+  {
+    light_stop_t s = stops[i];
+    int j = i - 1;
+    while (j >= 0 && stops[j].minute > s.minute)
+    {
+      stops[j + 1] = stops[j];
+      j--;
+    }
+    stops[j + 1] = s;
+  }
+  return n;
+}
+
+int light_gradient_find(const char *name, int len)
+{
+  for (int g = 0; g < LIGHT_GRADIENT__COUNT; g++)
+  {
+    if ((int)strlen(gradient_names[g]) == len && strncmp(gradient_names[g], name, len) == 0)
+      return g;
+  }
+  return -1;
+}
+
+const char *light_gradient_name(light_gradient_t g)
+{
+  return g < LIGHT_GRADIENT__COUNT ? gradient_names[g] : "?";
+}
+
+void light_lut_build(light_lut_t *lut, const light_stop_t *stops, int count)
+{
+  for (int i = 0; i < LIGHT_LUT_SIZE; i++)
+  {
+    // entry time in 1/8 minutes: i * 1440 * 8 / 256
+    int t = i * (MIN_PER_DAY * 8 / LIGHT_LUT_SIZE);
+
+    // last stop at or before t, wrapping to the last of the day
+    int a = count - 1;
+    for (int k = 0; k < count; k++)
+    {
+      if (stops[k].minute * 8 <= t)
+        a = k;
+    }
+    int b = (a + 1) % count;
+    int ta = stops[a].minute * 8;
+    int tb = stops[b].minute * 8;
+    if (tb <= ta)
+      tb += MIN_PER_DAY * 8;
+    if (t < ta)
+      t += MIN_PER_DAY * 8;
+    int span = tb - ta;
+    int f = span > 0 ? (t - ta) * 256 / span : 0;
+
+    const uint8_t ca[3] = {stops[a].r, stops[a].g, stops[a].b};
+    const uint8_t cb[3] = {stops[b].r, stops[b].g, stops[b].b};
+    for (int c = 0; c < 3; c++)
+      lut->rgb[i][c] = (uint8_t)(ca[c] + ((cb[c] - ca[c]) * f) / 256);
+  }
+}
+
+uint16_t light_day_pos(int64_t model_us)
+{
+  uint32_t ms = (uint32_t)((model_us / 1000) % LIGHT_DAY_MS);
+  return (uint16_t)(((uint64_t)ms * LIGHT_LUT_SIZE * 256) / LIGHT_DAY_MS);
+}
+
+void light_lut_sample(const light_lut_t *lut, uint16_t pos, uint8_t brightness, uint8_t out[3])
+{
+  uint8_t i = pos >> 8;
+  uint8_t next = (uint8_t)(i + 1); // wraps at midnight with LIGHT_LUT_SIZE 256
+  int f = pos & 0xFF;
+  for (int c = 0; c < 3; c++)
+  {
+    int a = lut->rgb[i][c];
+    int v = a * 256 + (lut->rgb[next][c] - a) * f; // 8.8
+    out[c] = (uint8_t)(((uint32_t)v * (brightness + 1)) >> 16);
+  }
+}
+
+void light_gamma_build(uint8_t table[256], float gamma)
+{
+  for (int i = 0; i < 256; i++)
+    table[i] = (uint8_t)(powf(i / 255.0f, gamma) * 255.0f + 0.5f);
+}
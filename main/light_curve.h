@@ -0,0 +1,58 @@
+#ifndef LIGHT_CURVE_H
+#define LIGHT_CURVE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Day/night colour gradients for the layout lighting, precomputed into lookup tables.
+ * Plain C without IDF dependencies, driven by lighting.c.
+ */
+
+#define LIGHT_LUT_SIZE 256   // entries over the day, one every 5.625 model minutes
+#define LIGHT_STOPS_MAX 12
+#define LIGHT_DAY_MS 86400000u
+
+/* Colour at a minute of the day; the gradient wraps around midnight */
+typedef struct {
+  uint16_t minute;
+  uint8_t r, g, b;
+} light_stop_t;
+
+typedef enum {
+  LIGHT_GRADIENT_SKY = 0,   // night, sunrise, daylight, sunset
+  LIGHT_GRADIENT_STREET,    // sodium lamps from dusk to dawn
+  LIGHT_GRADIENT_INTERIOR,  // windows lit in the morning and evening
+  LIGHT_GRADIENT__COUNT
+} light_gradient_t;
+
+typedef struct {
+  uint16_t sunrise_min; // minute of the day
+  uint16_t sunset_min;
+} light_sun_t;
+
+/* Linear light, gamma is applied after interpolation and brightness */
+typedef struct {
+  uint8_t rgb[LIGHT_LUT_SIZE][3];
+} light_lut_t;
+
+// Stops of a built-in gradient placed around sunrise and sunset, sorted; 0 if unknown
+int light_gradient_stops(light_gradient_t g, const light_sun_t *sun, light_stop_t *stops, int max);
+
+// Gradient by name ("sky", "street", "interior"), -1 if unknown
+int light_gradient_find(const char *name, int len);
+const char *light_gradient_name(light_gradient_t g);
+
+// Sample the stops into the table; stops sorted by minute, at least one
+void light_lut_build(light_lut_t *lut, const light_stop_t *stops, int count);
+
+// Position on the day in LIGHT_LUT_SIZE * 256 steps (8 bit fraction between entries)
+uint16_t light_day_pos(int64_t model_us);
+
+// Interpolated colour at a day position, scaled by brightness (255 = full)
+void light_lut_sample(const light_lut_t *lut, uint16_t pos, uint8_t brightness, uint8_t out[3]);
+
+// Linear to WS2812 PWM value
+void light_gamma_build(uint8_t table[256], float gamma);
+
+#endif
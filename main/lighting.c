@@ -0,0 +1,244 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lighting.h"
+#include "light_curve.h"
+#include "timer.h"
+#include "led_strip.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_console.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char *TAG = "lighting";
+
+#if CONFIG_LIGHTING_ENABLE
+
+#define LIGHTING_GAMMA 2.2f
+#define POS_PER_DAY 65536 // light_day_pos() steps
+
+typedef struct {
+  uint16_t first;
+  uint16_t count;
+  light_gradient_t gradient;
+  uint8_t brightness;
+  uint32_t spread_step; // day position offset per LED, 16.16
+} light_zone_t;
+
+static led_strip_handle_t strip = NULL;
+static light_lut_t luts[LIGHT_GRADIENT__COUNT];
+static uint8_t gamma_table[256];
+static light_zone_t zones[LIGHTING_ZONES_MAX];
+static uint8_t zone_count = 0;
+
+static volatile int32_t preview_pos = -1; // console override of the time of day
+static lighting_stats_t stats;
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Zones from the config, "first:count:gradient[:brightness[:spread minutes]]" comma separated
+static void parse_zones(const char *p)
+{
+  while (*p && zone_count < LIGHTING_ZONES_MAX)
+  {
+    char *end;
+    long first = strtol(p, &end, 10);
+    if (end == p || *end != ':')
+      break;
+    long count = strtol(end + 1, &end, 10);
+    if (*end != ':')
+      break;
+    const char *name = end + 1;
+    int len = strcspn(name, ":,");
+    int g = light_gradient_find(name, len);
+    p = name + len;
+    long brightness = 255, spread = 0;
+    if (*p == ':')
+      brightness = strtol(p + 1, (char **)&p, 10);
+    if (*p == ':')
+      spread = strtol(p + 1, (char **)&p, 10);
+    if (*p == ',')
+      p++;
+
+    if (g < 0 || count <= 0 || first + count > CONFIG_LIGHTING_LED_COUNT)
+    {
+      ESP_LOGW(TAG, "Zone %u (%ld+%ld, %.*s) ignored", zone_count, first, count, len, name);
+      continue;
+    }
+    light_zone_t *z = &zones[zone_count++];
+    z->first = (uint16_t)first;
+    z->count = (uint16_t)count;
+    z->gradient = (light_gradient_t)g;
+    z->brightness = brightness > 255 ? 255 : (uint8_t)brightness;
+    // a sunrise sweeping along the zone: the last LED runs spread minutes late
+    z->spread_step = (uint32_t)(((uint64_t)spread * POS_PER_DAY / 1440) * 65536 / count);
+  }
+}
+
+static void render_zone(const light_zone_t *z, uint16_t pos)
+{
+  uint8_t c[3];
+  if (z->spread_step == 0)
+  {
+    light_lut_sample(&luts[z->gradient], pos, z->brightness, c);
+    for (uint16_t k = 0; k < z->count; k++)
+      led_strip_set_pixel(strip, z->first + k, gamma_table[c[0]], gamma_table[c[1]], gamma_table[c[2]]);
+    return;
+  }
+  uint32_t offset = 0;
+  for (uint16_t k = 0; k < z->count; k++)
+  {
+    light_lut_sample(&luts[z->gradient], (uint16_t)(pos - (offset >> 16)), z->brightness, c);
+    led_strip_set_pixel(strip, z->first + k, gamma_table[c[0]], gamma_table[c[1]], gamma_table[c[2]]);
+    offset += z->spread_step;
+  }
+}
+
+static void lighting_task(void *arg)
+{
+  const TickType_t period = pdMS_TO_TICKS(1000 / CONFIG_LIGHTING_FPS) > 0 ? pdMS_TO_TICKS(1000 / CONFIG_LIGHTING_FPS) : 1;
+  TickType_t last_wake = xTaskGetTickCount();
+  int32_t last_pos = -1;
+
+  while (1)
+  {
+    bool on_time = xTaskDelayUntil(&last_wake, period);
+
+    // model time at the frame, between model seconds too
+    int64_t start_us = esp_timer_get_time();
+    int32_t pos = preview_pos >= 0 ? preview_pos : light_day_pos(timer_model_time_us(start_us));
+    if (pos == last_pos)
+    {
+      portENTER_CRITICAL(&stats_lock);
+      stats.unchanged++;
+      portEXIT_CRITICAL(&stats_lock);
+      continue;
+    }
+    last_pos = pos;
+
+    for (uint8_t i = 0; i < zone_count; i++)
+      render_zone(&zones[i], (uint16_t)pos);
+    int64_t rendered_us = esp_timer_get_time();
+    led_strip_refresh(strip); // blocks on the transfer, not the CPU
+    int64_t done_us = esp_timer_get_time();
+
+    uint32_t compute_us = (uint32_t)(rendered_us - start_us);
+    uint32_t refresh_us = (uint32_t)(done_us - rendered_us);
+    portENTER_CRITICAL(&stats_lock);
+    stats.frames++;
+    if (!on_time)
+      stats.overruns++;
+    stats.compute_us_last = compute_us;
+    if (compute_us > stats.compute_us_max)
+      stats.compute_us_max = compute_us;
+    stats.refresh_us_last = refresh_us;
+    if (refresh_us > stats.refresh_us_max)
+      stats.refresh_us_max = refresh_us;
+    portEXIT_CRITICAL(&stats_lock);
+  }
+}
+
+void lighting_init(void)
+{
+  const light_sun_t sun = {
+      .sunrise_min = CONFIG_LIGHTING_SUNRISE_MIN,
+      .sunset_min = CONFIG_LIGHTING_SUNSET_MIN,
+  };
+  for (int g = 0; g < LIGHT_GRADIENT__COUNT; g++)
+  {
+    light_stop_t stops[LIGHT_STOPS_MAX];
+    int n = light_gradient_stops((light_gradient_t)g, &sun, stops, LIGHT_STOPS_MAX);
+    light_lut_build(&luts[g], stops, n);
+  }
+  light_gamma_build(gamma_table, LIGHTING_GAMMA);
+  parse_zones(CONFIG_LIGHTING_ZONES);
+
+  led_strip_config_t strip_cfg = {
+      .strip_gpio_num = CONFIG_LIGHTING_GPIO,
+      .max_leds = CONFIG_LIGHTING_LED_COUNT,
+      .led_model = LED_MODEL_WS2812,
+  };
+  led_strip_rmt_config_t rmt_cfg = {
+      .resolution_hz = 10 * 1000 * 1000,
+      .mem_block_symbols = 1024, // DMA buffer, the CPU does not refill the channel memory
+      .flags.with_dma = true,
+  };
+  if (led_strip_new_rmt_device(&strip_cfg, &rmt_cfg, &strip) != ESP_OK)
+  {
+    strip = NULL;
+    ESP_LOGW(TAG, "No DMA RMT channel for the lighting strip on GPIO %d", CONFIG_LIGHTING_GPIO);
+    return;
+  }
+  led_strip_clear(strip);
+
+  // below every other task: timekeeping, inputs and the LCD always win
+  xTaskCreatePinnedToCore(lighting_task, "lighting", 3072, NULL, 2, NULL, 0);
+  ESP_LOGI(TAG, "%d LEDs on GPIO %d in %u zone(s), %d fps", CONFIG_LIGHTING_LED_COUNT, CONFIG_LIGHTING_GPIO,
+           zone_count, CONFIG_LIGHTING_FPS);
+}
+
+void lighting_get_stats(lighting_stats_t *out)
+{
+  portENTER_CRITICAL(&stats_lock);
+  *out = stats;
+  portEXIT_CRITICAL(&stats_lock);
+}
+
+static int cmd_lighting(int argc, char **argv)
+{
+  // lighting at <HH:MM>|off: preview a time of day
+  if (argc == 3 && strcmp(argv[1], "at") == 0)
+  {
+    int h = 0, m = 0;
+    if (strcmp(argv[2], "off") == 0)
+      preview_pos = -1;
+    else if (sscanf(argv[2], "%d:%d", &h, &m) == 2 && h >= 0 && h < 24 && m >= 0 && m < 60)
+      preview_pos = light_day_pos((int64_t)(h * 60 + m) * 60 * 1000000);
+    else
+    {
+      printf("usage: lighting at <HH:MM>|off\n");
+      return 1;
+    }
+  }
+
+  lighting_stats_t s;
+  lighting_get_stats(&s);
+  printf("frames %lu, unchanged %lu, overruns %lu\n", s.frames, s.unchanged, s.overruns);
+  printf("compute us last %lu max %lu, refresh us last %lu max %lu\n", s.compute_us_last, s.compute_us_max,
+         s.refresh_us_last, s.refresh_us_max);
+  uint16_t pos = preview_pos >= 0 ? preview_pos : light_day_pos(timer_model_time_us(esp_timer_get_time()));
+  for (uint8_t i = 0; i < zone_count; i++)
+  {
+    uint8_t c[3];
+    light_lut_sample(&luts[zones[i].gradient], pos, zones[i].brightness, c);
+    printf("zone %u: LEDs %u-%u %s, now %u,%u,%u\n", i, zones[i].first, zones[i].first + zones[i].count - 1,
+           light_gradient_name(zones[i].gradient), c[0], c[1], c[2]);
+  }
+  return 0;
+}
+
+void lighting_register_commands(void)
+{
+  const esp_console_cmd_t lighting_cmd = {
+      .command = "lighting",
+      .help = "Layout lighting frame stats and zone colours, 'lighting at 19:30' previews a time of day",
+      .hint = "[at <HH:MM>|off]",
+      .func = cmd_lighting,
+  };
+  ESP_ERROR_CHECK(esp_console_cmd_register(&lighting_cmd));
+}
+#else
+void lighting_init(void)
+{
+  ESP_LOGD(TAG, "Layout lighting disabled");
+}
+
+void lighting_get_stats(lighting_stats_t *out)
+{
+  memset(out, 0, sizeof(*out));
+}
+
+void lighting_register_commands(void)
+{
+}
+#endif
@@ -0,0 +1,31 @@
+#ifndef LIGHTING_H
+#define LIGHTING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define LIGHTING_ZONES_MAX 16
+
+typedef struct {
+  uint32_t frames;         // strip refreshes
+  uint32_t unchanged;      // frames skipped, model time did not move (paused)
+  uint32_t overruns;       // frames that missed their slot
+  uint32_t compute_us_last;
+  uint32_t compute_us_max;
+  uint32_t refresh_us_last; // RMT DMA transfer, the task sleeps meanwhile
+  uint32_t refresh_us_max;
+} lighting_stats_t;
+
+/*
+ * Layout lighting on a WS2812 strip following the model time of day. Zones map runs of
+ * LEDs to a gradient; every frame interpolates the gradient tables at the model time
+ * in microseconds, so the light changes smoothly at any timescale. A low priority task
+ * renders and sends the frame over DMA backed RMT.
+ */
+void lighting_init(void);
+
+void lighting_get_stats(lighting_stats_t *out);
+
+void lighting_register_commands(void);
+
+#endif
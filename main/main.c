@@ -5,9 +5,18 @@
 #include "event_handler.h"
 #include "esp_random.h"
 #include "output_driver.h"
+#include "shift_out.h"
+#include "lighting.h"
+#include "audio_out.h"
 #include "button_driver.h"
+#include "encoder_driver.h"
+#include "input_expander.h"
+#include "input_capture.h"
 #include "state_machine.h"
 #include "storage.h"
+#include "history.h"
+#include "input_inject.h"
+#include "app_console.h"
 
 static const char *TAG = "main";
 
@@ -30,20 +39,30 @@ void app_main(void)
 
   events_subscribe(EVENT_MODEL_TICK, tick_logger_handler, NULL);
 
+  lighting_init(); // before the pulse engine takes the RMT channels
+  audio_out_init();
+  shift_out_init();
   output_driver_init();
 
   button_init();
+  encoder_init();
 
   ESP_LOGI(TAG, "Initializing Model Timer");
   timer_initialize();
+  input_capture_init();
 
   // init i2c and lcd
   i2c_initialize();
   lcd_initialize();
+  input_expander_init();
 
   state_machine_init();
 
+  input_inject_init();
+  app_console_init();
+
   storage_load();
+  history_init(); // after the restore, so the boot entry has the real time
 
   vTaskDelay(pdMS_TO_TICKS(3000));
 
@@ -55,8 +74,6 @@ void app_main(void)
   {
     vTaskDelay(pdMS_TO_TICKS(60 * 1000));
 
-    storage_save();
-
     ESP_LOGI(TAG, "Heartbeat, real=%llu, model=%lu", time(NULL), unix_ts);
   }
 }
@@ -2,11 +2,14 @@
 #include <sys/time.h>
 #include <time.h>
 #include "../timer.h"
+#include "../calendar.h"
 #include "../button_driver.h"
 #include "../event_handler.h"
 
 extern void editor_general_cancel(void);
 
+static uint16_t repeats = 0; // repeat events of the held UP/DOWN key
+
 // Local editor implementation (wraps the existing edit fields)
 static void realtime_begin(void)
 {
@@ -40,47 +43,21 @@ static void datetime_handle(int32_t event_id, uint8_t btn)
     }
   }
 
-  if (event_id == EVENT_BUTTON_PRESS || event_id == EVENT_BUTTON_REPEATED_PRESS)
+  if (event_id == EVENT_BUTTON_PRESS || event_id == EVENT_BUTTON_REPEATED_PRESS || event_id == EVENT_ENCODER_ROTATE)
   {
     if (state_ctx.edit_mode == EDIT_REALTIME || state_ctx.edit_mode == EDIT_MODELTIME)
     {
       if (btn == BUTTON_UP || btn == BUTTON_DOWN)
       {
-        int dir = btn == BUTTON_UP ? 1 : -1;
-        struct tm tm;
-        ts_to_tm(state_ctx.edit_timestamp, &tm);
-
-        switch (state_ctx.edit_cursor)
-        {
-        case 0: // year
-          tm.tm_year += dir;
-          break;
-
-        case 1: // month
-          tm.tm_mon += dir;
-          break;
-
-        case 2: // day
-          tm.tm_mday += dir;
-          break;
-
-        case 3: // hour
-          tm.tm_hour += dir;
-          break;
-
-        case 4: // minute
-          tm.tm_min += dir;
-          break;
-
-        case 5: // second
-          tm.tm_sec += dir;
-          break;
-
-        default:
-          break;
-        }
-
-        state_ctx.edit_timestamp = tm_to_ts(&tm);
+        // holding the key speeds up in steps that fit the field
+        if (event_id == EVENT_BUTTON_REPEATED_PRESS)
+          repeats++;
+        else
+          repeats = 0;
+
+        calendar_field_t field = (calendar_field_t)state_ctx.edit_cursor; // cursor follows the field order
+        int32_t delta = (btn == BUTTON_UP ? 1 : -1) * state_ctx.edit_step * calendar_repeat_step(field, repeats);
+        state_ctx.edit_timestamp = calendar_adjust(state_ctx.edit_timestamp, field, delta);
         events_post(EVENT_LCD_UPDATE, NULL, 0);
       }
     }
@@ -98,6 +75,7 @@ static void realtime_apply(void)
 static void modeltime_apply(void)
 {
   unix_ts = state_ctx.edit_timestamp;
+  events_post(EVENT_MODEL_TIME_SET, NULL, 0); // slave clocks catch up
 }
 
 static const char *realtime_render(int row)
@@ -16,18 +16,19 @@ void timescale_begin(void)
 
 void timescale_handle(int32_t event_id, uint8_t btn)
 {
-  if (event_id == EVENT_BUTTON_PRESS || event_id == EVENT_BUTTON_REPEATED_PRESS)
+  if (event_id == EVENT_BUTTON_PRESS || event_id == EVENT_BUTTON_REPEATED_PRESS || event_id == EVENT_ENCODER_ROTATE)
   {
     if (state_ctx.edit_mode == EDIT_TIMESCALE)
     {
       if (btn == BUTTON_UP || btn == BUTTON_DOWN)
       {
         int dir = btn == BUTTON_UP ? 1 : -1;
-        state_ctx.edit_timescale += dir;
-        if (state_ctx.edit_timescale < 1)
-          state_ctx.edit_timescale = 1;
-        if (state_ctx.edit_timescale > MAX_TIMESCALE)
-          state_ctx.edit_timescale = MAX_TIMESCALE;
+        int32_t value = (int32_t)state_ctx.edit_timescale + dir * state_ctx.edit_step;
+        if (value < 1)
+          value = 1;
+        if (value > MAX_TIMESCALE)
+          value = MAX_TIMESCALE;
+        state_ctx.edit_timescale = value;
         events_post(EVENT_LCD_UPDATE, NULL, 0);
       }
     }
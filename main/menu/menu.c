@@ -2,6 +2,7 @@
 #include "menu.h"
 #include "menu_table.h"
 #include "../event_handler.h"
+#include "../lcd_driver.h"
 
 state_ctx_t state_ctx = {
     .state = STATE_INIT,
@@ -9,7 +10,8 @@ state_ctx_t state_ctx = {
     .scroll_top = 0,
     .edit_mode = EDIT_NONE,
     .edit_timestamp = 0,
-    .edit_timescale = 0
+    .edit_timescale = 0,
+    .edit_step = 1
 };
 const editor_t *active_editor = NULL;
 
@@ -86,6 +88,14 @@ void enter_state_edit(void)
   events_post(EVENT_LCD_UPDATE, NULL, 0);
 }
 
+void enter_state_lcd_test(void)
+{
+  state_ctx.state = STATE_LCD_TEST;
+  lcd_bench_start();
+
+  events_post(EVENT_LCD_UPDATE, NULL, 0);
+}
+
 /* Utility functions */
 
 /* Check if menu entry is visible */
@@ -59,6 +59,7 @@ typedef struct
   uint32_t edit_timestamp;
   uint32_t edit_timescale;
   int8_t edit_cursor;
+  int16_t edit_step; // units per UP/DOWN event, more than 1 for a fast turned encoder
 } state_ctx_t;
 
 extern state_ctx_t state_ctx;
@@ -81,5 +82,6 @@ void menu_select(void);
 void enter_state_clock(void);
 void enter_state_menu(void);
 void enter_state_edit(void);
+void enter_state_lcd_test(void);
 
 #endif
\ No newline at end of file
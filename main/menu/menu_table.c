@@ -3,11 +3,13 @@
 extern const menu_entry_t menu_item_realtime;
 extern const menu_entry_t menu_item_modeltime;
 extern const menu_entry_t menu_item_timescale;
+extern const menu_entry_t menu_item_lcd_test;
 
 const menu_entry_t *menu_table[] = {
     &menu_item_realtime,
     &menu_item_modeltime,
     &menu_item_timescale,
+    &menu_item_lcd_test,
 };
 
 const uint8_t menu_table_count = sizeof(menu_table) / sizeof(menu_table[0]);
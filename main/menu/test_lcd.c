@@ -0,0 +1,17 @@
+#include <stddef.h>
+#include "menu.h"
+
+static void lcd_test_open(void *arg)
+{
+  (void)arg;
+  enter_state_lcd_test();
+}
+
+/* final menu entry (exported symbol referenced by menu_table.c) */
+const menu_entry_t menu_item_lcd_test = {
+    .label = "LCD Benchmark",
+    .action = MENU_ACTION_FUNC,
+    .editor = NULL,
+    .func = lcd_test_open,
+    .arg = NULL,
+    .visible = NULL};
@@ -0,0 +1,249 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "meter_output.h"
+#include "timer.h"
+#include "driver/ledc.h"
+#include "esp_console.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char *TAG = "meter_output";
+
+#define PPM 1000000
+#define METER_LEDC_TIMER LEDC_TIMER_1 // LEDC_TIMER_0 is the status LEDs
+#define METER_LEDC_BITS LEDC_TIMER_13_BIT
+#define METER_DUTY_MAX ((1u << 13) - 1)
+#define SERVO_LEDC_TIMER LEDC_TIMER_2
+#define SERVO_LEDC_BITS LEDC_TIMER_14_BIT
+#define SERVO_PERIOD_US 20000
+#define SERVO_MIN_US 500 // end stops, the calibration narrows them per hand
+#define SERVO_MAX_US 2500
+// the fade ends a little before the next update, a new fade must not start on a running one
+#define METER_FADE_MS (CONFIG_METER_UPDATE_MS - CONFIG_METER_UPDATE_MS / 8)
+
+bool meter_cal_parse(const char *text, meter_cal_t *out)
+{
+  out->count = 0;
+  const char *p = text;
+  while (*p && out->count < METER_CAL_POINTS_MAX)
+  {
+    char *end;
+    long pos = strtol(p, &end, 10);
+    if (end == p || *end != ':')
+      return false;
+    long val = strtol(end + 1, &end, 10);
+    if (pos < 0 || pos > METER_SCALE || val < 0 || val > METER_SCALE)
+      return false;
+    if (out->count > 0 && pos <= out->position[out->count - 1])
+      return false;
+    out->position[out->count] = (uint16_t)pos;
+    out->output[out->count] = (uint16_t)val;
+    out->count++;
+    p = *end == ',' ? end + 1 : end;
+  }
+  return out->count >= 2 && *p == '\0';
+}
+
+uint32_t meter_cal_apply(const meter_cal_t *cal, uint32_t position_ppm)
+{
+  uint32_t scale = PPM / METER_SCALE;
+  if (position_ppm <= cal->position[0] * scale)
+    return cal->output[0] * scale;
+  for (uint8_t i = 1; i < cal->count; i++)
+  {
+    uint32_t p1 = cal->position[i] * scale;
+    if (position_ppm > p1)
+      continue;
+    uint32_t p0 = cal->position[i - 1] * scale;
+    int64_t o0 = cal->output[i - 1] * scale;
+    int64_t o1 = cal->output[i] * scale;
+    return (uint32_t)(o0 + (o1 - o0) * (int64_t)(position_ppm - p0) / (int64_t)(p1 - p0));
+  }
+  return cal->output[cal->count - 1] * scale;
+}
+
+#if CONFIG_METER_ENABLE
+
+typedef struct {
+  int pin; // -1 = disabled
+  meter_kind_t kind;
+  bool servo;
+  meter_cal_t cal;
+  ledc_channel_t channel;
+  uint32_t position_ppm; // dial position of the last update
+  uint32_t output_ppm;
+  uint32_t duty;         // target of the last fade
+  int32_t park_ppm;      // console override of the output, -1 = follow the model time
+} meter_channel_t;
+
+static meter_channel_t meters[METER_CHANNELS];
+static esp_timer_handle_t update_timer = NULL;
+
+static uint32_t dial_ppm(meter_kind_t kind, int64_t model_us)
+{
+  switch (kind)
+  {
+  case METER_KIND_SECONDS:
+    return (uint32_t)((model_us % 60000000LL) / 60);
+  case METER_KIND_MINUTES:
+    return (uint32_t)((model_us % 3600000000LL) / 3600);
+  default:
+    return (uint32_t)((model_us % 43200000000LL) / 43200);
+  }
+}
+
+static uint32_t duty_for(const meter_channel_t *m, uint32_t output_ppm)
+{
+  if (!m->servo)
+    return (uint32_t)((uint64_t)output_ppm * METER_DUTY_MAX / PPM);
+  uint32_t pulse_us = SERVO_MIN_US + (uint32_t)((uint64_t)output_ppm * (SERVO_MAX_US - SERVO_MIN_US) / PPM);
+  return pulse_us * (1u << 14) / SERVO_PERIOD_US;
+}
+
+// Every METER_UPDATE_MS: aim each needle at where it has to be at the next update
+static void meter_update(void *arg)
+{
+  int64_t model_us = timer_model_time_us(esp_timer_get_time());
+  if (timer_is_running())
+    model_us += (int64_t)CONFIG_METER_UPDATE_MS * 1000 * timer_get_timescale();
+
+  for (int i = 0; i < METER_CHANNELS; i++)
+  {
+    meter_channel_t *m = &meters[i];
+    if (m->pin < 0)
+      continue;
+    uint32_t pos = dial_ppm(m->kind, model_us);
+    bool wrapped = pos < m->position_ppm; // top of the dial or a jump back: no sweep
+    m->position_ppm = pos;
+    m->output_ppm = m->park_ppm >= 0 ? (uint32_t)m->park_ppm : meter_cal_apply(&m->cal, pos);
+    uint32_t duty = duty_for(m, m->output_ppm);
+    if (duty == m->duty)
+      continue; // paused
+    m->duty = duty;
+
+    if (wrapped)
+    {
+      ledc_set_duty(LEDC_LOW_SPEED_MODE, m->channel, duty);
+      ledc_update_duty(LEDC_LOW_SPEED_MODE, m->channel);
+    }
+    else
+    {
+      ledc_set_fade_with_time(LEDC_LOW_SPEED_MODE, m->channel, duty, METER_FADE_MS);
+      ledc_fade_start(LEDC_LOW_SPEED_MODE, m->channel, LEDC_FADE_NO_WAIT);
+    }
+  }
+}
+
+static void meter_channel_init(int i, int pin, meter_kind_t kind, bool servo, const char *cal)
+{
+  meter_channel_t *m = &meters[i];
+  m->pin = pin;
+  m->kind = kind;
+  m->servo = servo;
+  m->channel = (ledc_channel_t)(LEDC_CHANNEL_2 + i);
+  m->park_ppm = -1;
+  if (pin < 0)
+    return;
+  if (!meter_cal_parse(cal, &m->cal))
+  {
+    ESP_LOGW(TAG, "Calibration of meter %d malformed, using a straight line", i);
+    meter_cal_parse("0:0,1000:1000", &m->cal);
+  }
+
+  ledc_channel_config_t cfg = {
+      .gpio_num = pin,
+      .speed_mode = LEDC_LOW_SPEED_MODE,
+      .channel = m->channel,
+      .intr_type = LEDC_INTR_DISABLE,
+      .timer_sel = servo ? SERVO_LEDC_TIMER : METER_LEDC_TIMER,
+      .duty = 0,
+      .hpoint = 0,
+  };
+  ESP_ERROR_CHECK(ledc_channel_config(&cfg));
+  ESP_LOGI(TAG, "Meter %d (%s) on GPIO %d", i, servo ? "servo" : "moving coil", pin);
+}
+
+void meter_output_init(void)
+{
+  meter_channel_init(0, CONFIG_METER_CH0_GPIO, METER_KIND_HOURS, CONFIG_METER_CH0_TYPE == 1, CONFIG_METER_CH0_CAL);
+  meter_channel_init(1, CONFIG_METER_CH1_GPIO, METER_KIND_MINUTES, CONFIG_METER_CH1_TYPE == 1, CONFIG_METER_CH1_CAL);
+  meter_channel_init(2, CONFIG_METER_CH2_GPIO, METER_KIND_SECONDS, CONFIG_METER_CH2_TYPE == 1, CONFIG_METER_CH2_CAL);
+
+  ledc_timer_config_t meter_timer = {
+      .speed_mode = LEDC_LOW_SPEED_MODE,
+      .duty_resolution = METER_LEDC_BITS,
+      .timer_num = METER_LEDC_TIMER,
+      .freq_hz = CONFIG_METER_PWM_HZ,
+      .clk_cfg = LEDC_AUTO_CLK,
+  };
+  ESP_ERROR_CHECK(ledc_timer_config(&meter_timer));
+  ledc_timer_config_t servo_timer = {
+      .speed_mode = LEDC_LOW_SPEED_MODE,
+      .duty_resolution = SERVO_LEDC_BITS,
+      .timer_num = SERVO_LEDC_TIMER,
+      .freq_hz = 1000000 / SERVO_PERIOD_US,
+      .clk_cfg = LEDC_AUTO_CLK,
+  };
+  ESP_ERROR_CHECK(ledc_timer_config(&servo_timer));
+  ESP_ERROR_CHECK(ledc_fade_func_install(0));
+
+  const esp_timer_create_args_t update_args = {
+      .callback = meter_update,
+      .dispatch_method = ESP_TIMER_TASK,
+      .name = "meter_update",
+  };
+  ESP_ERROR_CHECK(esp_timer_create(&update_args, &update_timer));
+  ESP_ERROR_CHECK(esp_timer_start_periodic(update_timer, CONFIG_METER_UPDATE_MS * 1000));
+}
+
+static const char *kind_names[] = {"hours", "minutes", "seconds"};
+
+static int cmd_meters(int argc, char **argv)
+{
+  // meters park <ch> <per mille>|off: hold a needle at a raw output to read the calibration
+  if (argc == 4 && strcmp(argv[1], "park") == 0)
+  {
+    int i = atoi(argv[2]);
+    if (i < 0 || i >= METER_CHANNELS || meters[i].pin < 0)
+    {
+      printf("usage: meters park <channel> <0..1000>|off\n");
+      return 1;
+    }
+    int park = atoi(argv[3]);
+    park = park < 0 ? 0 : park > METER_SCALE ? METER_SCALE : park;
+    meters[i].park_ppm = strcmp(argv[3], "off") == 0 ? -1 : park * (PPM / METER_SCALE);
+  }
+
+  for (int i = 0; i < METER_CHANNELS; i++)
+  {
+    const meter_channel_t *m = &meters[i];
+    if (m->pin < 0)
+      continue;
+    printf("meter %d %s%s: dial %lu.%01lu%%, output %lu.%01lu%%, duty %lu%s\n", i, kind_names[m->kind],
+           m->servo ? " servo" : "", m->position_ppm / 10000, m->position_ppm / 1000 % 10, m->output_ppm / 10000,
+           m->output_ppm / 1000 % 10, m->duty, m->park_ppm >= 0 ? " (parked)" : "");
+  }
+  return 0;
+}
+
+void meter_output_register_commands(void)
+{
+  const esp_console_cmd_t meters_cmd = {
+      .command = "meters",
+      .help = "Analog meter needles, 'meters park 1 500' holds meter 1 at half output for calibration",
+      .hint = "[park <channel> <0..1000>|off]",
+      .func = cmd_meters,
+  };
+  ESP_ERROR_CHECK(esp_console_cmd_register(&meters_cmd));
+}
+#else
+void meter_output_init(void)
+{
+  ESP_LOGD(TAG, "Meter outputs disabled");
+}
+
+void meter_output_register_commands(void)
+{
+}
+#endif
@@ -0,0 +1,40 @@
+#ifndef METER_OUTPUT_H
+#define METER_OUTPUT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define METER_CHANNELS 3
+#define METER_CAL_POINTS_MAX 8
+#define METER_SCALE 1000 // per mille of the dial / of the output range
+
+typedef enum {
+  METER_KIND_HOURS = 0, // 12 h dial
+  METER_KIND_MINUTES,
+  METER_KIND_SECONDS,
+} meter_kind_t;
+
+/* Dial position to output, piecewise linear; points sorted by position */
+typedef struct {
+  uint16_t position[METER_CAL_POINTS_MAX]; // per mille of the dial
+  uint16_t output[METER_CAL_POINTS_MAX];   // per mille of the output range
+  uint8_t count;
+} meter_cal_t;
+
+/*
+ * Moving-coil meters and servo hands on LEDC. Every update the duty the needle should
+ * have at the next update is computed from sub-second model time, and an LEDC hardware
+ * fade ramps there in the meantime, so the needle moves continuously at any timescale.
+ * Set up by output_driver_init().
+ */
+void meter_output_init(void);
+
+// "pos:out,pos:out,..." in per mille, false if malformed
+bool meter_cal_parse(const char *text, meter_cal_t *out);
+
+// Output for a dial position, both in ppm for a smooth needle
+uint32_t meter_cal_apply(const meter_cal_t *cal, uint32_t position_ppm);
+
+void meter_output_register_commands(void);
+
+#endif
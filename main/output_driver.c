@@ -6,170 +6,412 @@
 #include "freertos/semphr.h"
 #include "timer.h"
 #include "esp_log.h"
-#include "led_strip.h"
+#include "status_led.h"
+#include "meter_output.h"
+#include "pulse_engine.h"
+#include "pulse_pattern.h"
+#include "storage.h"
+#include "history.h"
+#include "esp_timer.h"
+#include "esp_console.h"
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 
-#define CLOCK_CHANNEL_COUNT 3
+#define CLOCK_CHANNEL_COUNT OUTPUT_CLOCK_CHANNELS
+#define CATCHUP_POLL_MS 50
 
 static const char *TAG = "output_driver";
 
 /* clock channel config */
 typedef struct
 {
-  int pin;           // -1 = disabled
-  bool enabled;      // enabled if pin >= 0 (and optionally toggled by config)
-  uint32_t pulse_ms; // ON time per pulse
-  uint32_t gap_ms;   // gap between pulses
-  uint8_t count;     // number of pulses in a sequence
-  const char *name;  // friendly name for logs
+  int pin;                 // -1 = disabled
+  int pin_b;               // second pin of an H-bridge pair, -1 = single output
+  bool enabled;            // enabled if pin >= 0 (and optionally toggled by config)
+  pulse_pattern_t pattern; // impulse shape and when it fires
+  const char *name;        // friendly name for logs
+  pulse_seq_t seq;         // compiled pattern, the pulse engine references it
+
+  /* hands, 0 dial = not tracked (strikes) */
+  uint32_t dial;           // steps around the dial
+  uint32_t position;       // step the hands show
+  uint32_t step_ms;        // fastest safe sequence rate
+  uint32_t owed;           // catch-up steps left
+  uint32_t hold;           // due steps to skip while the hands are ahead
+  uint32_t catchup_total;
+  uint32_t catchup_done;
+  int64_t catchup_start_us;
+  int64_t next_us;         // earliest next catch-up step
+
+  /* due steps waiting for the other output of an H-bridge pair */
+  uint32_t deferred;
+  pulse_due_t deferred_due; // repeats and output of an untracked channel (strikes)
 } clock_channel_t;
 
-/* Pulse worker param — allocated on heap then freed by worker */
-typedef struct
-{
-  int pin;
-  uint32_t pulse_ms;
-  uint32_t gap_ms;
-  uint8_t count;
-  const char *name;
-} pulse_worker_arg_t;
-
-/* discrete LED pins (active-high) */
-static int pin_green = -1;
-static int pin_red = -1;
-
 /* clock channels array */
 static clock_channel_t clock_channels[CLOCK_CHANNEL_COUNT];
+static portMUX_TYPE hands_lock = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t catchup_timer = NULL;
+static SemaphoreHandle_t step_mutex = NULL; // recursive; steps, catch-up counts and positions change under it
+
+/* Externally invoked when timer state changes. Only posts the target, status_led animates it. */
+static void timer_state_handler(void *handler_arg, esp_event_base_t base, int32_t id, void *event_data)
+{
+  // green on when running, red breathing when paused
+  status_led_set_mode(timer_is_running() ? STATUS_LED_RUNNING : STATUS_LED_PAUSED);
+}
 
-/* neopixel strip handle (NULL if not present) */
-static led_strip_handle_t strip = NULL;
+/* Queue one sequence and advance the hands. Tracked pairs alternate by hand position,
+   so catch-up steps keep the coil polarity right. The two outputs of a pair play on
+   separate RMT channels and would overlap, shorting the H-bridge: while the other one
+   still runs nothing is queued and ESP_ERR_NOT_FINISHED returned. */
+static esp_err_t clock_step(int i, const pulse_due_t *due)
+{
+    clock_channel_t *ch = &clock_channels[i];
+    xSemaphoreTakeRecursive(step_mutex, portMAX_DELAY);
+    portENTER_CRITICAL(&hands_lock);
+    uint32_t pos = ch->position;
+    portEXIT_CRITICAL(&hands_lock);
+
+    uint8_t out = ch->dial && ch->pattern.alternating ? (pos & 1) : due->output;
+    esp_err_t err = ESP_ERR_NOT_FINISHED;
+    if (ch->pin_b < 0 || pulse_engine_pending(i * 2 + !out) == 0)
+        err = pulse_engine_trigger(i * 2 + out, 0, due->repeats);
+    if (err == ESP_OK && ch->dial) {
+        portENTER_CRITICAL(&hands_lock);
+        ch->position = (pos + 1) % ch->dial;
+        portEXIT_CRITICAL(&hands_lock);
+    }
+    xSemaphoreGiveRecursive(step_mutex);
 
-/* current neopixel color stored so pulses (if implemented later) can restore it */
-static uint8_t np_r = 0, np_g = 0, np_b = 0;
-static SemaphoreHandle_t np_mutex = NULL;
+    if (err == ESP_OK) history_count_pulse(i, true);
+    return err;
+}
 
-/* forward declarations */
-static inline void safe_gpio_set(int pin, int level);
-static void _set_neopixel_rgb_locked(uint8_t r, uint8_t g, uint8_t b);
+/* Keep a due step until the pair is idle, catchup_poll() queues it then. Tracked channels
+   count a few steps, their output follows the hands; the others keep a single due. */
+static bool clock_defer(int i, const pulse_due_t *due)
+{
+    clock_channel_t *ch = &clock_channels[i];
+    if (ch->deferred >= (ch->dial ? PULSE_ENGINE_QUEUE_DEPTH : 1)) return false;
+    portENTER_CRITICAL(&hands_lock);
+    ch->deferred++;
+    ch->deferred_due = *due;
+    portEXIT_CRITICAL(&hands_lock);
+    if (!esp_timer_is_active(catchup_timer))
+        esp_timer_start_periodic(catchup_timer, CATCHUP_POLL_MS * 1000);
+    return true;
+}
 
-/* Externally invoked when timer state changes. Keep the handler minimal and fast. */
-static void timer_state_handler(void *handler_arg, esp_event_base_t base, int32_t id, void *event_data)
+/* Model tick handler: queue the prepared sequence of every channel whose pattern is due.
+   The pulse engine times the edges, sequences of one output wait in its queue, those
+   for the other output of a pair are deferred until the first is done.
+   Called on EVENT_MODEL_TICK.
+*/
+static void model_tick_handler(void *handler_arg, esp_event_base_t base, int32_t id, void *event_data)
 {
-  // fast check
-  bool running = timer_is_running();
-
-  // green on when running, red on when paused
-  safe_gpio_set(pin_green, running ? 1 : 0);
-  safe_gpio_set(pin_red, running ? 0 : 1);
-
-  // set neopixel color to green/red and store it
-  if (np_mutex)
-    xSemaphoreTake(np_mutex, portMAX_DELAY);
-  if (running)
-  {
-    _set_neopixel_rgb_locked(0, 255, 0); // green
-  }
-  else
-  {
-    _set_neopixel_rgb_locked(255, 0, 0); // red
-  }
-  if (np_mutex)
-    xSemaphoreGive(np_mutex);
+    uint32_t ts = *(uint32_t *)event_data;
+    for (int i = 0; i < CLOCK_CHANNEL_COUNT; ++i) {
+        clock_channel_t *ch = &clock_channels[i];
+        if (!ch->enabled) continue;
+
+        pulse_due_t due = pulse_pattern_due(&ch->pattern, ts);
+        if (!due.fire) continue;
+
+        // hands ahead of the model time wait here
+        bool skip = false;
+        portENTER_CRITICAL(&hands_lock);
+        if (ch->hold > 0) {
+            ch->hold--;
+            skip = true;
+        }
+        portEXIT_CRITICAL(&hands_lock);
+        if (skip) continue;
+
+        // behind earlier deferred steps, in order
+        esp_err_t err = ch->deferred ? ESP_ERR_NOT_FINISHED : clock_step(i, &due);
+        if (err == ESP_ERR_NOT_FINISHED && clock_defer(i, &due)) continue;
+
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "Pulse sequence for %s not queued", ch->name);
+            status_led_error(STATUS_LED_ERR_PULSE_QUEUE);
+            history_count_pulse(i, false);
+        } else if (ch->pattern.type == PULSE_PATTERN_MINUTE) {
+            status_led_flash();
+        }
+    }
 }
 
-/* Worker task that executes pulse sequence for a single channel, then deletes itself */
-static void pulse_worker(void *pv)
+/* One catch-up step of a channel, under step_mutex: the step and its count go together,
+   a resync never lands in between */
+static void catchup_step(int i, int64_t now)
 {
-  pulse_worker_arg_t *a = (pulse_worker_arg_t *)pv;
-  if (!a)
-    vTaskDelete(NULL);
-
-  ESP_LOGD(TAG, "Pulse worker started for %s pin=%d pulse=%ums gap=%ums count=%u",
-           a->name, a->pin, (unsigned)a->pulse_ms, (unsigned)a->gap_ms, (unsigned)a->count);
-
-  // Run sequence: turn on -> wait pulse_ms -> turn off -> gap -> repeat
-  for (uint8_t i = 0; i < a->count; ++i)
-  {
-    if (a->pin >= 0)
-    {
-      safe_gpio_set(a->pin, 1);
+    clock_channel_t *ch = &clock_channels[i];
+    if (pulse_engine_pending(i * 2) + pulse_engine_pending(i * 2 + 1) > 0) return;
+
+    if (ch->deferred > 0) {
+        portENTER_CRITICAL(&hands_lock);
+        pulse_due_t due = ch->deferred_due;
+        portEXIT_CRITICAL(&hands_lock);
+        if (clock_step(i, &due) != ESP_OK) return;
+        portENTER_CRITICAL(&hands_lock);
+        ch->deferred--;
+        portEXIT_CRITICAL(&hands_lock);
+        return;
     }
-    vTaskDelay(pdMS_TO_TICKS(a->pulse_ms));
-    if (a->pin >= 0)
-    {
-      safe_gpio_set(a->pin, 0);
+    if (ch->owed == 0 || now < ch->next_us) return;
+
+    pulse_due_t due = {.fire = true, .output = 0, .repeats = 1};
+    if (clock_step(i, &due) != ESP_OK) return;
+    portENTER_CRITICAL(&hands_lock);
+    ch->owed--;
+    ch->catchup_done++;
+    portEXIT_CRITICAL(&hands_lock);
+    ch->next_us = now + ch->step_ms * 1000LL;
+
+    if (ch->owed == 0) {
+        uint32_t ms = (uint32_t)((now - ch->catchup_start_us) / 1000);
+        ESP_LOGI(TAG, "%s caught up: %lu steps in %lu.%01lu s (%lu.%02lu steps/s)", ch->name, ch->catchup_done,
+                 ms / 1000, ms % 1000 / 100, ms ? ch->catchup_done * 1000 / ms : 0,
+                 ms ? ch->catchup_done * 100000 / ms % 100 : 0);
     }
-    if (i + 1 < a->count)
-    {
-      vTaskDelay(pdMS_TO_TICKS(a->gap_ms));
+}
+
+/* Catch-up: one step per channel whenever its outputs are idle and the safe rate allows,
+   normal impulses queue in between. Deferred steps go first and need no rate, every
+   sequence ends with its gap. */
+static void catchup_poll(void *arg)
+{
+    int64_t now = esp_timer_get_time();
+    bool active = false;
+    for (int i = 0; i < CLOCK_CHANNEL_COUNT; ++i) {
+        clock_channel_t *ch = &clock_channels[i];
+        if (!ch->enabled || (ch->owed == 0 && ch->deferred == 0)) continue;
+        active = true;
+        xSemaphoreTakeRecursive(step_mutex, portMAX_DELAY);
+        catchup_step(i, now);
+        xSemaphoreGiveRecursive(step_mutex);
     }
-  }
+    if (!active) esp_timer_stop(catchup_timer);
+}
 
-  ESP_LOGD(TAG, "Pulse worker finished for %s", a->name);
+/* Plan the way from the hand positions to the model time: drive forward at the safe rate
+   or let the model time catch up, whichever is quicker. Runs on the event loop, like the
+   tick handler; step_mutex keeps the catch-up timer out meanwhile. */
+static void clock_resync(void)
+{
+    uint32_t ts = unix_ts;
+    uint32_t timescale = timer_get_timescale();
+    bool drive = false;
+    xSemaphoreTakeRecursive(step_mutex, portMAX_DELAY);
+    for (int i = 0; i < CLOCK_CHANNEL_COUNT; ++i) {
+        clock_channel_t *ch = &clock_channels[i];
+        if (!ch->enabled || ch->dial == 0) continue;
+
+        uint32_t target = pulse_pattern_dial_position(&ch->pattern, ts);
+        uint32_t model_step_ms = (ch->pattern.type == PULSE_PATTERN_MINUTE ? 60000 : 1000) / timescale;
+        portENTER_CRITICAL(&hands_lock);
+        pulse_catchup_t plan = pulse_catchup_plan(ch->dial, ch->position, target, ch->step_ms, model_step_ms);
+        ch->owed = plan.drive;
+        ch->hold = plan.hold;
+        ch->deferred = 0; // part of the plan now
+        ch->catchup_total = plan.drive;
+        ch->catchup_done = 0;
+        portEXIT_CRITICAL(&hands_lock);
+        ch->catchup_start_us = esp_timer_get_time();
+        ch->next_us = 0;
+
+        if (plan.drive || plan.hold)
+            ESP_LOGI(TAG, "%s hands at %lu, model at %lu: drive %lu, hold %lu steps", ch->name, ch->position,
+                     target, plan.drive, plan.hold);
+        drive |= plan.drive > 0;
+    }
+    xSemaphoreGiveRecursive(step_mutex);
+    if (drive && !esp_timer_is_active(catchup_timer))
+        esp_timer_start_periodic(catchup_timer, CATCHUP_POLL_MS * 1000);
+}
 
-  // free args and exit
-  vPortFree(a);
-  vTaskDelete(NULL);
+// EVENT_MODEL_TIME_SET and EVENT_HANDS_SET
+static void resync_handler(void *handler_arg, esp_event_base_t base, int32_t id, void *event_data)
+{
+    clock_resync();
 }
 
-/* Minute tick handler: spawn a worker per enabled channel so pulses can run in parallel.
-   Called on EVENT_MODEL_MINUTE_TICK.
-*/
-static void minute_tick_handler(void *handler_arg, esp_event_base_t base, int32_t id, void *event_data)
+void output_clock_set_positions(const uint16_t *positions)
 {
-    // iterate channels and create a worker for each enabled channel with valid pin
     for (int i = 0; i < CLOCK_CHANNEL_COUNT; ++i) {
         clock_channel_t *ch = &clock_channels[i];
-        if (!ch->enabled || ch->pin < 0) continue;
+        if (ch->dial == 0) continue;
+        // never saved: take the hands as right for the current model time
+        uint32_t pos = positions[i] == OUTPUT_HANDS_UNKNOWN ? pulse_pattern_dial_position(&ch->pattern, unix_ts)
+                                                             : positions[i] % ch->dial;
+        portENTER_CRITICAL(&hands_lock);
+        ch->position = pos;
+        portEXIT_CRITICAL(&hands_lock);
+    }
+}
+
+void output_clock_get_positions(uint16_t *positions)
+{
+    for (int i = 0; i < CLOCK_CHANNEL_COUNT; ++i) {
+        positions[i] = clock_channels[i].dial ? clock_channels[i].position : OUTPUT_HANDS_UNKNOWN;
+    }
+}
+
+bool output_clock_get_catchup(uint8_t channel, output_catchup_t *out)
+{
+    if (channel >= CLOCK_CHANNEL_COUNT || clock_channels[channel].dial == 0) return false;
+    clock_channel_t *ch = &clock_channels[channel];
+    portENTER_CRITICAL(&hands_lock);
+    out->position = ch->position;
+    out->total = ch->catchup_total;
+    out->done = ch->catchup_done;
+    out->hold = ch->hold;
+    portEXIT_CRITICAL(&hands_lock);
+    uint32_t ms = (uint32_t)((esp_timer_get_time() - ch->catchup_start_us) / 1000);
+    out->steps_per_s_x100 = out->done && ms ? out->done * 100000 / ms : 0;
+    return true;
+}
 
-        // allocate args for worker
-        pulse_worker_arg_t *arg = pvPortMalloc(sizeof(pulse_worker_arg_t));
-        if (!arg) {
-            ESP_LOGW(TAG, "Failed to allocate pulse_worker_arg for channel %s", ch->name);
-            continue;
+static int cmd_hands(int argc, char **argv)
+{
+    // hands set <ch> <HH:MM|SS>: where the hands really are, then drive to the model time
+    if (argc == 4 && strcmp(argv[1], "set") == 0) {
+        int i = atoi(argv[2]);
+        int a = 0, b = 0;
+        int n = sscanf(argv[3], "%d:%d", &a, &b);
+        if (i < 0 || i >= CLOCK_CHANNEL_COUNT || clock_channels[i].dial == 0 || n < 1) {
+            printf("usage: hands set <channel> <HH:MM> (minute) | <SS> (second)\n");
+            return 1;
         }
-        arg->pin = ch->pin;
-        arg->pulse_ms = ch->pulse_ms;
-        arg->gap_ms = ch->gap_ms;
-        arg->count = ch->count;
-        arg->name = ch->name;
-
-        // spawn worker with small stack (task will delete itself)
-        BaseType_t ok = xTaskCreatePinnedToCore(pulse_worker, "pulse_worker", 2048, arg, 8, NULL, tskNO_AFFINITY);
-        if (ok != pdPASS) {
-            ESP_LOGW(TAG, "Failed to create pulse worker for %s", ch->name);
-            vPortFree(arg);
+        // only this channel; under step_mutex, so a step in flight does not put back its old position
+        clock_channel_t *ch = &clock_channels[i];
+        int pos = (n == 2 ? a * 60 + b : a) % (int)ch->dial;
+        xSemaphoreTakeRecursive(step_mutex, portMAX_DELAY);
+        portENTER_CRITICAL(&hands_lock);
+        ch->position = pos < 0 ? pos + ch->dial : pos;
+        portEXIT_CRITICAL(&hands_lock);
+        xSemaphoreGiveRecursive(step_mutex);
+        events_post(EVENT_HANDS_SET, NULL, 0); // the plan is made on the event loop
+        storage_request_save();
+    }
+
+    for (uint8_t i = 0; i < CLOCK_CHANNEL_COUNT; ++i) {
+        output_catchup_t c;
+        if (!output_clock_get_catchup(i, &c)) continue;
+        printf("%s: at %lu/%lu, catch-up %lu/%lu (%lu.%02lu steps/s), hold %lu\n", clock_channels[i].name,
+               c.position, clock_channels[i].dial, c.done, c.total, c.steps_per_s_x100 / 100,
+               c.steps_per_s_x100 % 100, c.hold);
+    }
+    return 0;
+}
+
+void output_clock_register_commands(void)
+{
+    const esp_console_cmd_t hands_cmd = {
+        .command = "hands",
+        .help = "Slave clock hand positions and catch-up progress, 'hands set 0 10:15' corrects channel 0",
+        .hint = "[set <channel> <HH:MM>]",
+        .func = cmd_hands,
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&hands_cmd));
+}
+
+/* Compile the pattern of a channel into both outputs of the pair (A only for single pins) */
+static void prepare_clock_channel(int i)
+{
+    clock_channel_t *ch = &clock_channels[i];
+    if (ch->pin < 0) return;
+
+    ch->pattern.alternating = ch->pin_b >= 0;
+    if (!pulse_pattern_compile(&ch->pattern, &ch->seq)) {
+        ESP_LOGW(TAG, "Pattern of %s does not compile", ch->name);
+        ch->enabled = false;
+        return;
+    }
+
+    // the hands are assumed right until storage tells otherwise
+    ch->dial = pulse_pattern_dial_steps(&ch->pattern);
+    ch->position = pulse_pattern_dial_position(&ch->pattern, unix_ts);
+    ch->step_ms = pulse_pattern_step_ms(&ch->pattern);
+
+    int pins[2] = {ch->pin, ch->pin_b};
+    for (int k = 0; k < 2; ++k) {
+        if (pins[k] < 0) continue;
+        if (pulse_engine_add_output(i * 2 + k, pins[k]) != ESP_OK ||
+            pulse_engine_set_slot(i * 2 + k, 0, &ch->seq) != ESP_OK) {
+            ch->enabled = false;
         }
     }
 }
 
+/* impulse timing for a pattern type from CONFIG values */
+static pulse_pattern_t default_pattern(int type)
+{
+    pulse_pattern_t p = {
+        .type     = (pulse_pattern_type_t)type,
+        .pulse_ms = CONFIG_OUTPUT_CHANNEL_DEFAULT_PERIOD_MS,
+        .gap_ms   = CONFIG_OUTPUT_CHANNEL_DEFAULT_GAP_MS,
+        .count    = CONFIG_OUTPUT_CHANNEL_DEFAULT_PULSE_COUNT,
+    };
+    if (p.type == PULSE_PATTERN_SECOND) {
+        p.pulse_ms = CONFIG_OUTPUT_SECOND_PULSE_MS;
+    } else if (p.type == PULSE_PATTERN_HOUR_STRIKE) {
+        p.pulse_ms = CONFIG_OUTPUT_STRIKE_PULSE_MS;
+        p.gap_ms   = CONFIG_OUTPUT_STRIKE_GAP_MS;
+    }
+    return p;
+}
+
 /* initialize clock channel table from CONFIG values and defaults */
 static void init_clock_channels(void)
 {
     // CH0 maps to the amber LED pin
-    clock_channels[0].pin = (CONFIG_CLOCK_OUT_CH0_GPIO >= 0) ? CONFIG_CLOCK_OUT_CH0_GPIO : -1;
+    clock_channels[0].pin     = (CONFIG_CLOCK_OUT_CH0_GPIO >= 0) ? CONFIG_CLOCK_OUT_CH0_GPIO : -1;
+    clock_channels[0].pin_b   = CONFIG_CLOCK_OUT_CH0_GPIO_B;
     clock_channels[0].enabled = (clock_channels[0].pin >= 0);
-    clock_channels[0].pulse_ms = CONFIG_OUTPUT_CHANNEL_DEFAULT_PERIOD_MS;
-    clock_channels[0].gap_ms   = CONFIG_OUTPUT_CHANNEL_DEFAULT_GAP_MS;
-    clock_channels[0].count    = CONFIG_OUTPUT_CHANNEL_DEFAULT_PULSE_COUNT;
-    clock_channels[0].name     = "CH0";
+    clock_channels[0].pattern = default_pattern(CONFIG_CLOCK_OUT_CH0_PATTERN);
+    clock_channels[0].name    = "CH0";
 
     // CH1
-    clock_channels[1].pin = (CONFIG_CLOCK_OUT_CH1_GPIO >= 0) ? CONFIG_CLOCK_OUT_CH1_GPIO : -1;
+    clock_channels[1].pin     = (CONFIG_CLOCK_OUT_CH1_GPIO >= 0) ? CONFIG_CLOCK_OUT_CH1_GPIO : -1;
+    clock_channels[1].pin_b   = CONFIG_CLOCK_OUT_CH1_GPIO_B;
     clock_channels[1].enabled = (clock_channels[1].pin >= 0);
-    clock_channels[1].pulse_ms = CONFIG_OUTPUT_CHANNEL_DEFAULT_PERIOD_MS;
-    clock_channels[1].gap_ms   = CONFIG_OUTPUT_CHANNEL_DEFAULT_GAP_MS;
-    clock_channels[1].count    = CONFIG_OUTPUT_CHANNEL_DEFAULT_PULSE_COUNT;
-    clock_channels[1].name     = "CH1";
+    clock_channels[1].pattern = default_pattern(CONFIG_CLOCK_OUT_CH1_PATTERN);
+    clock_channels[1].name    = "CH1";
 
     // CH2
-    clock_channels[2].pin = (CONFIG_CLOCK_OUT_CH2_GPIO >= 0) ? CONFIG_CLOCK_OUT_CH2_GPIO : -1;
+    clock_channels[2].pin     = (CONFIG_CLOCK_OUT_CH2_GPIO >= 0) ? CONFIG_CLOCK_OUT_CH2_GPIO : -1;
+    clock_channels[2].pin_b   = CONFIG_CLOCK_OUT_CH2_GPIO_B;
     clock_channels[2].enabled = (clock_channels[2].pin >= 0);
-    clock_channels[2].pulse_ms = CONFIG_OUTPUT_CHANNEL_DEFAULT_PERIOD_MS;
-    clock_channels[2].gap_ms   = CONFIG_OUTPUT_CHANNEL_DEFAULT_GAP_MS;
-    clock_channels[2].count    = CONFIG_OUTPUT_CHANNEL_DEFAULT_PULSE_COUNT;
-    clock_channels[2].name     = "CH2";
+    clock_channels[2].pattern = default_pattern(CONFIG_CLOCK_OUT_CH2_PATTERN);
+    clock_channels[2].name    = "CH2";
+
+#if SHIFT_OUT_CLOCK_CHANNELS > 0
+    // chain channels: bit pairs for H-bridges, or one bit each
+    static char names[SHIFT_OUT_CLOCK_CHANNELS][8];
+    for (int k = 0; k < SHIFT_OUT_CLOCK_CHANNELS; ++k) {
+        clock_channel_t *ch = &clock_channels[3 + k];
+#if CONFIG_SHIFT_OUT_CLOCK_PAIRS
+        ch->pin   = PULSE_TARGET_SHIFT(k * 2);
+        ch->pin_b = PULSE_TARGET_SHIFT(k * 2 + 1);
+#else
+        ch->pin   = PULSE_TARGET_SHIFT(k);
+        ch->pin_b = -1;
+#endif
+        ch->enabled = true;
+        ch->pattern = default_pattern(CONFIG_SHIFT_OUT_CLOCK_PATTERN);
+        snprintf(names[k], sizeof(names[k]), "SR%d", k);
+        ch->name = names[k];
+    }
+#endif
+}
+
+void output_lamp_set(uint16_t lamp, bool on)
+{
+    if (lamp >= OUTPUT_LAMP_CHANNELS) return;
+    shift_out_set(OUTPUT_SHIFT_CLOCK_BITS + lamp, on);
 }
 
 /* Initialize GPIOs and neopixel, subscribe to events */
@@ -177,64 +419,31 @@ void output_driver_init(void)
 {
     ESP_LOGI(TAG, "Initializing output_driver");
 
-    /* discrete LEDs */
-    pin_green = (CONFIG_LED_GREEN_GPIO >= 0) ? CONFIG_LED_GREEN_GPIO : -1;
-    pin_red   = (CONFIG_LED_RED_GPIO   >= 0) ? CONFIG_LED_RED_GPIO   : -1;
-
     init_clock_channels();
 
-    /* configure output GPIOs: green/red and all clock pins */
-    uint64_t pin_mask = 0;
-    if (pin_green >= 0) pin_mask |= (1ULL << pin_green);
-    if (pin_red   >= 0) pin_mask |= (1ULL << pin_red);
-    for (int i = 0; i < CLOCK_CHANNEL_COUNT; ++i) {
-        if (clock_channels[i].pin >= 0) pin_mask |= (1ULL << clock_channels[i].pin);
-    }
+    /* status LEDs and pixel, before the clock channels so the pixel keeps its RMT channel */
+    status_led_init();
 
-    if (pin_mask) {
-        gpio_config_t cfg = {
-            .pin_bit_mask = pin_mask,
-            .mode = GPIO_MODE_OUTPUT,
-            .pull_down_en = GPIO_PULLDOWN_DISABLE,
-            .pull_up_en = GPIO_PULLUP_DISABLE,
-            .intr_type = GPIO_INTR_DISABLE
-        };
-        gpio_config(&cfg);
-        // default all outputs low (off)
-        if (pin_green >= 0) safe_gpio_set(pin_green, 0);
-        if (pin_red   >= 0) safe_gpio_set(pin_red,   0);
-        for (int i = 0; i < CLOCK_CHANNEL_COUNT; ++i) {
-            if (clock_channels[i].pin >= 0) safe_gpio_set(clock_channels[i].pin, 0);
-        }
-    }
+    /* analog meters next to the discrete outputs */
+    meter_output_init();
 
-    /* neopixel init */
-    int np_pin = (CONFIG_NEOPIXEL_GPIO >= 0) ? CONFIG_NEOPIXEL_GPIO : -1;
-    if (np_pin >= 0) {
-        led_strip_config_t strip_cfg = {
-            .strip_gpio_num = np_pin,
-            .max_leds = 1,
-        };
-        led_strip_rmt_config_t rmt_cfg = {
-            .resolution_hz = 10 * 1000 * 1000,
-            .flags.with_dma = false,
-        };
-        if (led_strip_new_rmt_device(&strip_cfg, &rmt_cfg, &strip) == ESP_OK) {
-            led_strip_clear(strip);
-            ESP_LOGI(TAG, "NeoPixel initialized on GPIO %d", np_pin);
-        } else {
-            strip = NULL;
-            ESP_LOGW(TAG, "NeoPixel initialization failed on GPIO %d", np_pin);
-        }
-    } else {
-        strip = NULL;
+    /* clock channels */
+    for (int i = 0; i < CLOCK_CHANNEL_COUNT; ++i) {
+        prepare_clock_channel(i);
     }
 
-    /* mutex for neopixel color */
-    np_mutex = xSemaphoreCreateMutex();
-
     /* subscribe to events */
-    events_subscribe(EVENT_MODEL_MINUTE_TICK, minute_tick_handler, NULL);
+    step_mutex = xSemaphoreCreateRecursiveMutex();
+    const esp_timer_create_args_t catchup_args = {
+        .callback = catchup_poll,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "clock_catchup",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&catchup_args, &catchup_timer));
+
+    events_subscribe(EVENT_MODEL_TICK, model_tick_handler, NULL);
+    events_subscribe(EVENT_MODEL_TIME_SET, resync_handler, NULL);
+    events_subscribe(EVENT_HANDS_SET, resync_handler, NULL);
     events_subscribe(EVENT_TIMER_STATE_CHANGE, timer_state_handler, NULL);
 
     /* ensure LEDs/neopixel reflect current timer state immediately */
@@ -243,25 +452,3 @@ void output_driver_init(void)
     ESP_LOGI(TAG, "output_driver initialized (CH0=%d CH1=%d CH2=%d)",
              clock_channels[0].pin, clock_channels[1].pin, clock_channels[2].pin);
 }
-
-/* Helper to set a GPIO safely (no-op when pin < 0). */
-static inline void safe_gpio_set(int pin, int level)
-{
-  if (pin < 0)
-    return;
-  gpio_set_level((gpio_num_t)pin, level ? 1 : 0);
-}
-
-/* Helper to set neopixel color and remember the color.
-   Caller should hold np_mutex when called if needed for atomicity.
-*/
-static void _set_neopixel_rgb_locked(uint8_t r, uint8_t g, uint8_t b)
-{
-  if (!strip)
-    return;
-  led_strip_set_pixel(strip, 0, r, g, b);
-  led_strip_refresh(strip);
-  np_r = r;
-  np_g = g;
-  np_b = b;
-}
\ No newline at end of file
@@ -11,6 +11,42 @@ typedef enum {
     OUTPUT_ROLE__COUNT
 } output_role_t;
 
+#include <stdint.h>
+#include <stdbool.h>
+#include "shift_out.h"
+
+// GPIO channels first, then the slave clocks on the shift register chain
+#define OUTPUT_CLOCK_CHANNELS (3 + SHIFT_OUT_CLOCK_CHANNELS)
+#if CONFIG_SHIFT_OUT_CLOCK_PAIRS
+#define OUTPUT_SHIFT_CLOCK_BITS (SHIFT_OUT_CLOCK_CHANNELS * 2)
+#else
+#define OUTPUT_SHIFT_CLOCK_BITS SHIFT_OUT_CLOCK_CHANNELS
+#endif
+// the chain bits above the clocks drive lamps
+#define OUTPUT_LAMP_CHANNELS (SHIFT_OUT_BITS - OUTPUT_SHIFT_CLOCK_BITS)
+_Static_assert(OUTPUT_SHIFT_CLOCK_BITS <= SHIFT_OUT_BITS, "SHIFT_OUT_CLOCK_CHANNELS do not fit the register chain");
+#define OUTPUT_HANDS_UNKNOWN 0xFFFF
+
+typedef struct {
+    uint32_t position;         // step the hands show
+    uint32_t total;            // steps of the last catch-up
+    uint32_t done;
+    uint32_t hold;             // due steps still skipped
+    uint32_t steps_per_s_x100; // catch-up rate so far
+} output_catchup_t;
+
 void output_driver_init(void);
 
+// Hand positions in steps (minute channels: minutes on a 12 h dial), persisted by storage.
+// Setting them does not move anything, EVENT_MODEL_TIME_SET plans the catch-up.
+// OUTPUT_HANDS_UNKNOWN takes the hands as showing the current model time.
+void output_clock_set_positions(const uint16_t *positions);
+void output_clock_get_positions(uint16_t *positions);
+
+bool output_clock_get_catchup(uint8_t channel, output_catchup_t *out);
+
+void output_clock_register_commands(void);
+
+void output_lamp_set(uint16_t lamp, bool on);
+
 #endif
\ No newline at end of file
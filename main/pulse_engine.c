@@ -0,0 +1,294 @@
+#include <string.h>
+#include "pulse_engine.h"
+#include "driver/rmt_tx.h"
+#include "driver/gpio.h"
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char *TAG = "pulse_engine";
+
+typedef struct {
+  uint32_t symbols[PULSE_SYMBOLS_MAX]; // rmt_symbol_word_t layout
+  uint16_t symbol_count;
+} pulse_slot_t;
+
+typedef struct {
+  int target; // GPIO or PULSE_TARGET_SHIFT(bit), -1 = unused
+  rmt_channel_handle_t rmt;
+  rmt_encoder_handle_t encoder;
+  pulse_slot_t *slots;      // symbols of RMT outputs
+  esp_timer_handle_t timer; // fallback
+  const pulse_seq_t *seq[PULSE_ENGINE_SLOTS];
+  volatile uint8_t pending; // runs submitted and not finished
+
+  // fallback state, the RMT driver queues by itself
+  struct {
+    uint8_t slot;
+    uint16_t repeats;
+  } queue[PULSE_ENGINE_QUEUE_DEPTH];
+  uint8_t queue_head;
+  uint8_t queue_len;
+  bool running;
+  uint8_t run_slot;
+  uint8_t run_step;
+  uint16_t run_repeats; // left after the current one
+  int64_t edge_us; // planned time of the current edge, later edges do not drift
+
+  pulse_engine_stats_t stats;
+} pulse_output_t;
+
+_Static_assert(sizeof(rmt_symbol_word_t) == sizeof(uint32_t), "symbol words are handed to the copy encoder as is");
+
+static pulse_output_t outputs[PULSE_ENGINE_OUTPUTS] = {
+    [0 ... PULSE_ENGINE_OUTPUTS - 1] = {.target = -1},
+};
+static pulse_slot_t rmt_slots[PULSE_ENGINE_RMT_MAX][PULSE_ENGINE_SLOTS];
+static uint8_t rmt_used = 0;
+static portMUX_TYPE engine_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void pulse_write(const pulse_output_t *o, uint8_t level)
+{
+  if (PULSE_TARGET_IS_SHIFT(o->target))
+    shift_out_set(o->target & 0xFFF, level);
+  else
+    gpio_set_level(o->target, level);
+}
+
+static bool IRAM_ATTR pulse_rmt_done(rmt_channel_handle_t channel, const rmt_tx_done_event_data_t *edata, void *user_ctx)
+{
+  pulse_output_t *o = (pulse_output_t *)user_ctx;
+  portENTER_CRITICAL_ISR(&engine_lock);
+  if (o->pending > 0)
+    o->pending--;
+  portEXIT_CRITICAL_ISR(&engine_lock);
+  return false;
+}
+
+// -----------------
+// esp_timer fallback
+// -----------------
+
+static void pulse_fallback_start(pulse_output_t *o, uint8_t slot, uint16_t repeats)
+{
+  const pulse_seq_t *seq = o->seq[slot];
+  o->run_slot = slot;
+  o->run_step = 0;
+  o->run_repeats = repeats - 1;
+  o->edge_us = esp_timer_get_time();
+  pulse_write(o, seq->steps[0].level);
+  esp_timer_start_once(o->timer, seq->steps[0].duration_us);
+}
+
+static void pulse_fallback_step(void *arg)
+{
+  pulse_output_t *o = (pulse_output_t *)arg;
+  const pulse_seq_t *seq = o->seq[o->run_slot];
+
+  o->edge_us += seq->steps[o->run_step].duration_us;
+  o->run_step++;
+  if (o->run_step == seq->count && o->run_repeats > 0)
+  {
+    o->run_repeats--;
+    o->run_step = 0; // the sequence again
+  }
+  if (o->run_step < seq->count)
+  {
+    pulse_write(o, seq->steps[o->run_step].level);
+    int64_t wait = o->edge_us + seq->steps[o->run_step].duration_us - esp_timer_get_time();
+    esp_timer_start_once(o->timer, wait > 0 ? wait : 0);
+    return;
+  }
+
+  pulse_write(o, 0);
+  bool next = false;
+  uint8_t slot = 0;
+  uint16_t repeats = 1;
+  portENTER_CRITICAL(&engine_lock);
+  o->pending--;
+  if (o->queue_len > 0)
+  {
+    slot = o->queue[o->queue_head].slot;
+    repeats = o->queue[o->queue_head].repeats;
+    o->queue_head = (o->queue_head + 1) % PULSE_ENGINE_QUEUE_DEPTH;
+    o->queue_len--;
+    next = true;
+  }
+  else
+  {
+    o->running = false;
+  }
+  portEXIT_CRITICAL(&engine_lock);
+
+  if (next)
+    pulse_fallback_start(o, slot, repeats);
+}
+
+// -----------------
+// API
+// -----------------
+
+esp_err_t pulse_engine_add_output(uint8_t out, int target)
+{
+  if (out >= PULSE_ENGINE_OUTPUTS || target < 0)
+    return ESP_ERR_INVALID_ARG;
+  pulse_output_t *o = &outputs[out];
+  o->target = target;
+  o->rmt = NULL;
+
+  const esp_timer_create_args_t timer_args = {
+      .callback = pulse_fallback_step,
+      .arg = o,
+      .dispatch_method = ESP_TIMER_TASK,
+      .name = "pulse_engine",
+  };
+  if (PULSE_TARGET_IS_SHIFT(target))
+  {
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &o->timer));
+    ESP_LOGD(TAG, "Output %u on shift register bit %d", out, target & 0xFFF);
+    return ESP_OK;
+  }
+
+  int gpio = target;
+  rmt_tx_channel_config_t tx_config = {
+      .gpio_num = gpio,
+      .clk_src = RMT_CLK_SRC_DEFAULT,
+      .resolution_hz = PULSE_TICK_HZ,
+      .mem_block_symbols = PULSE_ENGINE_MEM_SYMBOLS,
+      .trans_queue_depth = PULSE_ENGINE_QUEUE_DEPTH + 1,
+  };
+  rmt_copy_encoder_config_t encoder_config = {};
+  if (rmt_used < PULSE_ENGINE_RMT_MAX && rmt_new_tx_channel(&tx_config, &o->rmt) == ESP_OK)
+  {
+    o->slots = rmt_slots[rmt_used++];
+    ESP_ERROR_CHECK(rmt_new_copy_encoder(&encoder_config, &o->encoder));
+    rmt_tx_event_callbacks_t cbs = {
+        .on_trans_done = pulse_rmt_done,
+    };
+    ESP_ERROR_CHECK(rmt_tx_register_event_callbacks(o->rmt, &cbs, o));
+    ESP_ERROR_CHECK(rmt_enable(o->rmt));
+    o->stats.hardware = true;
+    ESP_LOGI(TAG, "Output %u on GPIO %d (RMT)", out, gpio);
+    return ESP_OK;
+  }
+
+  // all RMT channels taken (the status LED strip uses one)
+  o->rmt = NULL;
+  gpio_config_t cfg = {
+      .pin_bit_mask = 1ULL << gpio,
+      .mode = GPIO_MODE_OUTPUT,
+      .pull_up_en = GPIO_PULLUP_DISABLE,
+      .pull_down_en = GPIO_PULLDOWN_DISABLE,
+      .intr_type = GPIO_INTR_DISABLE,
+  };
+  ESP_ERROR_CHECK(gpio_config(&cfg));
+  gpio_set_level(gpio, 0);
+  ESP_ERROR_CHECK(esp_timer_create(&timer_args, &o->timer));
+  o->stats.hardware = false;
+  ESP_LOGW(TAG, "Output %u on GPIO %d (no RMT channel left, esp_timer fallback)", out, gpio);
+  return ESP_OK;
+}
+
+esp_err_t pulse_engine_set_slot(uint8_t out, uint8_t slot, const pulse_seq_t *seq)
+{
+  if (out >= PULSE_ENGINE_OUTPUTS || slot >= PULSE_ENGINE_SLOTS || outputs[out].target < 0)
+    return ESP_ERR_INVALID_ARG;
+  if (seq->count == 0)
+    return ESP_ERR_INVALID_SIZE;
+  pulse_output_t *o = &outputs[out];
+  if (o->pending > 0)
+    return ESP_ERR_INVALID_STATE; // the hardware may still read the symbols
+
+  o->seq[slot] = NULL;
+  if (o->rmt)
+  {
+    pulse_slot_t *s = &o->slots[slot];
+    s->symbol_count = pulse_seq_to_symbols(seq, s->symbols, PULSE_SYMBOLS_MAX);
+    if (s->symbol_count == 0)
+    {
+      ESP_LOGW(TAG, "Sequence for output %u slot %u too long", out, slot);
+      return ESP_ERR_INVALID_SIZE;
+    }
+  }
+  o->seq[slot] = seq;
+  return ESP_OK;
+}
+
+esp_err_t pulse_engine_trigger(uint8_t out, uint8_t slot, uint16_t repeats)
+{
+  if (out >= PULSE_ENGINE_OUTPUTS || slot >= PULSE_ENGINE_SLOTS || outputs[out].target < 0 || repeats == 0)
+    return ESP_ERR_INVALID_ARG;
+  pulse_output_t *o = &outputs[out];
+  if (!o->seq[slot])
+    return ESP_ERR_INVALID_STATE;
+  const pulse_slot_t *s = o->rmt ? &o->slots[slot] : NULL;
+  if (s && repeats > 1 && s->symbol_count > PULSE_ENGINE_MEM_SYMBOLS)
+    return ESP_ERR_NOT_SUPPORTED; // hardware loops only run from the channel memory
+
+  // the active run plus the queue; rmt_transmit would block on a full driver queue
+  bool start = false;
+  portENTER_CRITICAL(&engine_lock);
+  if (o->pending > PULSE_ENGINE_QUEUE_DEPTH)
+  {
+    o->stats.dropped++;
+    portEXIT_CRITICAL(&engine_lock);
+    return ESP_ERR_NO_MEM;
+  }
+  o->pending++;
+  if (o->pending - 1 > o->stats.queued_max)
+    o->stats.queued_max = o->pending - 1;
+  o->stats.runs++;
+  if (!o->rmt)
+  {
+    if (o->running)
+    {
+      uint8_t tail = (o->queue_head + o->queue_len) % PULSE_ENGINE_QUEUE_DEPTH;
+      o->queue[tail].slot = slot;
+      o->queue[tail].repeats = repeats;
+      o->queue_len++;
+    }
+    else
+    {
+      o->running = true;
+      start = true;
+    }
+  }
+  portEXIT_CRITICAL(&engine_lock);
+
+  if (!o->rmt)
+  {
+    if (start)
+      pulse_fallback_start(o, slot, repeats);
+    return ESP_OK;
+  }
+
+  // the symbols stay in the slot, the copy encoder streams them as they are
+  rmt_transmit_config_t tx_config = {
+      .loop_count = repeats > 1 ? repeats : 0,
+      .flags.eot_level = 0,
+  };
+  esp_err_t err = rmt_transmit(o->rmt, o->encoder, s->symbols, s->symbol_count * sizeof(s->symbols[0]), &tx_config);
+  if (err != ESP_OK)
+  {
+    portENTER_CRITICAL(&engine_lock);
+    o->pending--;
+    o->stats.dropped++;
+    portEXIT_CRITICAL(&engine_lock);
+  }
+  return err;
+}
+
+uint8_t pulse_engine_pending(uint8_t out)
+{
+  return out < PULSE_ENGINE_OUTPUTS ? outputs[out].pending : 0;
+}
+
+bool pulse_engine_get_stats(uint8_t out, pulse_engine_stats_t *out_stats)
+{
+  if (out >= PULSE_ENGINE_OUTPUTS || outputs[out].target < 0)
+    return false;
+  portENTER_CRITICAL(&engine_lock);
+  *out_stats = outputs[out].stats;
+  portEXIT_CRITICAL(&engine_lock);
+  return true;
+}
@@ -0,0 +1,48 @@
+#ifndef PULSE_ENGINE_H
+#define PULSE_ENGINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "pulse_pattern.h"
+#include "shift_out.h"
+
+#define PULSE_ENGINE_OUTPUTS (2 * (3 + SHIFT_OUT_CLOCK_CHANNELS)) // clock channels x A/B
+#define PULSE_ENGINE_RMT_MAX 4       // RMT TX channels of the S3
+#define PULSE_ENGINE_SLOTS 2         // prepared sequences per output
+#define PULSE_ENGINE_QUEUE_DEPTH 4   // runs waiting behind the active one
+#define PULSE_ENGINE_MEM_SYMBOLS 48  // RMT channel memory, looped sequences must fit
+
+typedef struct {
+  uint32_t runs;       // sequences started
+  uint32_t queued_max; // most runs waiting at once
+  uint32_t dropped;    // triggers refused with a full queue
+  bool hardware;       // RMT, otherwise the esp_timer fallback
+} pulse_engine_stats_t;
+
+// Output targets: a GPIO number, or a bit of the shift register chain
+#define PULSE_TARGET_SHIFT(bit) (0x1000 | (bit))
+#define PULSE_TARGET_IS_SHIFT(t) ((t) & 0x1000)
+
+/*
+ * GPIO waveforms are rendered by an RMT TX channel with a copy encoder from symbols
+ * prepared when a slot is set, so triggering costs no allocation and no task. When no
+ * RMT channel is left, and for shift register bits, a one-shot esp_timer walks the
+ * steps instead; shift register bits then change with the next chain frame.
+ */
+esp_err_t pulse_engine_add_output(uint8_t out, int target);
+
+// Prepare a sequence; it is referenced, not copied, and has to stay valid.
+// A slot cannot change while runs of the output are pending.
+esp_err_t pulse_engine_set_slot(uint8_t out, uint8_t slot, const pulse_seq_t *seq);
+
+// Queue a slot played repeats times back to back, never blocks. ESP_ERR_NO_MEM when
+// the queue is full. Repeats loop in hardware, the sequence has to fit the channel memory.
+esp_err_t pulse_engine_trigger(uint8_t out, uint8_t slot, uint16_t repeats);
+
+// Runs queued or active on an output
+uint8_t pulse_engine_pending(uint8_t out);
+
+bool pulse_engine_get_stats(uint8_t out, pulse_engine_stats_t *out_stats);
+
+#endif
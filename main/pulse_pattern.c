@@ -0,0 +1,152 @@
+#include <string.h>
+#include "pulse_pattern.h"
+
+bool pulse_seq_add(pulse_seq_t *seq, uint8_t level, uint32_t duration_us)
+{
+  if (duration_us == 0)
+    return true;
+  if (seq->count > 0 && seq->steps[seq->count - 1].level == level)
+  {
+    seq->steps[seq->count - 1].duration_us += duration_us;
+    return true;
+  }
+  if (seq->count >= PULSE_STEPS_MAX)
+    return false;
+  seq->steps[seq->count++] = (pulse_step_t){.duration_us = duration_us, .level = level};
+  return true;
+}
+
+size_t pulse_seq_to_symbols(const pulse_seq_t *seq, uint32_t *words, size_t max_words)
+{
+  uint16_t halves[PULSE_SYMBOLS_MAX * 2];
+  uint8_t levels[PULSE_SYMBOLS_MAX * 2];
+  size_t max_halves = max_words * 2 < PULSE_SYMBOLS_MAX * 2 ? max_words * 2 : PULSE_SYMBOLS_MAX * 2;
+  size_t n = 0;
+
+  for (uint8_t i = 0; i < seq->count; i++)
+  {
+    uint64_t ticks = (uint64_t)seq->steps[i].duration_us * PULSE_TICK_HZ / 1000000;
+    while (ticks > 0)
+    {
+      if (n >= max_halves)
+        return 0;
+      uint16_t part = ticks > PULSE_HALF_MAX ? PULSE_HALF_MAX : (uint16_t)ticks;
+      halves[n] = part;
+      levels[n] = seq->steps[i].level;
+      n++;
+      ticks -= part;
+    }
+  }
+
+  if (n % 2)
+  {
+    size_t longest = 0;
+    for (size_t i = 1; i < n; i++)
+      if (halves[i] > halves[longest])
+        longest = i;
+    if (n >= max_halves || halves[longest] < 2)
+      return 0;
+    memmove(&halves[longest + 1], &halves[longest], (n - longest) * sizeof(halves[0]));
+    memmove(&levels[longest + 1], &levels[longest], (n - longest) * sizeof(levels[0]));
+    halves[longest] /= 2;
+    halves[longest + 1] -= halves[longest];
+    n++;
+  }
+
+  for (size_t i = 0; i < n; i += 2)
+    words[i / 2] = (uint32_t)halves[i] | (uint32_t)(levels[i] & 1) << 15 |
+                   (uint32_t)halves[i + 1] << 16 | (uint32_t)(levels[i + 1] & 1) << 31;
+  return n / 2;
+}
+
+bool pulse_pattern_compile(const pulse_pattern_t *p, pulse_seq_t *out)
+{
+  memset(out, 0, sizeof(*out));
+  uint8_t count = p->type == PULSE_PATTERN_MINUTE ? p->count : 1;
+  bool ok = true;
+  for (uint8_t i = 0; i < count; i++)
+  {
+    ok &= pulse_seq_add(out, 1, p->pulse_ms * 1000);
+    // the gap after the last impulse too: the next sequence, queued or a looped strike,
+    // may start right when this one ends
+    ok &= pulse_seq_add(out, 0, p->gap_ms * 1000);
+  }
+  return ok && out->count > 0;
+}
+
+pulse_due_t pulse_pattern_due(const pulse_pattern_t *p, uint32_t ts)
+{
+  pulse_due_t due = {.fire = false, .output = 0, .repeats = 1};
+  uint32_t impulse; // number of the impulse since the epoch, its parity picks the output
+
+  switch (p->type)
+  {
+  case PULSE_PATTERN_SECOND:
+    due.fire = true;
+    impulse = ts;
+    break;
+  case PULSE_PATTERN_HOUR_STRIKE:
+    due.fire = ts % 3600 == 0;
+    impulse = ts / 3600;
+    due.repeats = (ts / 3600) % 12;
+    if (due.repeats == 0)
+      due.repeats = 12;
+    break;
+  case PULSE_PATTERN_MINUTE:
+  default:
+    due.fire = ts % 60 == 0;
+    impulse = ts / 60;
+    break;
+  }
+
+  if (p->alternating)
+    due.output = impulse & 1;
+  return due;
+}
+
+uint32_t pulse_pattern_dial_steps(const pulse_pattern_t *p)
+{
+  switch (p->type)
+  {
+  case PULSE_PATTERN_MINUTE:
+    return PULSE_DIAL_MINUTE_STEPS;
+  case PULSE_PATTERN_SECOND:
+    return PULSE_DIAL_SECOND_STEPS;
+  default:
+    return 0;
+  }
+}
+
+uint32_t pulse_pattern_dial_position(const pulse_pattern_t *p, uint32_t ts)
+{
+  switch (p->type)
+  {
+  case PULSE_PATTERN_MINUTE:
+    return ts / 60 % PULSE_DIAL_MINUTE_STEPS;
+  case PULSE_PATTERN_SECOND:
+    return ts % PULSE_DIAL_SECOND_STEPS;
+  default:
+    return 0;
+  }
+}
+
+uint32_t pulse_pattern_step_ms(const pulse_pattern_t *p)
+{
+  uint8_t count = p->type == PULSE_PATTERN_MINUTE ? p->count : 1;
+  return count * (p->pulse_ms + p->gap_ms);
+}
+
+pulse_catchup_t pulse_catchup_plan(uint32_t dial, uint32_t pos, uint32_t target, uint32_t drive_ms, uint32_t hold_ms)
+{
+  pulse_catchup_t plan = {0, 0};
+  if (dial == 0)
+    return plan;
+
+  uint32_t behind = (target + dial - pos % dial) % dial;
+  uint32_t ahead = behind ? dial - behind : 0;
+  if ((uint64_t)ahead * hold_ms < (uint64_t)behind * drive_ms)
+    plan.hold = ahead;
+  else
+    plan.drive = behind;
+  return plan;
+}
@@ -0,0 +1,88 @@
+#ifndef PULSE_PATTERN_H
+#define PULSE_PATTERN_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Slave clock pulse patterns and their compilation into RMT symbol words.
+ * Plain C without IDF dependencies, driven by output_driver.c / pulse_engine.c.
+ */
+
+#define PULSE_STEPS_MAX 32     // levels per sequence
+#define PULSE_SYMBOLS_MAX 96   // RMT symbols per sequence, long levels take several
+#define PULSE_TICK_HZ 1000000  // symbol resolution, 1 us
+#define PULSE_HALF_MAX 32767   // 15-bit duration of one symbol half
+
+/* One level of a sequence; the output returns low after the last step */
+typedef struct {
+  uint32_t duration_us;
+  uint8_t level;
+} pulse_step_t;
+
+typedef struct {
+  pulse_step_t steps[PULSE_STEPS_MAX];
+  uint8_t count;
+} pulse_seq_t;
+
+typedef enum {
+  PULSE_PATTERN_MINUTE = 0, // count impulses per model minute
+  PULSE_PATTERN_SECOND,     // one impulse per model second
+  PULSE_PATTERN_HOUR_STRIKE // strike = hour (1..12) at the full hour
+} pulse_pattern_type_t;
+
+typedef struct {
+  pulse_pattern_type_t type;
+  bool alternating;  // H-bridge pair: successive impulses go to output A and B in turn
+  uint32_t pulse_ms; // impulse length
+  uint32_t gap_ms;   // pause between impulses of one sequence / strikes
+  uint8_t count;     // impulses per minute (PULSE_PATTERN_MINUTE)
+} pulse_pattern_t;
+
+/* What a model tick asks for */
+typedef struct {
+  bool fire;
+  uint8_t output;   // 0 = A, 1 = B of a pair
+  uint16_t repeats; // runs of the compiled sequence back to back
+} pulse_due_t;
+
+// Append a level, equal levels are merged; false if the sequence is full
+bool pulse_seq_add(pulse_seq_t *seq, uint8_t level, uint32_t duration_us);
+
+// Symbol words in the rmt_symbol_word_t layout (duration0:15, level0:1, duration1:15, level1:1).
+// Long levels are split into several halves; an odd number of halves splits the longest
+// once more, a zero duration would end the transmission early. 0 if it does not fit.
+size_t pulse_seq_to_symbols(const pulse_seq_t *seq, uint32_t *words, size_t max_words);
+
+// The sequence one trigger plays, every impulse followed by its gap (pulse_pattern_step_ms()
+// long); strikes are a single pulse + gap repeated hour times
+bool pulse_pattern_compile(const pulse_pattern_t *p, pulse_seq_t *out);
+
+// Whether the model second ts fires the pattern, on which output and how often.
+// The output of an alternating pair follows from the model time, so it needs no state.
+pulse_due_t pulse_pattern_due(const pulse_pattern_t *p, uint32_t ts);
+
+/* Hand position tracking: one step per triggered sequence */
+#define PULSE_DIAL_MINUTE_STEPS 720 // 12 hours of minute impulses
+#define PULSE_DIAL_SECOND_STEPS 60
+
+typedef struct {
+  uint32_t drive; // steps to pulse at the catch-up rate
+  uint32_t hold;  // due steps to skip, the hands wait for the model time
+} pulse_catchup_t;
+
+// Steps around the dial, 0 for patterns without hands (strikes)
+uint32_t pulse_pattern_dial_steps(const pulse_pattern_t *p);
+
+// Step the hands should show at model time ts
+uint32_t pulse_pattern_dial_position(const pulse_pattern_t *p, uint32_t ts);
+
+// Shortest time from one sequence start to the next, the mechanism's safe rate
+uint32_t pulse_pattern_step_ms(const pulse_pattern_t *p);
+
+// Quicker of driving forward at drive_ms per step and stopping while the model time
+// (hold_ms per step) catches up with hands that are ahead
+pulse_catchup_t pulse_catchup_plan(uint32_t dial, uint32_t pos, uint32_t target, uint32_t drive_ms, uint32_t hold_ms);
+
+#endif
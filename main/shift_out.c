@@ -0,0 +1,198 @@
+#include <stdio.h>
+#include <string.h>
+#include "shift_out.h"
+#include "driver/spi_master.h"
+#include "freertos/FreeRTOS.h"
+#include "esp_console.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char *TAG = "shift_out";
+
+#if CONFIG_SHIFT_OUT_ENABLE
+
+#define SHIFT_OUT_WORDS ((SHIFT_OUT_BITS + 31) / 32)
+
+static uint32_t bitmap[SHIFT_OUT_WORDS];
+static volatile bool dirty = false;
+static volatile int64_t dirty_since_us = 0; // first change not yet sent
+
+static spi_device_handle_t spi_dev = NULL;
+static esp_timer_handle_t frame_timer = NULL;
+static WORD_ALIGNED_ATTR DMA_ATTR uint8_t tx_buf[CONFIG_SHIFT_OUT_REGISTERS];
+static spi_transaction_t trans;
+static bool in_flight = false;
+static int64_t queued_us = 0;
+static volatile int64_t done_us = 0;
+static int64_t changed_us = 0; // dirty_since_us of the frame in flight
+
+static shift_out_stats_t stats;
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void shift_out_set(uint16_t bit, bool level)
+{
+  if (bit >= SHIFT_OUT_BITS)
+    return;
+  uint32_t mask = 1u << (bit % 32);
+  uint32_t old = level ? __atomic_fetch_or(&bitmap[bit / 32], mask, __ATOMIC_RELAXED)
+                       : __atomic_fetch_and(&bitmap[bit / 32], ~mask, __ATOMIC_RELAXED);
+  if (((old & mask) != 0) == level)
+    return;
+
+  int64_t expected = 0;
+  __atomic_compare_exchange_n(&dirty_since_us, &expected, esp_timer_get_time(), false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+  dirty = true;
+}
+
+bool shift_out_get(uint16_t bit)
+{
+  return bit < SHIFT_OUT_BITS && (bitmap[bit / 32] & (1u << (bit % 32)));
+}
+
+// CS goes high here, the outputs change
+static void IRAM_ATTR shift_out_latched(spi_transaction_t *t)
+{
+  done_us = esp_timer_get_time();
+}
+
+static void shift_out_finish(void)
+{
+  spi_transaction_t *done;
+  if (spi_device_get_trans_result(spi_dev, &done, 0) != ESP_OK)
+    return; // still shifting
+  in_flight = false;
+
+  uint32_t frame_us = (uint32_t)(done_us - queued_us);
+  uint32_t latency_us = (uint32_t)(done_us - changed_us);
+  portENTER_CRITICAL(&stats_lock);
+  stats.frames++;
+  stats.frame_us_last = frame_us;
+  if (frame_us > stats.frame_us_max)
+    stats.frame_us_max = frame_us;
+  stats.latency_us_last = latency_us;
+  if (latency_us > stats.latency_us_max)
+    stats.latency_us_max = latency_us;
+  stats.latency_us_total += latency_us;
+  stats.latency_count++;
+  portEXIT_CRITICAL(&stats_lock);
+}
+
+// Frame timer: one transaction for the whole chain if anything changed
+static void shift_out_frame(void *arg)
+{
+  if (in_flight)
+    shift_out_finish();
+  if (in_flight || !dirty)
+    return;
+
+  dirty = false;
+  changed_us = __atomic_exchange_n(&dirty_since_us, 0, __ATOMIC_RELAXED);
+  // the first byte shifted in ends up in the last register, MSB first puts bit 7 on QH
+  for (int reg = 0; reg < CONFIG_SHIFT_OUT_REGISTERS; reg++)
+    tx_buf[CONFIG_SHIFT_OUT_REGISTERS - 1 - reg] = bitmap[reg / 4] >> ((reg % 4) * 8);
+
+  queued_us = esp_timer_get_time();
+  if (spi_device_queue_trans(spi_dev, &trans, 0) == ESP_OK)
+    in_flight = true;
+  else
+  {
+    // try again next frame, keeping the time of the first change
+    int64_t expected = 0;
+    __atomic_compare_exchange_n(&dirty_since_us, &expected, changed_us, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+    dirty = true;
+  }
+}
+
+void shift_out_init(void)
+{
+  spi_bus_config_t bus_config = {
+      .mosi_io_num = CONFIG_SHIFT_OUT_DATA_GPIO,
+      .miso_io_num = -1,
+      .sclk_io_num = CONFIG_SHIFT_OUT_CLOCK_GPIO,
+      .quadwp_io_num = -1,
+      .quadhd_io_num = -1,
+      .max_transfer_sz = CONFIG_SHIFT_OUT_REGISTERS,
+  };
+  ESP_ERROR_CHECK(spi_bus_initialize(SPI2_HOST, &bus_config, SPI_DMA_CH_AUTO));
+
+  spi_device_interface_config_t dev_config = {
+      .mode = 0,
+      .clock_speed_hz = CONFIG_SHIFT_OUT_SPI_HZ,
+      .spics_io_num = CONFIG_SHIFT_OUT_LATCH_GPIO, // RCLK latches on the rising edge at the end
+      .queue_size = 1,
+      .post_cb = shift_out_latched,
+  };
+  ESP_ERROR_CHECK(spi_bus_add_device(SPI2_HOST, &dev_config, &spi_dev));
+
+  trans = (spi_transaction_t){
+      .length = CONFIG_SHIFT_OUT_REGISTERS * 8,
+      .tx_buffer = tx_buf,
+  };
+  dirty_since_us = esp_timer_get_time();
+  dirty = true; // clear the chain after power-up
+
+  const esp_timer_create_args_t frame_timer_args = {
+      .callback = shift_out_frame,
+      .dispatch_method = ESP_TIMER_TASK,
+      .name = "shift_out",
+  };
+  ESP_ERROR_CHECK(esp_timer_create(&frame_timer_args, &frame_timer));
+  ESP_ERROR_CHECK(esp_timer_start_periodic(frame_timer, CONFIG_SHIFT_OUT_FRAME_US));
+
+  ESP_LOGI(TAG, "%d outputs on %d registers, %d Hz SPI, frame every %d us", SHIFT_OUT_BITS,
+           CONFIG_SHIFT_OUT_REGISTERS, CONFIG_SHIFT_OUT_SPI_HZ, CONFIG_SHIFT_OUT_FRAME_US);
+}
+
+void shift_out_get_stats(shift_out_stats_t *out)
+{
+  portENTER_CRITICAL(&stats_lock);
+  *out = stats;
+  portEXIT_CRITICAL(&stats_lock);
+}
+
+static int cmd_shiftout(int argc, char **argv)
+{
+  shift_out_stats_t s;
+  shift_out_get_stats(&s);
+  printf("%d outputs, frames %lu, frame us last %lu max %lu\n", SHIFT_OUT_BITS, s.frames, s.frame_us_last, s.frame_us_max);
+  if (s.latency_count)
+    printf("change to latch us: last %lu, avg %lu, max %lu\n", s.latency_us_last,
+           (uint32_t)(s.latency_us_total / s.latency_count), s.latency_us_max);
+  for (int reg = 0; reg < CONFIG_SHIFT_OUT_REGISTERS; reg++)
+    printf("%02x%s", (uint8_t)(bitmap[reg / 4] >> ((reg % 4) * 8)), reg + 1 < CONFIG_SHIFT_OUT_REGISTERS ? " " : "\n");
+  return 0;
+}
+
+void shift_out_register_commands(void)
+{
+  const esp_console_cmd_t shiftout_cmd = {
+      .command = "shiftout",
+      .help = "Shift register outputs, frame time and change to latch latency",
+      .func = cmd_shiftout,
+  };
+  ESP_ERROR_CHECK(esp_console_cmd_register(&shiftout_cmd));
+}
+#else
+void shift_out_init(void)
+{
+  ESP_LOGD(TAG, "Shift register outputs disabled");
+}
+
+void shift_out_set(uint16_t bit, bool level)
+{
+}
+
+bool shift_out_get(uint16_t bit)
+{
+  return false;
+}
+
+void shift_out_get_stats(shift_out_stats_t *out)
+{
+  memset(out, 0, sizeof(*out));
+}
+
+void shift_out_register_commands(void)
+{
+}
+#endif
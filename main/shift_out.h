@@ -0,0 +1,40 @@
+#ifndef SHIFT_OUT_H
+#define SHIFT_OUT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#if CONFIG_SHIFT_OUT_ENABLE
+#define SHIFT_OUT_BITS (CONFIG_SHIFT_OUT_REGISTERS * 8)
+#define SHIFT_OUT_CLOCK_CHANNELS CONFIG_SHIFT_OUT_CLOCK_CHANNELS // slave clocks on the chain
+#else
+#define SHIFT_OUT_BITS 0
+#define SHIFT_OUT_CLOCK_CHANNELS 0
+#endif
+
+typedef struct {
+  uint32_t frames;         // transactions sent
+  uint32_t frame_us_last;  // queue to transfer done
+  uint32_t frame_us_max;
+  uint32_t latency_us_last; // first change of a frame until latched
+  uint32_t latency_us_max;
+  uint64_t latency_us_total;
+  uint32_t latency_count;
+} shift_out_stats_t;
+
+/*
+ * 74HC595 chain on SPI with DMA. Channel states live in one bitmap, a frame timer sends
+ * the whole chain in one transaction when something changed; CS is wired to the latch
+ * (RCLK), its rising edge at the end of the transfer updates all outputs at once.
+ */
+void shift_out_init(void);
+
+// Set an output bit (0 = QA of the first register), latched with the next frame
+void shift_out_set(uint16_t bit, bool level);
+bool shift_out_get(uint16_t bit);
+
+void shift_out_get_stats(shift_out_stats_t *out);
+
+void shift_out_register_commands(void);
+
+#endif
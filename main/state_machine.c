@@ -1,17 +1,23 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/time.h>
 #include <time.h>
 #include "esp_log.h"
 #include "state_machine.h"
 #include "event_handler.h"
 #include "button_driver.h"
+#include "encoder_driver.h"
+#include "input_inject.h"
 #include "timer.h"
+#include "lcd_driver.h"
 #include "menu/menu.h"
 #include "menu/menu_table.h"
 
 static const char *TAG = "state_machine";
 
 static int lcd_test_iterator = 0;
+static int lcd_test_page = 0;
 
 /* forward declarations */
 static void state_event_handler(void *handler_arg, esp_event_base_t base, int32_t id, void *event_data);
@@ -24,8 +30,25 @@ int get_lcd_test_iterator(void)
   return lcd_test_iterator;
 }
 
+int get_lcd_test_page(void)
+{
+  return lcd_test_page;
+}
+
 /* Helpers */
 
+// Drop a pending edit and show the clock
+static void return_to_clock(void)
+{
+  active_editor = NULL;
+  state_ctx.edit_mode = EDIT_NONE;
+  state_ctx.edit_timescale = DEFAULT_TIMESCALE;
+  state_ctx.edit_timestamp = 0;
+  state_ctx.edit_cursor = 0;
+
+  enter_state_clock();
+}
+
 /* State machine initialization */
 
 void state_machine_init(void)
@@ -40,17 +63,40 @@ void state_machine_init(void)
   events_subscribe(EVENT_BUTTON_LONG_PRESS, state_event_handler, NULL);
   events_subscribe(EVENT_BUTTON_REPEATED_PRESS, state_event_handler, NULL);
   events_subscribe(EVENT_BUTTON_RELEASE, state_event_handler, NULL);
+  events_subscribe(EVENT_BUTTON_CHORD, state_event_handler, NULL);
+  events_subscribe(EVENT_ENCODER_ROTATE, state_event_handler, NULL);
   events_subscribe(EVENT_EXIT_INIT_STATE, state_event_handler, NULL);
 
   ESP_LOGI(TAG, "State machine initialized");
 }
 
+static void state_event_dispatch(int32_t id, void *event_data);
+
+// Latency marks for injected input around the actual handling
 static void state_event_handler(void *handler_arg, esp_event_base_t base, int32_t id, void *event_data)
 {
   if (base != CUSTOM_EVENTS)
     return;
 
-  ESP_LOGI(TAG, "Base: %s, ID: %d", base, id);
+  bool button = id == EVENT_BUTTON_PRESS || id == EVENT_BUTTON_LONG_PRESS ||
+                id == EVENT_BUTTON_REPEATED_PRESS || id == EVENT_BUTTON_RELEASE || id == EVENT_BUTTON_CHORD;
+  state_ctx_t before;
+  if (button)
+  {
+    input_latency_mark(INPUT_LAT_DISPATCH);
+    memcpy(&before, &state_ctx, sizeof(before));
+  }
+
+  state_event_dispatch(id, event_data);
+
+  if (button && memcmp(&before, &state_ctx, sizeof(before)) != 0)
+    input_latency_mark(INPUT_LAT_STATE);
+}
+
+static void state_event_dispatch(int32_t id, void *event_data)
+{
+
+  ESP_LOGI(TAG, "ID: %d", id);
   if (id == EVENT_EXIT_INIT_STATE)
   {
     ESP_LOGI(TAG, "Exiting init state");
@@ -99,13 +145,7 @@ static void state_event_handler(void *handler_arg, esp_event_base_t base, int32_
       case STATE_MENU:
       case STATE_EDIT:
         // cancel edit and return to clock (your previous behavior reset edit state)
-        active_editor = NULL;
-        state_ctx.edit_mode = EDIT_NONE;
-        state_ctx.edit_timescale = DEFAULT_TIMESCALE;
-        state_ctx.edit_timestamp = 0;
-        state_ctx.edit_cursor = 0;
-
-        enter_state_clock();
+        return_to_clock();
         return;
 
       default:
@@ -196,13 +236,18 @@ static void state_event_handler(void *handler_arg, esp_event_base_t base, int32_
           lcd_test_iterator = 16 - 3;
         break;
       case BUTTON_OK:
+        lcd_test_page = 0;
+        lcd_bench_start();
+        break;
       case BUTTON_LEFT:
       case BUTTON_RIGHT:
-        // disabled in clock state
+        lcd_test_page = !lcd_test_page;
+        break;
       default:
         break;
       }
 
+      events_post(EVENT_LCD_UPDATE, NULL, 0);
       return;
     }
 
@@ -217,6 +262,50 @@ static void state_event_handler(void *handler_arg, esp_event_base_t base, int32_
       active_editor->handle_event(id, btn);
     }
   }
+
+  if (id == EVENT_BUTTON_CHORD)
+  {
+    uint8_t mask = *(uint8_t *)event_data;
+    ESP_LOGI(TAG, "Chord: %02x", mask);
+
+    // CANCEL + OK: back to the clock from any menu, editor or test page, the edit is dropped.
+    // The driver holds their presses back for the chord window, so neither acts on its own first.
+    if (mask == (BUTTON_MASK(BUTTON_CANCEL) | BUTTON_MASK(BUTTON_OK)) &&
+        state_ctx.state != STATE_INIT && state_ctx.state != STATE_RESTART && state_ctx.state != STATE_CLOCK)
+    {
+      if (state_ctx.state == STATE_EDIT && active_editor && active_editor->cancel)
+        active_editor->cancel();
+      return_to_clock();
+    }
+    return;
+  }
+
+  if (id == EVENT_ENCODER_ROTATE)
+  {
+    const encoder_event_t *evt = (const encoder_event_t *)event_data;
+
+    if (state_ctx.state == STATE_MENU)
+    {
+      // clockwise goes down the list, one entry per detent
+      for (int i = 0; i < abs(evt->detents); i++)
+      {
+        if (evt->detents > 0)
+          menu_move_down();
+        else
+          menu_move_up();
+      }
+      events_post(EVENT_LCD_UPDATE, NULL, 0);
+      return;
+    }
+
+    if (state_ctx.state == STATE_EDIT && active_editor && active_editor->handle_event)
+    {
+      // the editor sees a single UP/DOWN with an accelerated step size
+      state_ctx.edit_step = abs(evt->steps);
+      active_editor->handle_event(id, evt->steps > 0 ? BUTTON_UP : BUTTON_DOWN);
+      state_ctx.edit_step = 1;
+    }
+  }
 }
 
 static void timer_pause(void)
@@ -232,10 +321,3 @@ static void timer_resume(void)
 }
 
 
-/*static void enter_state_lcd_test(void)
-{
-  state_ctx.state = STATE_LCD_TEST;
-
-  events_post(EVENT_LCD_UPDATE, NULL, 0);
-}*/
-
@@ -8,5 +8,6 @@ void state_machine_init(void);
 
 /** @deprecated */
 int get_lcd_test_iterator(void);
+int get_lcd_test_page(void); // 0: benchmark results, 1: character table
 
 #endif
\ No newline at end of file
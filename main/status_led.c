@@ -0,0 +1,211 @@
+#include "status_led.h"
+#include "driver/ledc.h"
+#include "led_strip.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+
+static const char *TAG = "status_led";
+
+#define STATUS_FRAME_MS 20
+#define STATUS_LEDC_TIMER LEDC_TIMER_0
+#define STATUS_LEDC_BITS LEDC_TIMER_10_BIT
+#define STATUS_LEDC_MAX 1023
+#define BREATH_MS 3000
+#define BLINK_ON_MS 250
+#define BLINK_OFF_MS 250
+#define BLINK_PAUSE_MS 1250
+#define BLINK_CYCLES 3
+#define FLASH_MS 80
+
+typedef struct {
+  int pin;
+  ledc_channel_t channel;
+  uint8_t level; // last applied, 0..255
+} status_pwm_t;
+
+static status_pwm_t green = {.pin = -1, .channel = LEDC_CHANNEL_0};
+static status_pwm_t red = {.pin = -1, .channel = LEDC_CHANNEL_1};
+static led_strip_handle_t strip = NULL;
+
+/* Targets posted by handlers: plain stores and increments, read by the task */
+static volatile uint32_t mode_slot = STATUS_LED_OFF;
+static volatile uint32_t error_slot = 0; // code | sequence << 8, a new sequence restarts the code
+static volatile uint32_t flash_slot = 0; // flashes requested so far
+
+void status_led_set_mode(status_led_mode_t mode)
+{
+  __atomic_store_n(&mode_slot, (uint32_t)mode, __ATOMIC_RELEASE);
+}
+
+void status_led_error(status_led_error_t code)
+{
+  uint32_t old = __atomic_load_n(&error_slot, __ATOMIC_RELAXED);
+  uint32_t next;
+  do
+  {
+    next = (((old >> 8) + 1) << 8) | (uint8_t)code;
+  } while (!__atomic_compare_exchange_n(&error_slot, &old, next, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+void status_led_flash(void)
+{
+  __atomic_fetch_add(&flash_slot, 1, __ATOMIC_RELEASE);
+}
+
+static void pwm_apply(status_pwm_t *p, uint8_t level)
+{
+  if (p->pin < 0 || p->level == level)
+    return;
+  p->level = level;
+  // only registers are written, the LEDC hardware generates the PWM
+  ledc_set_duty(LEDC_LOW_SPEED_MODE, p->channel, (uint32_t)level * STATUS_LEDC_MAX / 255);
+  ledc_update_duty(LEDC_LOW_SPEED_MODE, p->channel);
+}
+
+static void pwm_init(status_pwm_t *p, int pin)
+{
+  p->pin = pin;
+  if (pin < 0)
+    return;
+  ledc_channel_config_t cfg = {
+      .gpio_num = pin,
+      .speed_mode = LEDC_LOW_SPEED_MODE,
+      .channel = p->channel,
+      .intr_type = LEDC_INTR_DISABLE,
+      .timer_sel = STATUS_LEDC_TIMER,
+      .duty = 0,
+      .hpoint = 0,
+  };
+  ESP_ERROR_CHECK(ledc_channel_config(&cfg));
+}
+
+// Triangle wave squared, close enough to a perceived smooth breath
+static uint8_t breath_level(uint32_t t_ms)
+{
+  uint32_t x = (t_ms % BREATH_MS) * 510 / BREATH_MS;
+  uint32_t tri = x < 255 ? x : 510 - x;
+  return (uint8_t)(tri * tri / 255);
+}
+
+// On while the code blinks; false once all cycles are shown
+static bool blink_level(uint8_t code, uint32_t t_ms, bool *on)
+{
+  uint32_t cycle_ms = code * (BLINK_ON_MS + BLINK_OFF_MS) + BLINK_PAUSE_MS;
+  if (t_ms >= cycle_ms * BLINK_CYCLES)
+    return false;
+  uint32_t in_cycle = t_ms % cycle_ms;
+  *on = in_cycle < code * (BLINK_ON_MS + BLINK_OFF_MS) && in_cycle % (BLINK_ON_MS + BLINK_OFF_MS) < BLINK_ON_MS;
+  return true;
+}
+
+static void status_led_task(void *arg)
+{
+  TickType_t last_wake = xTaskGetTickCount();
+  uint32_t now_ms = 0;
+  uint32_t seen_error = 0, seen_flash = 0;
+  uint32_t error_start_ms = 0, flash_until_ms = 0;
+  uint8_t error_code = 0;
+  uint8_t px[3] = {0, 0, 0};
+  bool px_valid = false;
+
+  while (1)
+  {
+    vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(STATUS_FRAME_MS));
+    now_ms += STATUS_FRAME_MS;
+
+    status_led_mode_t mode = (status_led_mode_t)__atomic_load_n(&mode_slot, __ATOMIC_ACQUIRE);
+    uint32_t err = __atomic_load_n(&error_slot, __ATOMIC_ACQUIRE);
+    if (err != seen_error)
+    {
+      seen_error = err;
+      error_code = err & 0xFF;
+      error_start_ms = now_ms;
+    }
+    uint32_t flashes = __atomic_load_n(&flash_slot, __ATOMIC_ACQUIRE);
+    if (flashes != seen_flash)
+    {
+      seen_flash = flashes;
+      flash_until_ms = now_ms + FLASH_MS;
+    }
+
+    uint8_t g = 0, r = 0;
+    uint8_t rgb[3] = {0, 0, 0};
+    bool on;
+    if (error_code && blink_level(error_code, now_ms - error_start_ms, &on))
+    {
+      r = on ? 255 : 0;
+      rgb[0] = r;
+    }
+    else
+    {
+      error_code = 0;
+      if (mode == STATUS_LED_RUNNING)
+      {
+        g = 255;
+        rgb[1] = 255;
+      }
+      else if (mode == STATUS_LED_PAUSED)
+      {
+        r = breath_level(now_ms);
+        rgb[0] = r;
+      }
+    }
+    if ((int32_t)(flash_until_ms - now_ms) > 0)
+    {
+      g = 255 - g; // a wink of the green LED
+      rgb[0] = rgb[1] = rgb[2] = 160;
+    }
+
+    pwm_apply(&green, g);
+    pwm_apply(&red, r);
+    if (strip && (!px_valid || px[0] != rgb[0] || px[1] != rgb[1] || px[2] != rgb[2]))
+    {
+      led_strip_set_pixel(strip, 0, rgb[0], rgb[1], rgb[2]);
+      led_strip_refresh(strip); // waits for the RMT transfer in this task only
+      px[0] = rgb[0];
+      px[1] = rgb[1];
+      px[2] = rgb[2];
+      px_valid = true;
+    }
+  }
+}
+
+void status_led_init(void)
+{
+  ledc_timer_config_t timer_cfg = {
+      .speed_mode = LEDC_LOW_SPEED_MODE,
+      .duty_resolution = STATUS_LEDC_BITS,
+      .timer_num = STATUS_LEDC_TIMER,
+      .freq_hz = 5000,
+      .clk_cfg = LEDC_AUTO_CLK,
+  };
+  ESP_ERROR_CHECK(ledc_timer_config(&timer_cfg));
+  pwm_init(&green, CONFIG_LED_GREEN_GPIO);
+  pwm_init(&red, CONFIG_LED_RED_GPIO);
+
+  if (CONFIG_NEOPIXEL_GPIO >= 0)
+  {
+    led_strip_config_t strip_cfg = {
+        .strip_gpio_num = CONFIG_NEOPIXEL_GPIO,
+        .max_leds = 1,
+    };
+    led_strip_rmt_config_t rmt_cfg = {
+        .resolution_hz = 10 * 1000 * 1000,
+        .flags.with_dma = false,
+    };
+    if (led_strip_new_rmt_device(&strip_cfg, &rmt_cfg, &strip) == ESP_OK)
+    {
+      led_strip_clear(strip);
+      ESP_LOGI(TAG, "NeoPixel initialized on GPIO %d", CONFIG_NEOPIXEL_GPIO);
+    }
+    else
+    {
+      strip = NULL;
+      ESP_LOGW(TAG, "NeoPixel initialization failed on GPIO %d", CONFIG_NEOPIXEL_GPIO);
+    }
+  }
+
+  // just above idle, a slow pixel transfer delays nothing else
+  xTaskCreatePinnedToCore(status_led_task, "status_led", 2560, NULL, 1, NULL, 0);
+}
@@ -0,0 +1,32 @@
+#ifndef STATUS_LED_H
+#define STATUS_LED_H
+
+#include <stdint.h>
+
+typedef enum {
+  STATUS_LED_OFF = 0,
+  STATUS_LED_RUNNING, // green steady
+  STATUS_LED_PAUSED,  // red breathing
+} status_led_mode_t;
+
+/* Blink codes, the number is how often red blinks */
+typedef enum {
+  STATUS_LED_ERR_PULSE_QUEUE = 2, // a clock pulse could not be queued
+} status_led_error_t;
+
+/*
+ * Green and red LEDs on LEDC PWM plus the status NeoPixel, animated by a low priority
+ * task. The setters only store into lock-free slots and never block, so they are safe
+ * from event handlers and timer callbacks; the task picks the target up next frame.
+ */
+void status_led_init(void);
+
+void status_led_set_mode(status_led_mode_t mode);
+
+// Blink the code a few times, then return to the mode
+void status_led_error(status_led_error_t code);
+
+// Short flash, e.g. on a minute pulse
+void status_led_flash(void);
+
+#endif
@@ -1,12 +1,143 @@
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
 #include "storage.h"
+#include "journal.h"
 #include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_system.h"
+#include "esp_partition.h"
+#include "esp_console.h"
 #include "nvs_flash.h"
+#include "driver/gpio.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "event_handler.h"
 #include "timer.h"
+#include "output_driver.h"
 #include <sys/time.h>
 
 static const char *TAG = "storage";
 
+#define SNAPSHOT_MAGIC 0x534E434Du // "MCNS"
+#define STORAGE_DEBOUNCE_MAX_MS 10000 // a request waits no longer for things to settle
+
+/* Live copy of the state in RTC memory, which keeps its content over every reset but a
+ * power-on. Written on each model tick into the older of two copies, so a reset in the
+ * middle of an update still leaves the previous one intact. */
+typedef struct {
+  uint32_t magic;
+  uint32_t size; // a new firmware with another layout must not take it
+  uint32_t seq;
+  storage_data_t data;
+  uint32_t running;
+  uint32_t crc;
+} rtc_snapshot_t;
+
+static RTC_NOINIT_ATTR rtc_snapshot_t snapshots[2];
+static uint32_t snapshot_seq = 0;
+
+static const esp_partition_t *journal_part = NULL;
+static journal_t journal;
+static bool journal_mounted = false;
+static SemaphoreHandle_t journal_mutex = NULL;
+static storage_data_t saved; // newest record in the journal
+static bool saved_valid = false;
+
+static storage_data_t restored; // what storage_read() hands out, read once at init
+static bool warm_resume = false;
+static bool resume_running = false;
+static bool loaded = false; // no saves of the defaults before storage_load()
+
+static TaskHandle_t storage_task_handle = NULL;
+static uint32_t save_requests = 0;
+static uint32_t save_runs = 0;
+
+static void snapshot_fill(storage_data_t *data)
+{
+  memset(data, 0, sizeof(*data)); // padding too, the journal compares whole records
+  data->model_ts = unix_ts;
+  data->real_ts = time(NULL);
+  data->timescale = timer_get_timescale();
+  output_clock_get_positions(data->hand_pos);
+}
+
+// EVENT_MODEL_TICK and state changes: a few dozen bytes and a CRC, no flash access
+static void snapshot_handler(void *handler_arg, esp_event_base_t base, int32_t id, void *event_data)
+{
+  rtc_snapshot_t snap = {
+      .magic = SNAPSHOT_MAGIC,
+      .size = sizeof(rtc_snapshot_t),
+      .seq = ++snapshot_seq,
+      .running = timer_is_running(),
+  };
+  snapshot_fill(&snap.data);
+  snap.crc = journal_crc32(0, &snap, offsetof(rtc_snapshot_t, crc));
+  snapshots[snap.seq & 1] = snap;
+}
+
+// The newer valid snapshot, only after resets that keep the RTC memory
+static bool snapshot_restore(storage_data_t *data, bool *running)
+{
+  switch (esp_reset_reason())
+  {
+  case ESP_RST_POWERON:
+  case ESP_RST_EXT:
+  case ESP_RST_UNKNOWN:
+    return false;
+  default:
+    break;
+  }
+  const rtc_snapshot_t *best = NULL;
+  for (int i = 0; i < 2; i++)
+  {
+    const rtc_snapshot_t *s = &snapshots[i];
+    if (s->magic != SNAPSHOT_MAGIC || s->size != sizeof(rtc_snapshot_t) || s->crc != journal_crc32(0, s, offsetof(rtc_snapshot_t, crc)))
+      continue;
+    if (!best || (int32_t)(s->seq - best->seq) > 0)
+      best = s;
+  }
+  if (!best)
+    return false;
+  *data = best->data;
+  *running = best->running;
+  snapshot_seq = best->seq;
+  return true;
+}
+
+/* Saves run here, below everything else on core 0, so no event handler or main loop ever
+ * waits for the flash. Requests are task notifications: any number of them before the
+ * task gets to run make one save, and a burst (encoder edits) is debounced until quiet. */
+static void storage_task(void *arg)
+{
+  while (1)
+  {
+    if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CONFIG_STORAGE_SAVE_INTERVAL_S * 1000)))
+    {
+      TickType_t first = xTaskGetTickCount();
+      while (xTaskGetTickCount() - first < pdMS_TO_TICKS(STORAGE_DEBOUNCE_MAX_MS) &&
+             ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CONFIG_STORAGE_DEBOUNCE_MS)))
+        ;
+    }
+    save_runs++;
+    storage_save(); // written only if the record changed
+  }
+}
+
+void storage_request_save(void)
+{
+  if (!storage_task_handle)
+    return;
+  save_requests++;
+  xTaskNotifyGive(storage_task_handle);
+}
+
+static void save_request_handler(void *handler_arg, esp_event_base_t base, int32_t id, void *event_data)
+{
+  storage_request_save();
+}
+
 void storage_load(void)
 {
   storage_data_t data = {
@@ -18,27 +149,162 @@ void storage_load(void)
   events_post(EVENT_TIMER_SCALE, &data.timescale, sizeof(data.timescale));
 
   unix_ts = data.model_ts;
+  output_clock_set_positions(data.hand_pos);
+  events_post(EVENT_MODEL_TIME_SET, NULL, 0);
 
-  struct timeval tv = {
-      .tv_sec = data.real_ts,
-      .tv_usec = 0};
-  settimeofday(&tv, NULL);
+  // a warm reset keeps the system time, do not turn it back to the last save
+  if (time(NULL) < (time_t)data.real_ts)
+  {
+    struct timeval tv = {
+        .tv_sec = data.real_ts,
+        .tv_usec = 0};
+    settimeofday(&tv, NULL);
+  }
 
-  ESP_LOGI(TAG, "Loaded model_ts: %lu, real_ts: %lu, timescale: %lu", data.model_ts, data.real_ts, data.timescale);
+  loaded = true;
+  if (warm_resume && resume_running)
+    events_post(EVENT_TIMER_RESUME, NULL, 0);
+
+  events_subscribe(EVENT_MODEL_TICK, snapshot_handler, NULL);
+  events_subscribe(EVENT_MODEL_TIME_SET, snapshot_handler, NULL);
+  events_subscribe(EVENT_TIMER_STATE_CHANGE, snapshot_handler, NULL);
+
+  // pause/resume, timescale and edits; the handler only wakes the storage task
+  events_subscribe(EVENT_TIMER_STATE_CHANGE, save_request_handler, NULL);
+  events_subscribe(EVENT_TIMER_SCALE, save_request_handler, NULL);
+  events_subscribe(EVENT_MODEL_TIME_SET, save_request_handler, NULL);
+  xTaskCreatePinnedToCore(storage_task, "storage", 3072, NULL, 1, &storage_task_handle, 0);
+
+  ESP_LOGI(TAG, "Loaded model_ts: %lu, real_ts: %lu, timescale: %lu%s", data.model_ts, data.real_ts, data.timescale,
+           warm_resume ? " (warm resume)" : "");
 }
 
 void storage_save(void)
 {
-  storage_data_t data = {
-      .model_ts = unix_ts,
-      .real_ts = time(NULL),
-      .timescale = timer_get_timescale()};
+  if (!loaded)
+    return;
+  storage_data_t data;
+  snapshot_fill(&data);
+
+  if (storage_write(&data))
+    ESP_LOGI(TAG, "Saved model_ts: %lu, real_ts: %lu, timescale: %lu", data.model_ts, data.real_ts, data.timescale);
+}
+
+static bool part_read(void *ctx, uint32_t addr, void *buf, uint32_t len)
+{
+  return esp_partition_read((const esp_partition_t *)ctx, addr, buf, len) == ESP_OK;
+}
+
+static bool part_write(void *ctx, uint32_t addr, const void *buf, uint32_t len)
+{
+  return esp_partition_write((const esp_partition_t *)ctx, addr, buf, len) == ESP_OK;
+}
+
+static bool part_erase(void *ctx, uint32_t addr, uint32_t len)
+{
+  return esp_partition_erase_range((const esp_partition_t *)ctx, addr, len) == ESP_OK;
+}
+
+// The three keys written before the journal existed
+static bool nvs_read_legacy(storage_data_t *data)
+{
+  nvs_handle handle;
+  if (nvs_open("storage", NVS_READONLY, &handle) != ESP_OK)
+    return false;
+  bool found = nvs_get_u32(handle, "model_ts", &data->model_ts) == ESP_OK;
+  nvs_get_u32(handle, "real_ts", &data->real_ts);
+  nvs_get_u32(handle, "timescale", &data->timescale);
+  for (int i = 0; i < OUTPUT_CLOCK_CHANNELS; i++)
+  {
+    char key[8];
+    snprintf(key, sizeof(key), "hands%d", i);
+    nvs_get_u16(handle, key, &data->hand_pos[i]);
+  }
+  nvs_close(handle);
+  return found;
+}
 
-  storage_write(&data);
+// Mounting scans the whole partition, storage_init() does it so no save pays for it, and
+// leaves the next slot erased: from then on every save is a single flash program
+static bool journal_ready(void)
+{
+  if (journal_mounted)
+    return true;
+  if (!journal_part)
+    return false;
+  const journal_flash_t flash = {
+      .read = part_read,
+      .write = part_write,
+      .erase = part_erase,
+      .ctx = (void *)journal_part,
+      .size = journal_part->size,
+      .sector_size = journal_part->erase_size,
+  };
+  memset(&saved, 0, sizeof(saved));
+  for (int i = 0; i < OUTPUT_CLOCK_CHANNELS; i++)
+    saved.hand_pos[i] = OUTPUT_HANDS_UNKNOWN;
+  uint16_t len = journal_mount(&journal, &flash, sizeof(saved), &saved);
+  journal_mounted = true;
+  if (len > 0)
+  {
+    saved_valid = true;
+    ESP_LOGI(TAG, "Record %lu found (%u bytes), %lu sector erases so far", journal.stats.seq, len,
+             journal.stats.erases);
+  }
+  else if (nvs_read_legacy(&saved))
+  {
+    // first boot with the journal: carry the NVS keys over
+    saved_valid = true;
+    journal_append(&journal, &saved);
+    ESP_LOGI(TAG, "Migrated the NVS keys into the journal");
+  }
+  if (!journal_prepare(&journal))
+    ESP_LOGE(TAG, "Journal slot %lu cannot be prepared", journal.stats.slot);
+  return true;
+}
 
-  ESP_LOGI(TAG, "Saved model_ts: %lu, real_ts: %lu, timescale: %lu", data.model_ts, data.real_ts, data.timescale);
+#if CONFIG_POWER_FAIL_ENABLE
+static TaskHandle_t power_fail_task_handle = NULL;
+
+static void IRAM_ATTR power_fail_isr(void *arg)
+{
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(power_fail_task_handle, &woken);
+  portYIELD_FROM_ISR(woken);
 }
 
+// The supply is going: write the record while the hold-up capacitors last. The journal
+// is mounted and its next slot erased, so this is one program of a record.
+static void power_fail_task(void *arg)
+{
+  while (1)
+  {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    storage_save();
+    ESP_LOGW(TAG, "Power fail, state saved");
+  }
+}
+
+static void power_fail_init(void)
+{
+  // above everything else on core 0; a save of the storage task holding the journal
+  // finishes first, with the erase ahead after a full sector that is one sector erase
+  xTaskCreatePinnedToCore(power_fail_task, "power_fail", 3072, NULL, 10, &power_fail_task_handle, 0);
+  gpio_config_t pf_config = {
+      .pin_bit_mask = 1ULL << CONFIG_POWER_FAIL_GPIO,
+      .mode = GPIO_MODE_INPUT,
+      .pull_up_en = CONFIG_POWER_FAIL_ACTIVE_LEVEL ? GPIO_PULLUP_DISABLE : GPIO_PULLUP_ENABLE,
+      .pull_down_en = GPIO_PULLDOWN_DISABLE,
+      .intr_type = CONFIG_POWER_FAIL_ACTIVE_LEVEL ? GPIO_INTR_POSEDGE : GPIO_INTR_NEGEDGE,
+  };
+  ESP_ERROR_CHECK(gpio_config(&pf_config));
+  esp_err_t err = gpio_install_isr_service(0);
+  if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) // already installed by another driver
+    ESP_ERROR_CHECK(err);
+  ESP_ERROR_CHECK(gpio_isr_handler_add(CONFIG_POWER_FAIL_GPIO, power_fail_isr, NULL));
+}
+#endif
+
 void storage_init(void)
 {
   esp_err_t ret = nvs_flash_init();
@@ -48,34 +314,110 @@ void storage_init(void)
     ret = nvs_flash_init();
   }
   ESP_ERROR_CHECK(ret);
+
+  journal_mutex = xSemaphoreCreateMutex();
+  journal_part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "journal");
+  if (!journal_part)
+    ESP_LOGE(TAG, "No journal partition, state is not kept");
+
+  // esp_restart() goes through here, resets by panic or watchdog have the snapshot
+  ESP_ERROR_CHECK(esp_register_shutdown_handler(storage_save));
+
+  // mounted eagerly, also for a warm resume: the first save may be the power-fail one
+  xSemaphoreTake(journal_mutex, portMAX_DELAY);
+  journal_ready();
+  xSemaphoreGive(journal_mutex);
+#if CONFIG_POWER_FAIL_ENABLE
+  power_fail_init();
+#endif
+
+  if (snapshot_restore(&restored, &resume_running))
+  {
+    warm_resume = true;
+    ESP_LOGI(TAG, "Warm resume from snapshot %lu", snapshot_seq);
+    return;
+  }
+
+  restored = (storage_data_t){
+      .model_ts = DEFAULT_UNIX_TS,
+      .real_ts = DEFAULT_REAL_TS,
+      .timescale = DEFAULT_TIMESCALE,
+  };
+  for (int i = 0; i < OUTPUT_CLOCK_CHANNELS; i++)
+    restored.hand_pos[i] = OUTPUT_HANDS_UNKNOWN;
+  if (journal_mounted && saved_valid)
+    restored = saved;
 }
 
-void storage_write(storage_data_t *data)
+bool storage_write(storage_data_t *data)
 {
-  nvs_handle handle;
-  ESP_ERROR_CHECK(nvs_open("storage", NVS_READWRITE, &handle));
-  ESP_ERROR_CHECK(nvs_set_u32(handle, "model_ts", data->model_ts));
-  ESP_ERROR_CHECK(nvs_set_u32(handle, "real_ts", data->real_ts));
-  ESP_ERROR_CHECK(nvs_set_u32(handle, "timescale", data->timescale));
-  nvs_close(handle);
+  xSemaphoreTake(journal_mutex, portMAX_DELAY);
+  bool written = false;
+  if (!journal_ready())
+  {
+    xSemaphoreGive(journal_mutex);
+    return false;
+  }
+  // the wall clock alone is no reason to wear the flash
+  if (saved_valid && data->model_ts == saved.model_ts && data->timescale == saved.timescale &&
+      memcmp(data->hand_pos, saved.hand_pos, sizeof(data->hand_pos)) == 0)
+  {
+    journal.stats.skipped++;
+  }
+  else if (journal_append(&journal, data) == JOURNAL_ERROR)
+  {
+    ESP_LOGE(TAG, "Journal write failed at slot %lu", journal.stats.slot);
+  }
+  else
+  {
+    saved = *data;
+    saved_valid = true;
+    written = true;
+  }
+  xSemaphoreGive(journal_mutex);
+  return written;
 }
 
 void storage_read(storage_data_t *data)
 {
-  nvs_handle handle;
-  esp_err_t err;
-  ESP_ERROR_CHECK(nvs_open("storage", NVS_READWRITE, &handle));
-  err = nvs_get_u32(handle, "model_ts", &data->model_ts);
-  if (err == ESP_ERR_NVS_NOT_FOUND)
-    data->model_ts = DEFAULT_UNIX_TS;
+  *data = restored;
+}
 
-  err = nvs_get_u32(handle, "real_ts", &data->real_ts);
-  if (err == ESP_ERR_NVS_NOT_FOUND)
-    data->real_ts = DEFAULT_REAL_TS;
+bool storage_get_stats(journal_stats_t *out)
+{
+  xSemaphoreTake(journal_mutex, portMAX_DELAY);
+  bool ok = journal_ready();
+  *out = journal.stats;
+  xSemaphoreGive(journal_mutex);
+  return ok;
+}
 
-  err = nvs_get_u32(handle, "timescale", &data->timescale);
-  if (err == ESP_ERR_NVS_NOT_FOUND)
-    data->timescale = DEFAULT_TIMESCALE;
+static int cmd_storage(int argc, char **argv)
+{
+  journal_stats_t s;
+  if (!storage_get_stats(&s))
+  {
+    printf("no journal partition\n");
+    return 1;
+  }
+  uint32_t sectors = journal.flash.size / journal.flash.sector_size;
+  // erases rotate over all sectors, each sees erases / sectors cycles
+  uint32_t wear_ppm = (uint32_t)((uint64_t)s.erases * 1000000 / sectors / JOURNAL_WEAR_CYCLES);
+  printf("record %lu, next slot %lu of %lu bytes\n", s.seq, s.slot, s.slot_size);
+  printf("writes %lu, unchanged %lu, torn slots %lu since boot\n", s.writes, s.skipped, s.torn);
+  printf("save requests %lu, saves run %lu\n", save_requests, save_runs);
+  printf("snapshot %lu in RTC memory%s\n", snapshot_seq, warm_resume ? ", booted from it" : "");
+  printf("erases %lu over %lu sectors, wear %lu.%04lu%% of %d cycles\n", s.erases, sectors, wear_ppm / 10000,
+         wear_ppm % 10000, JOURNAL_WEAR_CYCLES);
+  return 0;
+}
 
-  nvs_close(handle);
-}
\ No newline at end of file
+void storage_register_commands(void)
+{
+  const esp_console_cmd_t storage_cmd = {
+      .command = "storage",
+      .help = "State journal: newest record, skipped writes and flash wear",
+      .func = cmd_storage,
+  };
+  ESP_ERROR_CHECK(esp_console_cmd_register(&storage_cmd));
+}
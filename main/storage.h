@@ -2,19 +2,38 @@
 #define STORAGE_H
 
 #include <stdint.h>
+#include <stdbool.h>
+#include "output_driver.h"
+#include "journal.h"
 
 typedef struct {
   uint32_t model_ts;
   uint32_t real_ts;
   uint32_t timescale;
+  uint16_t hand_pos[OUTPUT_CLOCK_CHANNELS]; // OUTPUT_HANDS_UNKNOWN if never saved
 } storage_data_t;
 
+/*
+ * The state lives in one CRC'd record appended to the "journal" partition (journal.c);
+ * init restores the newest record with a single scan, older NVS keys are migrated once.
+ * Every model tick also refreshes a snapshot in RTC memory: after a reset that kept the
+ * power (panic, watchdog, brownout, esp_restart) init resumes from it, flash untouched.
+ */
 void storage_init(void);
 
+// Applies the restored state and starts the RTC snapshots; resumes the timer on a warm reset
 void storage_load(void);
+// Writes now, from the calling task; also called on esp_restart() and on the power-fail input
 void storage_save(void);
+// Queue a save for the storage task, never blocks; requests coalesce until it runs
+void storage_request_save(void);
 
-void storage_write(storage_data_t *data);
+// false if nothing was written: the record is unchanged apart from real_ts, or flash failed
+bool storage_write(storage_data_t *data);
 void storage_read(storage_data_t *data);
 
+bool storage_get_stats(journal_stats_t *out);
+
+void storage_register_commands(void);
+
 #endif
\ No newline at end of file
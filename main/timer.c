@@ -1,7 +1,9 @@
 #include "timer.h"
 #include "esp_log.h"
 #include "driver/gptimer.h"
+#include "esp_timer.h"
 #include "event_handler.h"
+#include "calendar.h"
 
 static const char *TAG = "model_timer";
 
@@ -12,6 +14,11 @@ static gptimer_handle_t gptimer = NULL;
 static uint32_t current_timescale = DEFAULT_TIMESCALE; // default 1:2
 static bool timer_running = false;
 
+// real time of the last model second, model sub-seconds are interpolated from it
+static volatile int64_t tick_real_us = 0;
+static int64_t paused_frac_us = 0; // model sub-second where the timer was stopped
+static portMUX_TYPE tick_lock = portMUX_INITIALIZER_UNLOCKED;
+
 // Pause timer
 void timer_pause(void);
 // Resume timer
@@ -28,7 +35,10 @@ static bool IRAM_ATTR timer_isr_callback(
     void *user_data)
 {
   // Increment one model-second
+  portENTER_CRITICAL_ISR(&tick_lock);
   unix_ts++;
+  tick_real_us = esp_timer_get_time();
+  portEXIT_CRITICAL_ISR(&tick_lock);
 
   // Notify worker task(s) via queue
   BaseType_t xHigherPriorityTaskWoken = pdFALSE;
@@ -46,15 +56,13 @@ static bool IRAM_ATTR timer_isr_callback(
 void tick_consumer_task(void *pvParams)
 {
   uint32_t tick_val;
-  struct tm tm_info;
 
   while (true)
   {
     if (xQueueReceive(tick_queue, &tick_val, portMAX_DELAY))
     {
-      ts_to_tm(tick_val, &tm_info);
       events_post(EVENT_MODEL_TICK, &tick_val, sizeof(tick_val));
-      if (timer_running && tm_info.tm_sec == 0)
+      if (timer_running && tick_val % 60 == 0)
       {
         events_post(EVENT_MODEL_MINUTE_TICK, &tick_val, sizeof(tick_val));
       }
@@ -124,6 +132,22 @@ void timer_initialize(void)
   events_subscribe(EVENT_TIMER_SCALE, timer_event_handler, NULL);
 }
 
+// Model time in us at the given esp_timer time, safe from ISRs
+int64_t IRAM_ATTR timer_model_time_us(int64_t real_us)
+{
+  portENTER_CRITICAL_SAFE(&tick_lock);
+  uint32_t ts = unix_ts;
+  int64_t tick_us = tick_real_us;
+  portEXIT_CRITICAL_SAFE(&tick_lock);
+
+  int64_t frac = timer_running ? (real_us - tick_us) * current_timescale : paused_frac_us;
+  if (frac < 0)
+    frac = 0;
+  else if (frac > 999999)
+    frac = 999999; // the tick is due, do not run ahead of unix_ts
+  return (int64_t)ts * 1000000 + frac;
+}
+
 // Converts unix timestamp to formatted string in "YYYY-MM-DD HH:MM:SS" format
 void format_datetime_lcd(time_t ts, char *out, size_t out_sz)
 {
@@ -139,17 +163,27 @@ void format_datetime(time_t ts, char *out, size_t out_sz)
   strftime(out, out_sz, "%Y-%m-%d %H:%M:%S", &tm_info);
 }
 
-// Convert UNIX timestamp → tm
+// Convert UNIX timestamp → tm (UTC, without the libc TZ lookup)
 void ts_to_tm(uint32_t unix_ts, struct tm *out)
 {
-  time_t t = unix_ts;
-  gmtime_r(&t, out); // use localtime_r if you want timezone
+  calendar_t c;
+  calendar_from_ts(unix_ts, &c);
+  *out = (struct tm){
+      .tm_year = c.year - 1900,
+      .tm_mon = c.month - 1,
+      .tm_mday = c.day,
+      .tm_hour = c.hour,
+      .tm_min = c.minute,
+      .tm_sec = c.second,
+      .tm_wday = c.wday,
+      .tm_yday = c.yday,
+  };
 }
 
-// Convert tm → UNIX timestamp
+// Convert tm → UNIX timestamp, out of range fields carry over
 uint32_t tm_to_ts(struct tm *in)
 {
-  return (uint32_t)mktime(in); // normalizes fields too
+  return calendar_to_ts(in->tm_year + 1900, in->tm_mon + 1, in->tm_mday, in->tm_hour, in->tm_min, in->tm_sec);
 }
 
 // Sets the timer timescale
@@ -180,6 +214,7 @@ void timer_pause(void)
   if (timer_running)
   {
     ESP_ERROR_CHECK(gptimer_stop(gptimer));
+    paused_frac_us = timer_model_time_us(esp_timer_get_time()) % 1000000;
     timer_running = false;
     ESP_LOGI(TAG, "Timer paused");
     events_post(EVENT_TIMER_STATE_CHANGE, NULL, 0);
@@ -191,6 +226,8 @@ void timer_resume(void)
 {
   if (!timer_running)
   {
+    // the gptimer keeps its count, so the current model second continues
+    tick_real_us = esp_timer_get_time() - paused_frac_us / current_timescale;
     ESP_ERROR_CHECK(gptimer_start(gptimer));
     timer_running = true;
     ESP_LOGI(TAG, "Timer resumed (scale=%d)", current_timescale);
@@ -44,4 +44,7 @@ uint32_t tm_to_ts(struct tm *in);
 // Check if timer is running
 bool timer_is_running(void);
 
+// Model time in microseconds at an esp_timer_get_time() instant, ISR safe
+int64_t timer_model_time_us(int64_t real_us);
+
 #endif
\ No newline at end of file
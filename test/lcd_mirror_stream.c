@@ -0,0 +1,108 @@
+/*
+ * Feeds lcd_mirror.c a sequence of 20x4 frames and writes the stream to a tty, for
+ * test_lcd_mirror.py to decode at the other end of a pty.
+ *
+ *   lcd_mirror_stream <tty> <expected> [corrupt_every]
+ *
+ * <expected> gets one line per packet sent: "<seq> <cells as hex>". With corrupt_every
+ * set, one byte of every n-th packet is flipped on the way out.
+ */
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include "driver/uart.h"
+#include "lcd_mirror.h"
+#include "lcd_driver.h"
+#include "test.h"
+
+#define FRAMES 200
+#define FRAME_US 100000 // 10 frames per keyframe interval
+
+static int tty = -1;
+static int64_t now_us = 0;
+static int corrupt_every = 0;
+static int packets = 0;
+static int writes = 0;
+
+int uart_write_bytes(uart_port_t port, const void *data, size_t len)
+{
+  uint8_t buf[LCD_MIRROR_MAX_PAYLOAD];
+  memcpy(buf, data, len);
+  // lcd_mirror.c writes header, payload and CRC of a packet separately
+  bool payload = writes % 3 == 1;
+  if (payload && corrupt_every && packets % corrupt_every == corrupt_every - 1)
+    buf[len / 2] ^= 0x20;
+  if (++writes % 3 == 0)
+    packets++;
+  CHECK(write(tty, buf, len) == (ssize_t)len);
+  return len;
+}
+
+esp_err_t uart_driver_install(uart_port_t port, int rx_size, int tx_size, int queue_size, void *queue, int flags) { return ESP_OK; }
+esp_err_t uart_param_config(uart_port_t port, const uart_config_t *config) { return ESP_OK; }
+esp_err_t uart_set_pin(uart_port_t port, int tx, int rx, int rts, int cts) { return ESP_OK; }
+
+int64_t esp_timer_get_time(void)
+{
+  return now_us;
+}
+
+// Mostly a ticking clock, now and then a new screen
+static void next_frame(char *cells, int frame)
+{
+  if (frame == 0 || rand() % 25 == 0)
+  {
+    for (int i = 0; i < LCD_BUFFER_SIZE; i++)
+      cells[i] = ' ' + rand() % 95;
+    return;
+  }
+  int changes = rand() % 4;
+  for (int i = 0; i < changes; i++)
+    cells[rand() % LCD_BUFFER_SIZE] = '0' + rand() % 10;
+}
+
+int main(int argc, char **argv)
+{
+  CHECK(argc >= 3);
+  tty = open(argv[1], O_WRONLY | O_NOCTTY);
+  CHECK(tty >= 0);
+  struct termios tio;
+  CHECK(tcgetattr(tty, &tio) == 0);
+  cfmakeraw(&tio); // no newline translation
+  CHECK(tcsetattr(tty, TCSANOW, &tio) == 0);
+  FILE *expected = fopen(argv[2], "w");
+  CHECK(expected != NULL);
+  if (argc > 3)
+    corrupt_every = atoi(argv[3]);
+
+  srand(1);
+  lcd_mirror_init();
+  char cells[LCD_BUFFER_SIZE];
+  for (int frame = 0; frame < FRAMES; frame++)
+  {
+    next_frame(cells, frame);
+    lcd_mirror_stats_t before, after;
+    lcd_mirror_get_stats(&before);
+    lcd_mirror_frame(cells, LCD_COLS, LCD_ROWS);
+    lcd_mirror_get_stats(&after);
+    if (after.keyframes + after.deltas != before.keyframes + before.deltas)
+    {
+      fprintf(expected, "%d ", (packets - 1) & 0xFF);
+      for (int i = 0; i < LCD_BUFFER_SIZE; i++)
+        fprintf(expected, "%02x", (uint8_t)cells[i]);
+      fprintf(expected, "\n");
+    }
+    now_us += FRAME_US;
+  }
+
+  lcd_mirror_stats_t stats;
+  lcd_mirror_get_stats(&stats);
+  printf("%d packets, %lu keyframes, %lu deltas, %lu bytes\n", packets,
+         (unsigned long)stats.keyframes, (unsigned long)stats.deltas, (unsigned long)stats.bytes);
+  fclose(expected);
+  close(tty);
+  return 0;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/gpio.h"
+
+#define I2C_NUM_0 0
+#define I2C_MASTER_WRITE 0
+typedef enum { I2C_CLK_SRC_DEFAULT } i2c_clock_source_t;
+typedef enum { I2C_ADDR_BIT_LEN_7 } i2c_addr_bit_len_t;
+typedef struct i2c_master_bus_t *i2c_master_bus_handle_t;
+typedef struct i2c_master_dev_t *i2c_master_dev_handle_t;
+
+typedef struct {
+  int i2c_port;
+  gpio_num_t sda_io_num;
+  gpio_num_t scl_io_num;
+  i2c_clock_source_t clk_source;
+  uint8_t glitch_ignore_cnt;
+  struct {
+    uint32_t enable_internal_pullup : 1;
+  } flags;
+} i2c_master_bus_config_t;
+
+typedef struct {
+  i2c_addr_bit_len_t dev_addr_length;
+  uint16_t device_address;
+  uint32_t scl_speed_hz;
+} i2c_device_config_t;
+
+esp_err_t i2c_new_master_bus(const i2c_master_bus_config_t *config, i2c_master_bus_handle_t *bus);
+esp_err_t i2c_master_bus_add_device(i2c_master_bus_handle_t bus, const i2c_device_config_t *config,
+                                    i2c_master_dev_handle_t *dev);
+esp_err_t i2c_master_bus_reset(i2c_master_bus_handle_t bus);
+esp_err_t i2c_master_probe(i2c_master_bus_handle_t bus, uint16_t address, int timeout_ms);
+esp_err_t i2c_master_transmit(i2c_master_dev_handle_t dev, const uint8_t *data, size_t len, int timeout_ms);
@@ -0,0 +1,11 @@
+#pragma once
+#include <stdio.h>
+#include "esp_err.h"
+
+// Warnings and errors show up in the test output, the rest is compiled but dropped
+#define ESP_LOG_(level, tag, fmt, ...) printf(level " %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGE(tag, fmt, ...) ESP_LOG_("E", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) ESP_LOG_("W", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) do { if (0) ESP_LOG_("I", tag, fmt, ##__VA_ARGS__); } while (0)
+#define ESP_LOGD(tag, fmt, ...) do { if (0) ESP_LOG_("D", tag, fmt, ##__VA_ARGS__); } while (0)
+#define ESP_LOGV(tag, fmt, ...) do { if (0) ESP_LOG_("V", tag, fmt, ##__VA_ARGS__); } while (0)
@@ -0,0 +1,29 @@
+#pragma once
+/* Configuration the host tests are built with, see test/CMakeLists.txt */
+
+#define CONFIG_BUTTON_START_STOP_GPIO 4
+#define CONFIG_BUTTON_MENU_GPIO 5
+#define CONFIG_BUTTON_LEFT_GPIO 6
+#define CONFIG_BUTTON_RIGHT_GPIO 7
+#define CONFIG_BUTTON_UP_GPIO 10
+#define CONFIG_BUTTON_DOWN_GPIO 11
+#define CONFIG_BUTTON_CANCEL_GPIO 12
+#define CONFIG_BUTTON_OK_GPIO 13
+#define CONFIG_BUTTON_SCAN_PERIOD_MS 10
+#define CONFIG_BUTTON_DEBOUNCE_MS 20
+#define CONFIG_BUTTON_LONG_PRESS_MS 1000
+#define CONFIG_BUTTON_REPEAT_DELAY_MS 500
+#define CONFIG_BUTTON_CHORD_WINDOW_MS 80
+
+#define CONFIG_LCD_STATION_COUNT 1
+#define CONFIG_LCD_STATION1_ADDRESS 0x26
+#define CONFIG_LCD_STATION_COLS 16
+#define CONFIG_LCD_STATION_ROWS 2
+#define CONFIG_LCD_BUS_BUDGET_PCT 80
+#define CONFIG_LCD_TICKER_STEP_MS 400
+#define CONFIG_LCD_FAULT_INJECT_PCT 0
+#define CONFIG_LCD_MIRROR 1
+#define CONFIG_LCD_MIRROR_UART_NUM 1
+#define CONFIG_LCD_MIRROR_TX_GPIO 17
+#define CONFIG_LCD_MIRROR_BAUD 115200
+#define CONFIG_LCD_MIRROR_KEYFRAME_S 1
@@ -0,0 +1,37 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Host test helpers: a failed check prints where and ends the test with exit code 1. */
+#define CHECK(cond)                                                   \
+  do                                                                  \
+  {                                                                   \
+    if (!(cond))                                                      \
+    {                                                                 \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+      exit(1);                                                        \
+    }                                                                 \
+  } while (0)
+
+#define CHECK_EQ(a, b)                                                \
+  do                                                                  \
+  {                                                                   \
+    long long a_ = (long long)(a), b_ = (long long)(b);               \
+    if (a_ != b_)                                                     \
+    {                                                                 \
+      fprintf(stderr, "%s:%d: %s == %lld, expected %s == %lld\n",    \
+              __FILE__, __LINE__, #a, a_, #b, b_);                    \
+      exit(1);                                                        \
+    }                                                                 \
+  } while (0)
+
+#define RUN(test)              \
+  do                           \
+  {                            \
+    printf("%s\n", #test);     \
+    test();                    \
+  } while (0)
+
+#endif
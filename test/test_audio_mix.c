@@ -0,0 +1,179 @@
+/*
+ * The Q15 mixer and the chime schedule of audio_mix.c.
+ */
+#include <string.h>
+#include "audio_mix.h"
+#include "test.h"
+
+// -----------------
+// Mixer
+// -----------------
+
+static int16_t ramp[300];
+static int16_t loud[100];
+
+static void setup_samples(void)
+{
+  for (int i = 0; i < 300; i++)
+    ramp[i] = (int16_t)(i * 100 - 15000);
+  for (int i = 0; i < 100; i++)
+    loud[i] = i % 2 ? -30000 : 30000;
+}
+
+static void test_single_voice_passes_through(void)
+{
+  audio_mixer_t m;
+  audio_clip_t clip = {ramp, 300, AUDIO_GAIN_UNITY};
+  int16_t out[400];
+  audio_mixer_init(&m, AUDIO_GAIN_UNITY);
+  CHECK(audio_mixer_start(&m, &clip));
+
+  // blocks that do not line up with the clip or the internal chunks
+  CHECK_EQ(audio_mixer_render(&m, out, 150), 1);
+  CHECK_EQ(audio_mixer_render(&m, out + 150, 250), 0);
+  for (int i = 0; i < 300; i++)
+    CHECK_EQ(out[i], ramp[i]);
+  for (int i = 300; i < 400; i++)
+    CHECK_EQ(out[i], 0);
+  CHECK_EQ(m.clipped, 0);
+
+  // the voice is free again
+  for (int v = 0; v < AUDIO_VOICES_MAX; v++)
+    CHECK(m.voices[v].clip == NULL);
+}
+
+static void test_gain_and_master_scale(void)
+{
+  audio_mixer_t m;
+  audio_clip_t clip = {ramp, 300, AUDIO_GAIN_UNITY / 2};
+  int16_t out[300];
+  audio_mixer_init(&m, AUDIO_GAIN_UNITY / 2);
+  CHECK(audio_mixer_start(&m, &clip));
+  audio_mixer_render(&m, out, 300);
+  for (int i = 0; i < 300; i++)
+    CHECK_EQ(out[i], ((ramp[i] * 16384) >> 15) * 16384 >> 15);
+
+  audio_mixer_init(&m, 0);
+  CHECK(audio_mixer_start(&m, &clip));
+  audio_mixer_render(&m, out, 300);
+  for (int i = 0; i < 300; i++)
+    CHECK_EQ(out[i], 0);
+}
+
+static void test_voices_sum_and_saturate(void)
+{
+  audio_mixer_t m;
+  audio_clip_t a = {loud, 100, AUDIO_GAIN_UNITY};
+  audio_clip_t b = {loud, 50, AUDIO_GAIN_UNITY};
+  int16_t out[100];
+  audio_mixer_init(&m, AUDIO_GAIN_UNITY);
+  CHECK(audio_mixer_start(&m, &a));
+  CHECK(audio_mixer_start(&m, &b));
+  CHECK_EQ(audio_mixer_render(&m, out, 100), 0);
+
+  // both voices: saturated, then the longer one alone
+  for (int i = 0; i < 50; i++)
+    CHECK_EQ(out[i], i % 2 ? INT16_MIN : INT16_MAX);
+  for (int i = 50; i < 100; i++)
+    CHECK_EQ(out[i], loud[i]);
+  CHECK_EQ(m.clipped, 50);
+}
+
+static void test_start_needs_a_free_voice(void)
+{
+  audio_mixer_t m;
+  audio_clip_t clip = {ramp, 300, AUDIO_GAIN_UNITY};
+  audio_clip_t empty = {ramp, 0, AUDIO_GAIN_UNITY};
+  int16_t out[300];
+  audio_mixer_init(&m, AUDIO_GAIN_UNITY);
+  CHECK(!audio_mixer_start(&m, &empty));
+  for (int v = 0; v < AUDIO_VOICES_MAX; v++)
+    CHECK(audio_mixer_start(&m, &clip));
+  CHECK(!audio_mixer_start(&m, &clip));
+
+  CHECK_EQ(audio_mixer_render(&m, out, 299), AUDIO_VOICES_MAX);
+  CHECK(!audio_mixer_start(&m, &clip));
+  CHECK_EQ(audio_mixer_render(&m, out, 1), 0);
+  CHECK(audio_mixer_start(&m, &clip));
+}
+
+// -----------------
+// Schedule
+// -----------------
+
+static const char *CLIPS[] = {"chime", "half", "hour"};
+
+static int find_clip(const char *name, int len)
+{
+  for (int i = 0; i < 3; i++)
+    if ((int)strlen(CLIPS[i]) == len && strncmp(CLIPS[i], name, len) == 0)
+      return i;
+  return -1;
+}
+
+static void test_sched_parse(void)
+{
+  audio_sched_t s;
+  CHECK_EQ(audio_sched_parse(&s, "07:30=chime,*:00=hour,*:30=half", find_clip), 0);
+  CHECK_EQ(s.count, 3);
+  CHECK(s.entries[0].hour == 7 && s.entries[0].minute == 30 && s.entries[0].clip == 0);
+  CHECK(s.entries[1].hour == -1 && s.entries[1].minute == 0 && s.entries[1].clip == 2);
+  CHECK(s.entries[2].hour == -1 && s.entries[2].minute == 30 && s.entries[2].clip == 1);
+
+  static const char *invalid[] = {"-5:00=chime", "-1:00=chime", "24:00=chime", "12:60=chime", "12:-1=chime",
+                                  "*:-1=chime",  "12:5x=chime", "12=chime",    ":30=chime",   "12:00=bell",
+                                  "12:00",       "nope"};
+  for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++)
+  {
+    CHECK_EQ(audio_sched_parse(&s, invalid[i], find_clip), 1);
+    CHECK_EQ(s.count, 0);
+  }
+
+  // the good ones around a bad one stay
+  CHECK_EQ(audio_sched_parse(&s, "00:00=hour,-5:00=chime,23:59=half", find_clip), 1);
+  CHECK_EQ(s.count, 2);
+  CHECK(s.entries[1].hour == 23 && s.entries[1].minute == 59);
+}
+
+static void test_sched_parse_stops_when_full(void)
+{
+  char text[AUDIO_SCHEDULE_MAX * 16];
+  text[0] = '\0';
+  for (int i = 0; i < AUDIO_SCHEDULE_MAX + 2; i++)
+    snprintf(text + strlen(text), sizeof(text) - strlen(text), "%s*:%02d=chime", i ? "," : "", i);
+  audio_sched_t s;
+  CHECK_EQ(audio_sched_parse(&s, text, find_clip), 2);
+  CHECK_EQ(s.count, AUDIO_SCHEDULE_MAX);
+}
+
+static void test_sched_due(void)
+{
+  audio_sched_t s;
+  audio_sched_parse(&s, "07:30=chime,*:00=hour,*:30=half,19:30=chime", find_clip);
+  uint8_t clips[4];
+  CHECK_EQ(audio_sched_due(&s, 7 * 60 + 30, clips, 4), 2);
+  CHECK(clips[0] == 0 && clips[1] == 1);
+  CHECK_EQ(audio_sched_due(&s, 19 * 60 + 30, clips, 4), 2);
+  CHECK_EQ(audio_sched_due(&s, 8 * 60 + 30, clips, 4), 1);
+  CHECK_EQ(clips[0], 1);
+  CHECK_EQ(audio_sched_due(&s, 0, clips, 4), 1);
+  CHECK_EQ(clips[0], 2);
+  CHECK_EQ(audio_sched_due(&s, 7 * 60 + 31, clips, 4), 0);
+
+  // no more than asked for
+  CHECK_EQ(audio_sched_due(&s, 7 * 60 + 30, clips, 1), 1);
+  CHECK_EQ(clips[0], 0);
+}
+
+int main(void)
+{
+  setup_samples();
+  RUN(test_single_voice_passes_through);
+  RUN(test_gain_and_master_scale);
+  RUN(test_voices_sum_and_saturate);
+  RUN(test_start_needs_a_free_voice);
+  RUN(test_sched_parse);
+  RUN(test_sched_parse_stops_when_full);
+  RUN(test_sched_due);
+  return 0;
+}
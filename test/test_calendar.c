@@ -0,0 +1,147 @@
+/*
+ * calendar.c against the C library (gmtime_r / timegm) over the whole 32-bit range, and
+ * the field adjust of the datetime editor.
+ */
+#define _GNU_SOURCE // timegm
+#include <stdint.h>
+#include <time.h>
+#include "calendar.h"
+#include "test.h"
+
+#define CASES 1000000
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ull;
+
+static uint32_t rnd(void)
+{
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 7;
+  rng_state ^= rng_state << 17;
+  return (uint32_t)(rng_state >> 16);
+}
+
+static int32_t rnd_range(int32_t lo, int32_t hi)
+{
+  return lo + (int32_t)(rnd() % (uint32_t)(hi - lo + 1));
+}
+
+static void check_from_ts(uint32_t ts)
+{
+  time_t t = ts;
+  struct tm tm;
+  CHECK(gmtime_r(&t, &tm) != NULL);
+
+  calendar_t c;
+  calendar_from_ts(ts, &c);
+  CHECK_EQ(c.year, tm.tm_year + 1900);
+  CHECK_EQ(c.month, tm.tm_mon + 1);
+  CHECK_EQ(c.day, tm.tm_mday);
+  CHECK_EQ(c.hour, tm.tm_hour);
+  CHECK_EQ(c.minute, tm.tm_min);
+  CHECK_EQ(c.second, tm.tm_sec);
+  CHECK_EQ(c.wday, tm.tm_wday);
+  CHECK_EQ(c.yday, tm.tm_yday);
+
+  CHECK_EQ(calendar_to_ts(c.year, c.month, c.day, c.hour, c.minute, c.second), ts);
+  CHECK_EQ(calendar_days_from_civil(c.year, c.month, c.day), ts / 86400);
+}
+
+static void test_from_ts_matches_gmtime(void)
+{
+  static const uint32_t EDGES[] = {0, 59, 86399, 86400, 951782400 /* 2000-02-29 */, 4107542399u /* 2100-02-28 23:59:59 */,
+                                   4107542400u, UINT32_MAX - 1, UINT32_MAX};
+  for (size_t i = 0; i < sizeof(EDGES) / sizeof(EDGES[0]); i++)
+    check_from_ts(EDGES[i]);
+  for (int i = 0; i < CASES; i++)
+    check_from_ts(rnd());
+}
+
+// Out of range fields carry over like timegm() normalizes them
+static void test_to_ts_carries_like_timegm(void)
+{
+  for (int i = 0; i < CASES; i++)
+  {
+    struct tm tm = {
+        .tm_year = rnd_range(1965, 2110) - 1900,
+        .tm_mon = rnd_range(-30, 30),
+        .tm_mday = rnd_range(-70, 70),
+        .tm_hour = rnd_range(-50, 50),
+        .tm_min = rnd_range(-200, 200),
+        .tm_sec = rnd_range(-200, 200),
+    };
+    uint32_t ts = calendar_to_ts(tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+    int64_t expected = timegm(&tm);
+    if (expected < 0)
+      expected = 0;
+    if (expected > UINT32_MAX)
+      expected = UINT32_MAX;
+    CHECK_EQ(ts, expected);
+  }
+}
+
+static void test_days_in_month(void)
+{
+  for (int32_t year = CALENDAR_YEAR_MIN; year <= CALENDAR_YEAR_MAX; year++)
+  {
+    for (uint8_t month = 1; month <= 12; month++)
+    {
+      int32_t days = calendar_days_from_civil(year, month + 1, 1) - calendar_days_from_civil(year, month, 1);
+      CHECK_EQ(calendar_days_in_month(year, month), days);
+    }
+  }
+}
+
+static void test_adjust_keeps_the_day(void)
+{
+  uint32_t jan31 = calendar_to_ts(2024, 1, 31, 12, 30, 0);
+  calendar_t c;
+  calendar_from_ts(calendar_adjust(jan31, CAL_MONTH, 1), &c);
+  CHECK(c.month == 2 && c.day == 29 && c.hour == 12 && c.minute == 30);
+  calendar_from_ts(calendar_adjust(jan31, CAL_MONTH, -2), &c);
+  CHECK(c.year == 2023 && c.month == 11 && c.day == 30);
+
+  uint32_t leap = calendar_to_ts(2024, 2, 29, 0, 0, 0);
+  calendar_from_ts(calendar_adjust(leap, CAL_YEAR, 1), &c);
+  CHECK(c.year == 2025 && c.month == 2 && c.day == 28);
+  calendar_from_ts(calendar_adjust(leap, CAL_YEAR, 4), &c);
+  CHECK(c.year == 2028 && c.month == 2 && c.day == 29);
+
+  // the smaller fields carry
+  CHECK_EQ(calendar_adjust(calendar_to_ts(2024, 12, 31, 23, 59, 59), CAL_SECOND, 1), calendar_to_ts(2025, 1, 1, 0, 0, 0));
+  CHECK_EQ(calendar_adjust(calendar_to_ts(2024, 3, 1, 0, 0, 0), CAL_DAY, -1), calendar_to_ts(2024, 2, 29, 0, 0, 0));
+}
+
+static void test_adjust_stops_at_the_range_ends(void)
+{
+  CHECK_EQ(calendar_adjust(UINT32_MAX, CAL_YEAR, 1), UINT32_MAX);
+  CHECK_EQ(calendar_adjust(UINT32_MAX, CAL_MONTH, 1), UINT32_MAX);
+  CHECK_EQ(calendar_adjust(UINT32_MAX, CAL_SECOND, 1), UINT32_MAX);
+  CHECK_EQ(calendar_adjust(calendar_to_ts(2105, 6, 1, 0, 0, 0), CAL_YEAR, 1), UINT32_MAX);
+  CHECK_EQ(calendar_adjust(0, CAL_YEAR, -1), 0);
+  CHECK_EQ(calendar_adjust(0, CAL_MINUTE, -1), 0);
+
+  // never against the sign of delta, anywhere in the range
+  for (int i = 0; i < CASES; i++)
+  {
+    uint32_t ts = rnd();
+    calendar_field_t field = rnd() % CAL__COUNT;
+    int32_t delta = rnd_range(-200, 200);
+    uint32_t out = calendar_adjust(ts, field, delta);
+    if (delta > 0)
+      CHECK(out >= ts);
+    else if (delta < 0)
+      CHECK(out <= ts);
+    else
+      CHECK_EQ(out, ts);
+  }
+}
+
+int main(void)
+{
+  RUN(test_from_ts_matches_gmtime);
+  RUN(test_to_ts_carries_like_timegm);
+  RUN(test_days_in_month);
+  RUN(test_adjust_keeps_the_day);
+  RUN(test_adjust_stops_at_the_range_ends);
+  return 0;
+}
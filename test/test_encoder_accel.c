@@ -0,0 +1,148 @@
+/*
+ * Encoder count decoding and acceleration (encoder_accel.c) on simulated time.
+ */
+#include <stdlib.h>
+#include "encoder_accel.h"
+#include "test.h"
+
+#define T0 1000 // last_ms 0 means no detent yet
+
+static void test_decode_carries_the_remainder(void)
+{
+  encoder_accel_t enc;
+  encoder_accel_reset(&enc);
+  CHECK_EQ(encoder_decode(&enc, 3, 4), 0);
+  CHECK_EQ(encoder_decode(&enc, 1, 4), 1);
+  CHECK_EQ(enc.remainder, 0);
+  CHECK_EQ(encoder_decode(&enc, 9, 4), 2);
+  CHECK_EQ(enc.remainder, 1);
+
+  // backwards, not a multiple of the detent
+  encoder_accel_reset(&enc);
+  CHECK_EQ(encoder_decode(&enc, -7, 4), -1);
+  CHECK_EQ(enc.remainder, -3);
+  CHECK_EQ(encoder_decode(&enc, -1, 4), -1);
+  CHECK_EQ(enc.remainder, 0);
+
+  // a half turned detent taken back gives nothing either way
+  CHECK_EQ(encoder_decode(&enc, 3, 4), 0);
+  CHECK_EQ(encoder_decode(&enc, -5, 4), 0);
+  CHECK_EQ(enc.remainder, -2);
+  CHECK_EQ(encoder_decode(&enc, -2, 4), -1);
+  CHECK_EQ(enc.remainder, 0);
+
+  // 0 counts per detent taken as 1
+  CHECK_EQ(encoder_decode(&enc, -3, 0), -3);
+}
+
+// No count is lost or made up, whatever the deltas
+static void test_decode_keeps_every_count(void)
+{
+  srand(1);
+  for (uint8_t cpd = 1; cpd <= 4; cpd++)
+  {
+    encoder_accel_t enc;
+    encoder_accel_reset(&enc);
+    int32_t counts = 0, detents = 0;
+    for (int i = 0; i < 10000; i++)
+    {
+      int32_t delta = rand() % 21 - 10;
+      counts += delta;
+      detents += encoder_decode(&enc, delta, cpd);
+      CHECK(abs(enc.remainder) < cpd);
+      CHECK_EQ(detents * cpd + enc.remainder, counts);
+    }
+  }
+}
+
+static void test_factor_thresholds(void)
+{
+  static const struct
+  {
+    uint16_t rate;
+    uint8_t factor;
+  } CASES[] = {
+      {0, 1}, {9, 1}, {10, 2}, {19, 2}, {20, 5}, {39, 5}, {40, 10}, {UINT16_MAX, 10},
+  };
+  for (size_t i = 0; i < sizeof(CASES) / sizeof(CASES[0]); i++)
+    CHECK_EQ(encoder_accel_factor(CASES[i].rate), CASES[i].factor);
+}
+
+// One detent every period_ms for a while, the steps of the last one
+static int32_t turn_steadily(encoder_accel_t *enc, uint32_t *now, uint32_t period_ms, int count, int8_t dir)
+{
+  int32_t steps = 0;
+  for (int i = 0; i < count; i++)
+  {
+    *now += period_ms;
+    steps = encoder_accelerate(enc, dir, *now);
+  }
+  return steps;
+}
+
+static void test_accelerate_by_speed(void)
+{
+  encoder_accel_t enc;
+  uint32_t now = T0;
+
+  // the first detent is always a single step
+  encoder_accel_reset(&enc);
+  CHECK_EQ(encoder_accelerate(&enc, 1, now), 1);
+  CHECK_EQ(encoder_accelerate(&enc, 0, now + 10), 0);
+
+  encoder_accel_reset(&enc);
+  CHECK_EQ(turn_steadily(&enc, &now, 200, 30, 1), 1); // 5/s
+  encoder_accel_reset(&enc);
+  CHECK_EQ(turn_steadily(&enc, &now, 1000 / 15, 30, 1), 2); // 15/s
+  encoder_accel_reset(&enc);
+  CHECK_EQ(turn_steadily(&enc, &now, 1000 / 30, 30, -1), -5); // 30/s
+  encoder_accel_reset(&enc);
+  CHECK_EQ(turn_steadily(&enc, &now, 10, 30, 1), 10); // 100/s
+
+  // several detents in one poll count as the speed they were turned at
+  encoder_accel_reset(&enc);
+  CHECK_EQ(encoder_accelerate(&enc, 1, now), 1);
+  for (int i = 0; i < 10; i++)
+  {
+    now += 50;
+    encoder_accelerate(&enc, 5, now); // 100/s
+  }
+  CHECK_EQ(encoder_accelerate(&enc, 5, now + 50), 50);
+}
+
+static void test_reverse_and_pause_reset(void)
+{
+  encoder_accel_t enc;
+  uint32_t now = T0;
+  encoder_accel_reset(&enc);
+  CHECK_EQ(turn_steadily(&enc, &now, 10, 30, 1), 10);
+
+  // a correction the other way is precise, and so is the one after it
+  now += 10;
+  CHECK_EQ(encoder_accelerate(&enc, -1, now), -1);
+  CHECK_EQ(enc.rate, 0);
+  now += 10;
+  CHECK_EQ(encoder_accelerate(&enc, 1, now), 1);
+
+  // fast again, then a pause
+  CHECK_EQ(turn_steadily(&enc, &now, 10, 30, 1), 10);
+  now += ENCODER_ACCEL_IDLE_MS;
+  CHECK_EQ(encoder_accelerate(&enc, 1, now), 1);
+  CHECK_EQ(enc.rate, 0);
+
+  // just short of the pause the smoothed speed only drops
+  CHECK_EQ(turn_steadily(&enc, &now, 10, 30, 1), 10);
+  now += ENCODER_ACCEL_IDLE_MS - 1;
+  CHECK_EQ(encoder_accelerate(&enc, 1, now), 10);
+  CHECK(enc.rate < 97);
+}
+
+int main(void)
+{
+  RUN(test_decode_carries_the_remainder);
+  RUN(test_decode_keeps_every_count);
+  RUN(test_factor_thresholds);
+  RUN(test_accelerate_by_speed);
+  RUN(test_reverse_and_pause_reset);
+  return 0;
+}
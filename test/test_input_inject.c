@@ -0,0 +1,349 @@
+/*
+ * Scripted input through the real button scan (button_driver.c): the script player and the
+ * button state machines run on simulated time, the scan every CONFIG_BUTTON_SCAN_PERIOD_MS.
+ * The chord tests hand the events to the real state machine (state_machine.c) with a mock
+ * menu and editor.
+ */
+#include <stddef.h>
+
+size_t strlcpy(char *dst, const char *src, size_t size);
+size_t strlcat(char *dst, const char *src, size_t size);
+
+#include "../main/input_inject.c"
+#include "driver/gpio.h"
+#include "event_handler.h"
+#include "menu/menu.h"
+#include "state_machine.h"
+#include "test.h"
+
+// -----------------
+// Simulated time and event loop
+// -----------------
+
+typedef struct
+{
+  int32_t id;
+  uint8_t data; // button, or held mask of a chord
+  uint32_t ms;
+} posted_t;
+
+static int64_t now_us = 0;
+static posted_t posted[64];
+static int posted_count = 0;
+static bool frame_pending = false;
+static esp_timer_cb_t scan_callback = NULL;
+static esp_event_handler_t state_handler = NULL; // set: events go to the state machine
+
+ESP_EVENT_DEFINE_BASE(CUSTOM_EVENTS);
+
+int64_t esp_timer_get_time(void)
+{
+  return now_us;
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+  return (TickType_t)(now_us / 1000);
+}
+
+// Stands in for the state machine and the LCD task: dispatch and state change right away,
+// the frame is sent one scan period later
+void events_post(int32_t event_id, const void *event_data, size_t event_data_size)
+{
+  if (event_id == EVENT_LCD_UPDATE)
+    return;
+  CHECK(posted_count < 64);
+  posted[posted_count++] = (posted_t){event_id, *(const uint8_t *)event_data, (uint32_t)(now_us / 1000)};
+  if (state_handler)
+  {
+    state_handler(NULL, CUSTOM_EVENTS, event_id, (void *)event_data);
+    return;
+  }
+  input_latency_mark(INPUT_LAT_DISPATCH);
+  input_latency_mark(INPUT_LAT_STATE);
+  frame_pending = true;
+}
+
+void events_subscribe(int32_t event_id, esp_event_handler_t event_handler, void *event_handler_arg)
+{
+  state_handler = event_handler;
+}
+
+// The scan timer fires on every multiple of the scan period
+void vTaskDelayUntil(TickType_t *wake, TickType_t ticks)
+{
+  int64_t until_us = (*wake + ticks) * 1000LL;
+  while (now_us < until_us)
+  {
+    int64_t next = (now_us / (CONFIG_BUTTON_SCAN_PERIOD_MS * 1000) + 1) * CONFIG_BUTTON_SCAN_PERIOD_MS * 1000;
+    now_us = next < until_us ? next : until_us;
+    if (now_us % (CONFIG_BUTTON_SCAN_PERIOD_MS * 1000) == 0)
+    {
+      if (frame_pending)
+        input_latency_mark(INPUT_LAT_FRAME);
+      frame_pending = false;
+      scan_callback(NULL);
+    }
+  }
+  *wake += ticks;
+}
+
+int gpio_get_level(gpio_num_t gpio)
+{
+  return 1; // no button pressed on the GPIOs
+}
+
+size_t strlcpy(char *dst, const char *src, size_t size)
+{
+  snprintf(dst, size, "%s", src);
+  return strlen(src);
+}
+
+size_t strlcat(char *dst, const char *src, size_t size)
+{
+  size_t len = strnlen(dst, size);
+  return len + strlcpy(dst + len, src, size - len);
+}
+
+esp_err_t gpio_config(const gpio_config_t *config) { return ESP_OK; }
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *timer)
+{
+  scan_callback = args->callback;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us) { return ESP_OK; }
+esp_err_t esp_console_cmd_register(const esp_console_cmd_t *cmd) { return ESP_OK; }
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) { return NULL; }
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t wait) { return pdTRUE; }
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t wait) { return pdFALSE; }
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+                                   UBaseType_t prio, TaskHandle_t *handle, BaseType_t core) { return pdPASS; }
+
+// -----------------
+// Menu and editor around the state machine
+// -----------------
+
+static int editor_applied = 0;
+static int editor_cancelled = 0;
+
+static void editor_apply(void) { editor_applied++; }
+static void editor_cancel(void) { editor_cancelled++; }
+
+static const editor_t editor = {.apply = editor_apply, .cancel = editor_cancel};
+
+state_ctx_t state_ctx;
+const editor_t *active_editor = NULL;
+const menu_entry_t *menu_table[] = {NULL};
+
+void enter_state_clock(void) { state_ctx.state = STATE_CLOCK; }
+void enter_state_menu(void) { state_ctx.state = STATE_MENU; }
+void enter_state_edit(void) { state_ctx.state = STATE_EDIT; }
+void enter_state_lcd_test(void) { state_ctx.state = STATE_LCD_TEST; }
+void menu_select(void)
+{
+  active_editor = &editor;
+  enter_state_edit();
+}
+void menu_move_up(void) {}
+void menu_move_down(void) {}
+bool menu_entry_visible(const menu_entry_t *e) { return true; }
+uint8_t get_menu_count(void) { return 0; }
+bool timer_is_running(void) { return true; }
+void lcd_bench_start(void) {}
+
+// -----------------
+// Tests
+// -----------------
+
+static void play(const char *script)
+{
+  char buf[INPUT_SCRIPT_MAX + 1];
+  strlcpy(buf, script, sizeof(buf));
+  CHECK(script_exec(buf, true));
+  // let the last release settle
+  TickType_t wake = xTaskGetTickCount();
+  vTaskDelayUntil(&wake, 100);
+}
+
+static void reset(void)
+{
+  posted_count = 0;
+  input_latency_reset();
+}
+
+static void edit(void)
+{
+  reset();
+  state_ctx.state = STATE_EDIT;
+  active_editor = &editor;
+  editor_applied = 0;
+  editor_cancelled = 0;
+}
+
+static void check_event(int i, int32_t id, uint8_t data, uint32_t ms)
+{
+  CHECK(i < posted_count);
+  CHECK_EQ(posted[i].id, id);
+  CHECK_EQ(posted[i].data, data);
+  CHECK_EQ(posted[i].ms, ms);
+}
+
+static void test_script_syntax(void)
+{
+  static const char *valid[] = {"tap ok", "tap ok 50; wait 200; hold up 1500", "down menu;up menu", " ; tap cancel ;"};
+  static const char *invalid[] = {"tap", "tap nothing", "hold up", "wait", "wait -5", "press ok", "hold ok 0"};
+  char buf[INPUT_SCRIPT_MAX + 1];
+  for (size_t i = 0; i < sizeof(valid) / sizeof(valid[0]); i++)
+  {
+    strlcpy(buf, valid[i], sizeof(buf));
+    CHECK(script_exec(buf, false));
+  }
+  for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++)
+  {
+    strlcpy(buf, invalid[i], sizeof(buf));
+    CHECK(!script_exec(buf, false));
+  }
+}
+
+static void test_tap_takes_the_debounce_path(void)
+{
+  reset();
+  uint32_t t0 = now_us / 1000;
+  play("tap menu 100");
+  CHECK_EQ(posted_count, 2);
+  check_event(0, EVENT_BUTTON_PRESS, BUTTON_MENU, t0 + CONFIG_BUTTON_DEBOUNCE_MS);
+  check_event(1, EVENT_BUTTON_RELEASE, BUTTON_MENU, t0 + 100 + CONFIG_BUTTON_DEBOUNCE_MS);
+  CHECK_EQ(button_get_held_mask(), 0);
+}
+
+// OK and CANCEL post their press when the chord window ends, or on release if that is sooner
+static void test_chord_buttons_wait_for_the_window(void)
+{
+  reset();
+  uint32_t t0 = now_us / 1000;
+  play("tap ok 50");
+  CHECK_EQ(posted_count, 2);
+  check_event(0, EVENT_BUTTON_PRESS, BUTTON_OK, t0 + 50 + CONFIG_BUTTON_DEBOUNCE_MS);
+  check_event(1, EVENT_BUTTON_RELEASE, BUTTON_OK, t0 + 50 + CONFIG_BUTTON_DEBOUNCE_MS);
+
+  reset();
+  t0 = now_us / 1000;
+  uint32_t down = t0 + CONFIG_BUTTON_DEBOUNCE_MS;
+  play("hold cancel 1500");
+  CHECK_EQ(posted_count, 3);
+  check_event(0, EVENT_BUTTON_PRESS, BUTTON_CANCEL, down + CONFIG_BUTTON_CHORD_WINDOW_MS);
+  // the long press still counts from the press itself
+  check_event(1, EVENT_BUTTON_LONG_PRESS, BUTTON_CANCEL, down + CONFIG_BUTTON_LONG_PRESS_MS);
+  check_event(2, EVENT_BUTTON_RELEASE, BUTTON_CANCEL, t0 + 1500 + CONFIG_BUTTON_DEBOUNCE_MS);
+}
+
+static void test_hold_gives_long_press_and_repeats(void)
+{
+  reset();
+  uint32_t t0 = now_us / 1000;
+  uint32_t down = t0 + CONFIG_BUTTON_DEBOUNCE_MS;
+  play("hold up 2100");
+  CHECK_EQ(posted_count, 5);
+  check_event(0, EVENT_BUTTON_PRESS, BUTTON_UP, down);
+  check_event(1, EVENT_BUTTON_LONG_PRESS, BUTTON_UP, down + CONFIG_BUTTON_LONG_PRESS_MS);
+  check_event(2, EVENT_BUTTON_REPEATED_PRESS, BUTTON_UP, down + CONFIG_BUTTON_LONG_PRESS_MS + CONFIG_BUTTON_REPEAT_DELAY_MS);
+  check_event(3, EVENT_BUTTON_REPEATED_PRESS, BUTTON_UP, down + CONFIG_BUTTON_LONG_PRESS_MS + 2 * CONFIG_BUTTON_REPEAT_DELAY_MS);
+  check_event(4, EVENT_BUTTON_RELEASE, BUTTON_UP, t0 + 2100 + CONFIG_BUTTON_DEBOUNCE_MS);
+
+  // no repeat flag: long press only
+  reset();
+  play("hold ok 2100");
+  CHECK_EQ(posted_count, 3);
+  CHECK_EQ(posted[1].id, EVENT_BUTTON_LONG_PRESS);
+  CHECK_EQ(posted[2].id, EVENT_BUTTON_RELEASE);
+}
+
+static void test_held_button_does_not_delay_others(void)
+{
+  reset();
+  uint32_t t0 = now_us / 1000;
+  play("down up; wait 300; tap down 50; up up");
+  CHECK_EQ(posted_count, 5);
+  check_event(0, EVENT_BUTTON_PRESS, BUTTON_UP, t0 + CONFIG_BUTTON_DEBOUNCE_MS);
+  check_event(1, EVENT_BUTTON_PRESS, BUTTON_DOWN, t0 + 300 + CONFIG_BUTTON_DEBOUNCE_MS);
+  check_event(2, EVENT_BUTTON_CHORD, BUTTON_MASK(BUTTON_UP) | BUTTON_MASK(BUTTON_DOWN), t0 + 300 + CONFIG_BUTTON_DEBOUNCE_MS);
+  // released together, seen in the same scan
+  check_event(3, EVENT_BUTTON_RELEASE, BUTTON_UP, t0 + 350 + CONFIG_BUTTON_DEBOUNCE_MS);
+  check_event(4, EVENT_BUTTON_RELEASE, BUTTON_DOWN, t0 + 350 + CONFIG_BUTTON_DEBOUNCE_MS);
+}
+
+// CANCEL + OK inside an editor goes back to the clock and drops the edit, whichever of the
+// two lands first
+static void test_chord_drops_the_edit(void)
+{
+  static const char *scripts[] = {
+      "down cancel; wait 30; tap ok 100; up cancel",
+      "down ok; wait 30; tap cancel 100; up ok",
+      "down ok; down cancel; wait 100; up ok; up cancel",
+  };
+  state_machine_init();
+  for (size_t i = 0; i < sizeof(scripts) / sizeof(scripts[0]); i++)
+  {
+    edit();
+    play(scripts[i]);
+    CHECK_EQ(posted_count, 1);
+    CHECK_EQ(posted[0].id, EVENT_BUTTON_CHORD);
+    CHECK_EQ(editor_applied, 0);
+    CHECK_EQ(editor_cancelled, 1);
+    CHECK_EQ(state_ctx.state, STATE_CLOCK);
+    CHECK(active_editor == NULL);
+  }
+
+  // on its own OK still applies, CANCEL held past the window still cancels
+  edit();
+  play("tap ok");
+  CHECK_EQ(editor_applied, 1);
+  CHECK_EQ(state_ctx.state, STATE_MENU);
+  edit();
+  play("hold cancel 300");
+  CHECK(editor_applied == 0 && editor_cancelled == 1);
+  CHECK_EQ(state_ctx.state, STATE_MENU);
+
+  // a chord with CANCEL held longer: the editor is cancelled first, never applied
+  edit();
+  play("down cancel; wait 300; tap ok 50; up cancel");
+  CHECK(editor_applied == 0 && editor_cancelled == 1);
+  CHECK_EQ(state_ctx.state, STATE_CLOCK);
+  state_handler = NULL;
+}
+
+static void test_latency_stages(void)
+{
+  reset();
+  play("tap menu; wait 200; tap menu; wait 200; tap menu");
+
+  input_latency_stat_t s;
+  input_latency_get(INPUT_LAT_DISPATCH, &s);
+  CHECK_EQ(s.count, 3);
+  CHECK_EQ(s.min_us, CONFIG_BUTTON_DEBOUNCE_MS * 1000);
+  CHECK_EQ(s.max_us, CONFIG_BUTTON_DEBOUNCE_MS * 1000);
+  input_latency_get(INPUT_LAT_STATE, &s);
+  CHECK_EQ(s.count, 3);
+  input_latency_get(INPUT_LAT_FRAME, &s);
+  CHECK_EQ(s.count, 3);
+  CHECK_EQ(s.total_us / s.count, (CONFIG_BUTTON_DEBOUNCE_MS + CONFIG_BUTTON_SCAN_PERIOD_MS) * 1000);
+
+  // the release does not start a measurement
+  CHECK_EQ(probe_start_us, 0);
+}
+
+int main(void)
+{
+  button_init();
+  CHECK(scan_callback != NULL);
+  RUN(test_script_syntax);
+  RUN(test_tap_takes_the_debounce_path);
+  RUN(test_chord_buttons_wait_for_the_window);
+  RUN(test_hold_gives_long_press_and_repeats);
+  RUN(test_held_button_does_not_delay_others);
+  RUN(test_latency_stages);
+  RUN(test_chord_drops_the_edit);
+  return 0;
+}
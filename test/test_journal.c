@@ -0,0 +1,256 @@
+/*
+ * journal.c on a RAM model of NOR flash with power cuts: programs only clear bits, a cut
+ * program leaves part of the record, a cut erase leaves a mix of erased and old bits.
+ * After every cut the journal is mounted again and has to come back with the last
+ * record written or the one in flight, never an older or a damaged one.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "journal.h"
+#include "test.h"
+
+#define SECTOR_SIZE 4096
+#define SECTORS 4
+#define APPENDS 20000
+
+// -----------------
+// NOR flash model
+// -----------------
+
+static struct
+{
+  uint8_t mem[SECTORS * SECTOR_SIZE];
+  uint32_t erases[SECTORS];
+  uint32_t writes;
+  int cut_in;   // flash operations until the power goes, -1: never
+  bool off;     // cut happened, nothing more reaches the flash
+  uint32_t cuts_write;
+  uint32_t cuts_erase;
+  uint32_t cuts_sector_start; // writes cut in the first slot of a sector, erased again
+  char ops[8];                // programs (W) and erases (E) in order, since cleared
+  uint8_t op_count;
+} nor;
+
+static void log_op(char op)
+{
+  if (nor.op_count < sizeof(nor.ops) - 1)
+    nor.ops[nor.op_count++] = op;
+  nor.ops[nor.op_count] = '\0';
+}
+
+static bool cut_now(void)
+{
+  if (nor.off)
+    return true;
+  if (nor.cut_in < 0 || nor.cut_in-- > 0)
+    return false;
+  nor.off = true;
+  return true;
+}
+
+static bool nor_read(void *ctx, uint32_t addr, void *buf, uint32_t len)
+{
+  CHECK(addr + len <= sizeof(nor.mem));
+  memcpy(buf, nor.mem + addr, len);
+  return true;
+}
+
+static bool nor_write(void *ctx, uint32_t addr, const void *buf, uint32_t len)
+{
+  CHECK(addr + len <= sizeof(nor.mem));
+  const uint8_t *src = buf;
+  if (cut_now())
+  {
+    // a prefix made it, then some bits of the rest
+    uint32_t done = rand() % (len + 1);
+    for (uint32_t i = 0; i < len; i++)
+      nor.mem[addr + i] &= i < done ? src[i] : src[i] | (uint8_t)rand();
+    nor.cuts_write++;
+    nor.cuts_sector_start += addr % SECTOR_SIZE == 0;
+    return false;
+  }
+  for (uint32_t i = 0; i < len; i++)
+    nor.mem[addr + i] &= src[i];
+  nor.writes++;
+  log_op('W');
+  return true;
+}
+
+static bool nor_erase(void *ctx, uint32_t addr, uint32_t len)
+{
+  CHECK(addr % SECTOR_SIZE == 0 && len == SECTOR_SIZE && addr + len <= sizeof(nor.mem));
+  // erases are rare next to writes, cut them more often
+  if (nor.cut_in > 0 && rand() % 4 == 0)
+    nor.cut_in = 0;
+  if (cut_now())
+  {
+    for (uint32_t i = 0; i < len; i++)
+      nor.mem[addr + i] = rand() % 2 ? 0xFF : nor.mem[addr + i] | (uint8_t)rand();
+    nor.cuts_erase++;
+    return false;
+  }
+  memset(nor.mem + addr, 0xFF, len);
+  nor.erases[addr / SECTOR_SIZE]++;
+  log_op('E');
+  return true;
+}
+
+static const journal_flash_t FLASH = {
+    .read = nor_read,
+    .write = nor_write,
+    .erase = nor_erase,
+    .ctx = NULL,
+    .size = sizeof(nor.mem),
+    .sector_size = SECTOR_SIZE,
+};
+
+// -----------------
+// Records
+// -----------------
+
+typedef struct
+{
+  uint32_t n;
+  uint8_t fill[36];
+} record_t;
+
+static record_t make_record(uint32_t n)
+{
+  record_t r = {.n = n};
+  for (size_t i = 0; i < sizeof(r.fill); i++)
+    r.fill[i] = (uint8_t)(n * 31 + i);
+  return r;
+}
+
+// The record just confirmed is on the flash as written, in the slot before the next one
+static void check_last_slot(const journal_t *j, const record_t *r)
+{
+  uint32_t slots = FLASH.size / j->stats.slot_size;
+  uint32_t addr = (j->stats.slot + slots - 1) % slots * j->stats.slot_size;
+  uint32_t crc;
+  CHECK(memcmp(nor.mem + addr + JOURNAL_HEADER_SIZE, r, sizeof(*r)) == 0);
+  memcpy(&crc, nor.mem + addr + JOURNAL_HEADER_SIZE + sizeof(*r), 4);
+  CHECK_EQ(crc, journal_crc32(0, nor.mem + addr, JOURNAL_HEADER_SIZE + sizeof(*r)));
+}
+
+static void test_fresh_flash(void)
+{
+  memset(nor.mem, 0xFF, sizeof(nor.mem));
+  nor.cut_in = -1;
+  journal_t j;
+  record_t r;
+  CHECK_EQ(journal_mount(&j, &FLASH, sizeof(r), &r), 0);
+
+  record_t a = make_record(1);
+  CHECK_EQ(journal_append(&j, &a), JOURNAL_WRITTEN);
+  uint32_t writes = nor.writes;
+  CHECK_EQ(journal_append(&j, &a), JOURNAL_UNCHANGED);
+  CHECK_EQ(nor.writes, writes);
+
+  CHECK_EQ(journal_mount(&j, &FLASH, sizeof(r), &r), sizeof(r));
+  CHECK(memcmp(&r, &a, sizeof(r)) == 0);
+  CHECK_EQ(j.stats.seq, 1);
+}
+
+// What the power-fail save needs: the record goes out as one program, the erase of the
+// next sector follows the append that fills a sector
+static void test_append_is_one_program(void)
+{
+  memset(&nor, 0, sizeof(nor));
+  memset(nor.mem, 0x00, sizeof(nor.mem)); // old data everywhere
+  nor.cut_in = -1;
+  journal_t j;
+  record_t r;
+  CHECK_EQ(journal_mount(&j, &FLASH, sizeof(r), &r), 0);
+  CHECK(journal_prepare(&j));
+  CHECK_EQ(nor.erases[0], 1);
+
+  uint32_t slots_per_sector = SECTOR_SIZE / j.stats.slot_size;
+  for (uint32_t n = 1; n <= 3 * SECTORS * slots_per_sector; n++)
+  {
+    nor.op_count = 0;
+    record_t next = make_record(n);
+    CHECK_EQ(journal_append(&j, &next), JOURNAL_WRITTEN);
+    CHECK(strcmp(nor.ops, n % slots_per_sector ? "W" : "WE") == 0);
+  }
+
+  // after a reboot the next slot is found ready as well, nothing is erased twice
+  CHECK_EQ(journal_mount(&j, &FLASH, sizeof(r), &r), sizeof(r));
+  nor.op_count = 0;
+  CHECK(journal_prepare(&j));
+  CHECK_EQ(nor.op_count, 0);
+  record_t next = make_record(0);
+  CHECK_EQ(journal_append(&j, &next), JOURNAL_WRITTEN);
+  CHECK(strcmp(nor.ops, "W") == 0);
+}
+
+static void test_power_cuts(void)
+{
+  memset(&nor, 0, sizeof(nor));
+  memset(nor.mem, 0xFF, sizeof(nor.mem));
+  nor.cut_in = -1;
+  srand(1);
+
+  journal_t j;
+  record_t r;
+  CHECK_EQ(journal_mount(&j, &FLASH, sizeof(r), &r), 0);
+
+  int64_t committed = -1; // last record journal_append() confirmed
+  uint32_t mounts = 0;
+  for (uint32_t n = 0; n < APPENDS; n++)
+  {
+    if (nor.cut_in < 0 && rand() % 20 == 0)
+      nor.cut_in = rand() % 4;
+
+    record_t next = make_record(n);
+    if (journal_append(&j, &next) == JOURNAL_WRITTEN)
+    {
+      check_last_slot(&j, &next);
+      committed = n;
+      continue;
+    }
+    CHECK(nor.off);
+
+    // power back: the last confirmed record or the one in flight
+    nor.off = false;
+    nor.cut_in = -1;
+    mounts++;
+    memset(&r, 0, sizeof(r));
+    uint16_t len = journal_mount(&j, &FLASH, sizeof(r), &r);
+    if (len == 0)
+    {
+      CHECK_EQ(committed, -1);
+      continue;
+    }
+    CHECK_EQ(len, sizeof(r));
+    CHECK(r.n == committed || r.n == n);
+    record_t expected = make_record(r.n);
+    CHECK(memcmp(&r, &expected, sizeof(r)) == 0);
+    committed = r.n;
+  }
+
+  printf("  %u appends, %u cut writes, %u cut erases, %u mounts\n", APPENDS, nor.cuts_write, nor.cuts_erase, mounts);
+  CHECK(nor.cuts_write > 100 && nor.cuts_erase > 10);
+
+  // and once more without a cut
+  CHECK_EQ(journal_mount(&j, &FLASH, sizeof(r), &r), sizeof(r));
+  CHECK_EQ(r.n, committed);
+
+  // the sectors take turns; a sector whose erase or first write was cut is erased again
+  uint32_t min = UINT32_MAX, max = 0;
+  for (int s = 0; s < SECTORS; s++)
+  {
+    min = nor.erases[s] < min ? nor.erases[s] : min;
+    max = nor.erases[s] > max ? nor.erases[s] : max;
+  }
+  CHECK(max - min <= 1 + nor.cuts_erase + nor.cuts_sector_start);
+  CHECK(min > (APPENDS - nor.cuts_write) / (SECTOR_SIZE / j.stats.slot_size) / SECTORS - 1);
+}
+
+int main(void)
+{
+  RUN(test_fresh_flash);
+  RUN(test_append_is_one_program);
+  RUN(test_power_cuts);
+  return 0;
+}
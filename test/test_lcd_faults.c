@@ -0,0 +1,262 @@
+/*
+ * Display I/O errors against a mock I2C bus: retries, going offline, the recovery backoff
+ * and the bus reset being serialised with the other devices on the bus.
+ */
+#include "../main/lcd_driver.c"
+#include "test.h"
+
+// -----------------
+// Mock I2C bus
+// -----------------
+
+static struct
+{
+  int ok_next;        // transfers going through before fail_next applies
+  int fail_next;      // transfers failing from then on, -1: all of them
+  bool absent;        // probes are not answered
+  uint32_t transfers; // transmit calls incl. failed ones
+  uint32_t resets;
+  uint32_t probes;
+  bool locked;          // lcd_bus_lock() held
+  uint32_t resets_unlocked;
+} bus;
+
+static int64_t now_us = 1000000;
+static int mutex_dummy;
+
+esp_err_t i2c_master_transmit(i2c_master_dev_handle_t dev, const uint8_t *data, size_t len, int timeout_ms)
+{
+  bus.transfers++;
+  if (bus.ok_next > 0)
+  {
+    bus.ok_next--;
+    return ESP_OK;
+  }
+  if (bus.fail_next != 0)
+  {
+    if (bus.fail_next > 0)
+      bus.fail_next--;
+    return ESP_ERR_TIMEOUT;
+  }
+  return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_reset(i2c_master_bus_handle_t handle)
+{
+  bus.resets++;
+  if (!bus.locked)
+    bus.resets_unlocked++;
+  return ESP_OK;
+}
+
+esp_err_t i2c_master_probe(i2c_master_bus_handle_t handle, uint16_t address, int timeout_ms)
+{
+  bus.probes++;
+  return bus.absent ? ESP_ERR_NOT_FOUND : ESP_OK;
+}
+
+esp_err_t i2c_new_master_bus(const i2c_master_bus_config_t *config, i2c_master_bus_handle_t *handle)
+{
+  *handle = NULL;
+  return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_add_device(i2c_master_bus_handle_t handle, const i2c_device_config_t *config,
+                                    i2c_master_dev_handle_t *dev)
+{
+  *dev = NULL;
+  return ESP_OK;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+  return &mutex_dummy;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t wait)
+{
+  CHECK(!bus.locked);
+  bus.locked = true;
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+  CHECK(bus.locked);
+  bus.locked = false;
+  return pdTRUE;
+}
+
+int64_t esp_timer_get_time(void)
+{
+  return now_us;
+}
+
+void ets_delay_us(uint32_t us)
+{
+  now_us += us;
+}
+
+uint32_t esp_random(void)
+{
+  return 0;
+}
+
+// -----------------
+// Rest of the firmware, not used by the paths under test
+// -----------------
+
+esp_event_base_t const CUSTOM_EVENTS = "CUSTOM_EVENTS";
+state_ctx_t state_ctx;
+volatile uint32_t unix_ts;
+
+void events_subscribe(int32_t event_id, esp_event_handler_t event_handler, void *event_handler_arg) {}
+void input_latency_mark(input_latency_stage_t stage) {}
+void lcd_mirror_init(void) {}
+void lcd_mirror_frame(const char *cells, uint8_t cols, uint8_t rows) {}
+void lcd_mirror_get_stats(lcd_mirror_stats_t *out) {}
+void lcd_widget_set_text(lcd_widget_t *w, const char *text) {}
+void lcd_widget_set_time(lcd_widget_t *w, uint32_t ts) {}
+void lcd_widget_set_number(lcd_widget_t *w, int32_t value) {}
+void lcd_widget_set_list(lcd_widget_t *w, int8_t selected, int8_t top, int8_t count) {}
+void lcd_widget_invalidate(lcd_widget_t *w) {}
+void lcd_widget_draw(lcd_widget_t *w) {}
+void format_datetime_lcd(time_t ts, char *out, size_t out_sz) {}
+uint32_t timer_get_timescale(void) { return 1; }
+bool timer_is_running(void) { return false; }
+edit_mode_t get_edit_mode(void) { return 0; }
+int8_t get_menu_selected(void) { return 0; }
+int8_t get_menu_scroll_top(void) { return 0; }
+uint32_t get_edit_timescale(void) { return 0; }
+uint32_t get_edit_timestamp(void) { return 0; }
+int8_t get_edit_cursor(void) { return 0; }
+const menu_entry_t *get_menu_item(int idx) { return NULL; }
+uint8_t get_menu_count(void) { return 0; }
+int get_lcd_test_iterator(void) { return 0; }
+int get_lcd_test_page(void) { return 0; }
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+                                   UBaseType_t prio, TaskHandle_t *handle, BaseType_t core) { return pdPASS; }
+void vTaskDelay(TickType_t ticks) {}
+TaskHandle_t xTaskGetCurrentTaskHandle(void) { return NULL; }
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait) { return 0; }
+BaseType_t xTaskNotifyGive(TaskHandle_t task) { return pdPASS; }
+
+// -----------------
+// Tests
+// -----------------
+
+static lcd_display_t *disp = &lcd_displays[0];
+static const uint8_t BYTE = 0x08;
+
+static void reset(void)
+{
+  memset(&bus, 0, sizeof(bus));
+  i2c_initialize();
+  memset(&disp->stats, 0, sizeof(disp->stats));
+  disp->retry_at_us = 0;
+  disp->backoff_ms = 0;
+  CHECK(disp->present && disp->online);
+}
+
+static void test_transient_error_is_retried(void)
+{
+  reset();
+  bus.fail_next = LCD_IO_RETRIES;
+  CHECK_EQ(lcd_transmit(disp, &BYTE, 1), ESP_OK);
+  CHECK(disp->online);
+  CHECK_EQ(disp->stats.errors, LCD_IO_RETRIES);
+  CHECK_EQ(disp->stats.retries, LCD_IO_RETRIES);
+  CHECK_EQ(bus.transfers, LCD_IO_RETRIES + 1);
+}
+
+static void test_persistent_error_takes_display_offline(void)
+{
+  reset();
+  bus.fail_next = -1;
+  CHECK(lcd_transmit(disp, &BYTE, 1) != ESP_OK);
+  CHECK(!disp->online);
+  CHECK_EQ(bus.transfers, LCD_IO_RETRIES + 1);
+
+  // offline writes do not reach the bus
+  CHECK_EQ(lcd_transmit(disp, &BYTE, 1), ESP_ERR_INVALID_STATE);
+  CHECK_EQ(lcd_init_cycle(disp), ESP_ERR_INVALID_STATE);
+  CHECK_EQ(bus.transfers, LCD_IO_RETRIES + 1);
+}
+
+static void test_recovery_backs_off_and_comes_back(void)
+{
+  reset();
+  bus.fail_next = -1;
+  bus.absent = true;
+  lcd_transmit(disp, &BYTE, 1);
+
+  // the first call only starts the outage
+  lcd_recover(disp);
+  CHECK_EQ(disp->stats.outages, 1);
+  CHECK_EQ(bus.resets, 0);
+
+  uint32_t expected_ms = LCD_RECOVERY_BACKOFF_MIN_MS;
+  for (int attempt = 0; attempt < 10; attempt++)
+  {
+    now_us += expected_ms * 1000LL - 1;
+    lcd_recover(disp);
+    CHECK_EQ(bus.resets, attempt); // not due yet
+
+    now_us += 1;
+    lcd_recover(disp);
+    CHECK_EQ(bus.resets, attempt + 1);
+    CHECK(!disp->online);
+    expected_ms = expected_ms * 2 > LCD_RECOVERY_BACKOFF_MAX_MS ? LCD_RECOVERY_BACKOFF_MAX_MS : expected_ms * 2;
+    CHECK_EQ(disp->backoff_ms, expected_ms);
+  }
+  CHECK_EQ(disp->backoff_ms, LCD_RECOVERY_BACKOFF_MAX_MS);
+  CHECK_EQ(disp->stats.outages, 1);
+  CHECK_EQ(disp->stats.recoveries, 0);
+
+  // back on the bus: re-init clears what the screen showed, the next frame redraws it
+  bus.absent = false;
+  bus.fail_next = 0;
+  disp->buffer[LCD_BUFFER_SHOWN][0] = 'X';
+  now_us += expected_ms * 1000LL;
+  lcd_recover(disp);
+  CHECK(disp->online);
+  CHECK_EQ(disp->retry_at_us, 0);
+  CHECK_EQ(disp->stats.recoveries, 1);
+  CHECK_EQ(disp->buffer[LCD_BUFFER_SHOWN][0], ' ');
+  CHECK_EQ(bus.resets_unlocked, 0);
+}
+
+static void test_failed_reinit_keeps_display_offline(void)
+{
+  reset();
+  bus.fail_next = -1;
+  lcd_transmit(disp, &BYTE, 1);
+  lcd_recover(disp);
+
+  // answers the probe, but the init sequence fails halfway
+  bus.ok_next = 2;
+  bus.fail_next = LCD_IO_RETRIES + 1;
+  bus.transfers = 0;
+  now_us += LCD_RECOVERY_BACKOFF_MIN_MS * 1000LL;
+  lcd_recover(disp);
+  CHECK(!disp->online);
+  CHECK_EQ(disp->stats.recoveries, 0);
+  CHECK_EQ(disp->backoff_ms, LCD_RECOVERY_BACKOFF_MIN_MS * 2);
+  CHECK(bus.transfers > LCD_IO_RETRIES + 1); // got past the first command
+  CHECK(!bus.locked);
+
+  now_us += disp->backoff_ms * 1000LL;
+  lcd_recover(disp);
+  CHECK(disp->online);
+  CHECK_EQ(disp->stats.recoveries, 1);
+  CHECK_EQ(disp->stats.outages, 1);
+}
+
+int main(void)
+{
+  RUN(test_transient_error_is_retried);
+  RUN(test_persistent_error_takes_display_offline);
+  RUN(test_recovery_backs_off_and_comes_back);
+  RUN(test_failed_reinit_keeps_display_offline);
+  return 0;
+}
@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+"""Round trip of the LCD mirror: lcd_mirror.c writes to one end of a pty, the decoder of
+tools/lcd_mirror_decode.py reads the other one.
+
+    test_lcd_mirror.py <lcd_mirror_stream binary>
+"""
+import os
+import pty
+import select
+import subprocess
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "tools"))
+from lcd_mirror_decode import Decoder  # noqa: E402
+
+CORRUPT_EVERY = 20  # keyframes come at least every 10 packets
+
+
+class RecordingDecoder(Decoder):
+    """Keeps the screen after every packet that changed it, by sequence number."""
+
+    def __init__(self):
+        super().__init__()
+        self.shown = {}
+
+    def apply(self, ptype, payload):
+        changed = super().apply(ptype, payload)
+        if changed:
+            self.shown[self.seq] = bytes(self.cells).hex()
+        return changed
+
+
+def round_trip(stream, *args):
+    master, slave = pty.openpty()
+    with tempfile.NamedTemporaryFile("r", suffix=".txt") as expected_file:
+        proc = subprocess.Popen([stream, os.ttyname(slave), expected_file.name, *map(str, args)])
+        dec = RecordingDecoder()
+        # the slave stays open here, the writer opens it by name; read until it is done and drained
+        while proc.poll() is None or select.select([master], [], [], 0)[0]:
+            if select.select([master], [], [], 0.1)[0]:
+                dec.feed(os.read(master, 4096))
+        os.close(slave)
+        os.close(master)
+        if proc.returncode != 0:
+            sys.exit("stream writer failed")
+        expected = dict(line.split() for line in expected_file)
+    return dec, {int(seq): cells for seq, cells in expected.items()}
+
+
+def check(cond, msg):
+    if not cond:
+        sys.exit("check failed: " + msg)
+
+
+def main():
+    stream = sys.argv[1]
+
+    dec, expected = round_trip(stream)
+    print("clean:", dec.stats)
+    check(dec.shown == expected, "decoded frames differ from the sent ones")
+    check(dec.stats["crc_errors"] == 0 and dec.stats["lost"] == 0, "errors on a clean stream")
+    check(dec.stats["keyframes"] > 1 and dec.stats["deltas"] > dec.stats["keyframes"], "no mix of frame types")
+    check(dec.cols == 20 and dec.rows == 4, "wrong geometry")
+
+    # a damaged packet is dropped, the deltas after it wait for the next keyframe
+    dec, expected = round_trip(stream, CORRUPT_EVERY)
+    print("corrupt:", dec.stats)
+    damaged = [seq for seq in expected if seq % CORRUPT_EVERY == CORRUPT_EVERY - 1]
+    check(dec.stats["crc_errors"] == len(damaged), "damaged packets not rejected")
+    # the gap shows with the next packet
+    check(dec.stats["lost"] == len([seq for seq in damaged if seq + 1 in expected]), "lost packets not noticed")
+    check(all(dec.shown[seq] == expected[seq] for seq in dec.shown), "showed a wrong frame")
+    check(not any(seq in dec.shown for seq in damaged), "showed a damaged frame")
+    for seq in damaged:
+        check(any(s in dec.shown for s in range(seq + 1, seq + CORRUPT_EVERY) if s in expected) or seq + 1 not in expected,
+              "did not resynchronize after packet %d" % seq)
+
+
+if __name__ == "__main__":
+    main()
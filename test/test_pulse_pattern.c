@@ -0,0 +1,193 @@
+/*
+ * Pulse patterns compiled into level sequences, as the pulse engine plays them.
+ */
+#include "pulse_pattern.h"
+#include "test.h"
+
+static uint32_t seq_us(const pulse_seq_t *seq)
+{
+  uint32_t us = 0;
+  for (uint8_t i = 0; i < seq->count; i++)
+    us += seq->steps[i].duration_us;
+  return us;
+}
+
+static void check_impulses(const pulse_seq_t *seq, uint8_t count, uint32_t pulse_ms, uint32_t gap_ms)
+{
+  CHECK_EQ(seq->count, count * 2);
+  for (uint8_t i = 0; i < seq->count; i += 2)
+  {
+    CHECK_EQ(seq->steps[i].level, 1);
+    CHECK_EQ(seq->steps[i].duration_us, pulse_ms * 1000);
+    CHECK_EQ(seq->steps[i + 1].level, 0);
+    CHECK_EQ(seq->steps[i + 1].duration_us, gap_ms * 1000);
+  }
+}
+
+static void test_every_pattern_ends_with_its_gap(void)
+{
+  pulse_seq_t seq;
+  pulse_pattern_t p = {.type = PULSE_PATTERN_MINUTE, .pulse_ms = 800, .gap_ms = 200, .count = 1};
+  for (uint8_t count = 1; count <= 10; count++)
+  {
+    p.count = count;
+    CHECK(pulse_pattern_compile(&p, &seq));
+    check_impulses(&seq, count, p.pulse_ms, p.gap_ms);
+    CHECK_EQ(seq_us(&seq), pulse_pattern_step_ms(&p) * 1000);
+  }
+
+  p = (pulse_pattern_t){.type = PULSE_PATTERN_SECOND, .pulse_ms = 100, .gap_ms = 200, .count = 3};
+  CHECK(pulse_pattern_compile(&p, &seq));
+  check_impulses(&seq, 1, 100, 200);
+  CHECK_EQ(seq_us(&seq), pulse_pattern_step_ms(&p) * 1000);
+
+  p = (pulse_pattern_t){.type = PULSE_PATTERN_HOUR_STRIKE, .pulse_ms = 200, .gap_ms = 800};
+  CHECK(pulse_pattern_compile(&p, &seq));
+  check_impulses(&seq, 1, 200, 800);
+}
+
+static void test_seq_add_merges_levels(void)
+{
+  pulse_seq_t seq = {0};
+  CHECK(pulse_seq_add(&seq, 0, 0));
+  CHECK_EQ(seq.count, 0);
+  CHECK(pulse_seq_add(&seq, 1, 10));
+  CHECK(pulse_seq_add(&seq, 1, 5));
+  CHECK(pulse_seq_add(&seq, 0, 7));
+  CHECK_EQ(seq.count, 2);
+  CHECK_EQ(seq.steps[0].duration_us, 15);
+
+  while (seq.count < PULSE_STEPS_MAX)
+    CHECK(pulse_seq_add(&seq, !seq.steps[seq.count - 1].level, 1));
+  uint8_t last = seq.steps[PULSE_STEPS_MAX - 1].level;
+  CHECK(!pulse_seq_add(&seq, !last, 1));
+  CHECK(pulse_seq_add(&seq, last, 1)); // merges, fits
+}
+
+// -----------------
+// RMT symbols
+// -----------------
+
+typedef struct
+{
+  uint16_t duration;
+  uint8_t level;
+} half_t;
+
+static size_t unpack(const uint32_t *words, size_t count, half_t *halves)
+{
+  for (size_t i = 0; i < count; i++)
+  {
+    halves[i * 2] = (half_t){words[i] & 0x7FFF, words[i] >> 15 & 1};
+    halves[i * 2 + 1] = (half_t){words[i] >> 16 & 0x7FFF, words[i] >> 31};
+  }
+  return count * 2;
+}
+
+// The symbols play the sequence: same levels for the same time, no zero duration half
+// (it would end the transmission)
+static void check_symbols(const pulse_seq_t *seq, const uint32_t *words, size_t count)
+{
+  half_t halves[PULSE_SYMBOLS_MAX * 2];
+  size_t n = unpack(words, count, halves);
+  size_t h = 0;
+  for (uint8_t i = 0; i < seq->count; i++)
+  {
+    uint64_t ticks = (uint64_t)seq->steps[i].duration_us * PULSE_TICK_HZ / 1000000;
+    while (ticks > 0)
+    {
+      CHECK(h < n);
+      CHECK_EQ(halves[h].level, seq->steps[i].level);
+      CHECK(halves[h].duration > 0 && halves[h].duration <= ticks);
+      ticks -= halves[h].duration;
+      h++;
+    }
+  }
+  CHECK_EQ(h, n);
+}
+
+static void test_symbols_of_the_patterns(void)
+{
+  static const pulse_pattern_t PATTERNS[] = {
+      {.type = PULSE_PATTERN_MINUTE, .pulse_ms = 800, .gap_ms = 200, .count = 1},
+      {.type = PULSE_PATTERN_MINUTE, .pulse_ms = 100, .gap_ms = 50, .count = 10},
+      {.type = PULSE_PATTERN_SECOND, .pulse_ms = 100, .gap_ms = 200},
+      {.type = PULSE_PATTERN_SECOND, .pulse_ms = 5, .gap_ms = 10},
+      {.type = PULSE_PATTERN_HOUR_STRIKE, .pulse_ms = 200, .gap_ms = 800},
+  };
+  for (size_t k = 0; k < sizeof(PATTERNS) / sizeof(PATTERNS[0]); k++)
+  {
+    pulse_seq_t seq;
+    uint32_t words[PULSE_SYMBOLS_MAX];
+    CHECK(pulse_pattern_compile(&PATTERNS[k], &seq));
+    size_t count = pulse_seq_to_symbols(&seq, words, PULSE_SYMBOLS_MAX);
+    CHECK(count > 0);
+    check_symbols(&seq, words, count);
+
+    // the last half is the gap: the line is low when the run ends
+    CHECK_EQ(words[count - 1] >> 31, 0);
+  }
+}
+
+static void test_symbols_split_long_levels(void)
+{
+  uint32_t words[PULSE_SYMBOLS_MAX];
+  half_t halves[PULSE_SYMBOLS_MAX * 2];
+
+  // exactly two halves
+  pulse_seq_t seq = {0};
+  pulse_seq_add(&seq, 1, PULSE_HALF_MAX);
+  pulse_seq_add(&seq, 0, PULSE_HALF_MAX);
+  CHECK_EQ(pulse_seq_to_symbols(&seq, words, PULSE_SYMBOLS_MAX), 1);
+  check_symbols(&seq, words, 1);
+
+  // odd number of halves: the longest one is split once more
+  seq = (pulse_seq_t){0};
+  pulse_seq_add(&seq, 1, 100000); // 4 halves
+  pulse_seq_add(&seq, 0, 1000);
+  size_t count = pulse_seq_to_symbols(&seq, words, PULSE_SYMBOLS_MAX);
+  CHECK_EQ(count, 3);
+  check_symbols(&seq, words, count);
+  unpack(words, count, halves);
+  CHECK_EQ(halves[0].duration + halves[1].duration, PULSE_HALF_MAX);
+
+  // a single level
+  seq = (pulse_seq_t){0};
+  pulse_seq_add(&seq, 1, 10);
+  CHECK_EQ(pulse_seq_to_symbols(&seq, words, PULSE_SYMBOLS_MAX), 1);
+  check_symbols(&seq, words, 1);
+  unpack(words, 1, halves);
+  CHECK(halves[0].duration == 5 && halves[1].duration == 5);
+
+  // one tick cannot be split
+  seq = (pulse_seq_t){0};
+  pulse_seq_add(&seq, 1, 1);
+  CHECK_EQ(pulse_seq_to_symbols(&seq, words, PULSE_SYMBOLS_MAX), 0);
+}
+
+static void test_symbols_that_do_not_fit(void)
+{
+  uint32_t words[PULSE_SYMBOLS_MAX];
+  pulse_seq_t seq = {0};
+  pulse_seq_add(&seq, 1, 10);
+  pulse_seq_add(&seq, 0, 10);
+  pulse_seq_add(&seq, 1, 10);
+  pulse_seq_add(&seq, 0, 10);
+  CHECK_EQ(pulse_seq_to_symbols(&seq, words, 1), 0);
+  CHECK_EQ(pulse_seq_to_symbols(&seq, words, 2), 2);
+
+  // refused rather than cut short
+  pulse_pattern_t p = {.type = PULSE_PATTERN_MINUTE, .pulse_ms = 800, .gap_ms = 200, .count = 10};
+  CHECK(pulse_pattern_compile(&p, &seq));
+  CHECK_EQ(pulse_seq_to_symbols(&seq, words, PULSE_SYMBOLS_MAX), 0);
+}
+
+int main(void)
+{
+  RUN(test_every_pattern_ends_with_its_gap);
+  RUN(test_seq_add_merges_levels);
+  RUN(test_symbols_of_the_patterns);
+  RUN(test_symbols_split_long_levels);
+  RUN(test_symbols_that_do_not_fit);
+  return 0;
+}
@@ -0,0 +1,162 @@
+#!/usr/bin/env python3
+"""Decode the session history log of main/history.c.
+
+    history_decode.py capture.txt            # console output of 'history export'
+    history_decode.py history.bin            # parttool.py read_partition --partition-name history
+    history_decode.py capture.txt --csv      # one CSV row per entry
+
+Prints every entry with its real and model time, then a summary per boot: how long the
+clock ran, in real and in model time, and the pulses sent per channel.
+"""
+import argparse
+import csv
+import re
+import struct
+import sys
+import zlib
+from datetime import datetime, timezone
+
+MAGIC = 0x4C48434D  # "MCHL"
+VERSION = 1
+SECTOR = struct.Struct("<IHHII")
+ENTRY = struct.Struct("<IIIBBH")
+LINE = re.compile(r"^H ([0-9a-f]{32})\s*$")
+
+BOOT, RUN, PAUSE, SCALE, TIME_SET, PULSES, PULSES_MISSED, OVERFLOW = range(1, 9)
+NAMES = {BOOT: "boot", RUN: "run", PAUSE: "pause", SCALE: "scale", TIME_SET: "time set",
+         PULSES: "pulses", PULSES_MISSED: "pulses missed", OVERFLOW: "overflow"}
+RESET_REASONS = ["unknown", "power on", "reset pin", "software", "panic", "interrupt watchdog",
+                 "task watchdog", "watchdog", "deep sleep", "brownout", "sdio", "usb", "jtag",
+                 "efuse", "power glitch", "cpu lockup"]
+
+
+def ts(t):
+    return datetime.fromtimestamp(t, timezone.utc).strftime("%Y-%m-%d %H:%M:%S")
+
+
+def check(raw):
+    return zlib.crc32(raw[:ENTRY.size - 2]) & 0xFFFF
+
+
+def entries_from_capture(text):
+    for line in text.splitlines():
+        m = LINE.match(line.strip())
+        if m:
+            yield bytes.fromhex(m.group(1))
+
+
+def entries_from_image(data, sector_size):
+    """Sectors in write order, each up to its first blank entry."""
+    sectors = []
+    for off in range(0, len(data) - SECTOR.size + 1, sector_size):
+        magic, version, entry_size, seq, _ = SECTOR.unpack_from(data, off)
+        if magic == MAGIC and version == VERSION and entry_size == ENTRY.size:
+            sectors.append((seq, off))
+    for _, off in sorted(sectors):
+        for pos in range(off + SECTOR.size, off + sector_size - ENTRY.size + 1, ENTRY.size):
+            raw = data[pos:pos + ENTRY.size]
+            if raw == b"\xff" * ENTRY.size:
+                break
+            yield raw
+
+
+def describe(kind, arg, value, model_ts):
+    if kind == BOOT:
+        return RESET_REASONS[value] if value < len(RESET_REASONS) else f"reset reason {value}"
+    if kind == SCALE:
+        return f"1:{value}"
+    if kind == TIME_SET:
+        return f"{ts(value)} -> {ts(model_ts)}" if value else f"restored {ts(model_ts)}"
+    if kind in (PULSES, PULSES_MISSED):
+        return f"channel {arg}: {value}"
+    if kind == OVERFLOW:
+        return f"{value} entries lost"
+    return ""
+
+
+class Session:
+    def __init__(self, entry):
+        self.start = entry
+        self.run_real = 0
+        self.run_model = 0
+        self.running_since = None
+        self.pulses = {}
+        self.missed = {}
+
+    def stop(self, real, model):
+        if self.running_since:
+            self.run_real += real - self.running_since[0]
+            self.run_model += model - self.running_since[1]
+            self.running_since = None
+
+    def report(self):
+        reason = describe(BOOT, 0, self.start[4], 0)
+        print(f"boot {ts(self.start[0])} ({reason}): ran {self.run_real} s real, {self.run_model} s model")
+        for ch in sorted(set(self.pulses) | set(self.missed)):
+            print(f"  channel {ch}: {self.pulses.get(ch, 0)} pulses, {self.missed.get(ch, 0)} missed")
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("input", help="console capture or partition image, - for stdin")
+    ap.add_argument("--csv", action="store_true", help="CSV rows instead of text, no summary")
+    ap.add_argument("--sector-size", type=lambda s: int(s, 0), default=4096)
+    args = ap.parse_args()
+
+    data = sys.stdin.buffer.read() if args.input == "-" else open(args.input, "rb").read()
+    if len(data) >= SECTOR.size and any(
+            SECTOR.unpack_from(data, off)[0] == MAGIC for off in range(0, len(data) - SECTOR.size + 1, args.sector_size)):
+        raws = entries_from_image(data, args.sector_size)
+    else:
+        raws = entries_from_capture(data.decode(errors="replace"))
+
+    writer = csv.writer(sys.stdout) if args.csv else None
+    if writer:
+        writer.writerow(["real", "model", "event", "arg", "value"])
+    sessions = []
+    torn = 0
+    prev = last = None
+    for raw in raws:
+        real, model, value, kind, arg, crc = ENTRY.unpack(raw)
+        if crc != check(raw):
+            torn += 1
+            continue
+        entry = (real, model, kind, arg, value)
+        prev, last = last, entry
+        name = NAMES.get(kind, f"type {kind}")
+        if writer:
+            writer.writerow([ts(real), ts(model), name, arg, value])
+            continue
+        print(f"{ts(real)}  model {ts(model)}  {name:<13} {describe(kind, arg, value, model)}")
+
+        if kind == BOOT:
+            if sessions and prev:
+                sessions[-1].stop(prev[0], prev[1])  # power went some time after the last entry
+            sessions.append(Session(entry))
+        if not sessions:
+            continue
+        s = sessions[-1]
+        if kind == RUN:
+            s.running_since = (real, model)
+        elif kind == PAUSE:
+            s.stop(real, model)
+        elif kind == TIME_SET and s.running_since:
+            s.stop(real, value)  # the model time before the jump
+            s.running_since = (real, model)
+        elif kind == PULSES:
+            s.pulses[arg] = s.pulses.get(arg, 0) + value
+        elif kind == PULSES_MISSED:
+            s.missed[arg] = s.missed.get(arg, 0) + value
+
+    if torn:
+        print(f"{torn} damaged entries skipped", file=sys.stderr)
+    if writer or not sessions:
+        return
+    print()
+    sessions[-1].stop(last[0], last[1])
+    for s in sessions:
+        s.report()
+
+
+if __name__ == "__main__":
+    main()
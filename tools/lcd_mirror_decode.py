@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+"""Decode the LCD mirror stream (main/lcd_mirror.h) and show the display in the terminal.
+
+    lcd_mirror_decode.py /dev/ttyUSB1 [--baud 115200]   # needs pyserial
+    lcd_mirror_decode.py - < capture.bin                # raw capture from stdin
+"""
+import argparse
+import sys
+
+SYNC = b"\xa5\x5a"
+KEYFRAME = ord("K")
+DELTA = ord("D")
+
+
+def crc8(data, crc=0):
+    for b in data:
+        crc ^= b
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+    return crc
+
+
+class Decoder:
+    def __init__(self):
+        self.buf = bytearray()
+        self.cols = 0
+        self.rows = 0
+        self.cells = bytearray()
+        self.synced = False  # a keyframe was seen and no packet was lost since
+        self.seq = None
+        self.stats = {"keyframes": 0, "deltas": 0, "crc_errors": 0, "lost": 0, "bytes": 0}
+
+    def feed(self, data):
+        """Consume bytes, return True when the screen changed."""
+        self.buf += data
+        changed = False
+        while True:
+            start = self.buf.find(SYNC)
+            if start < 0:
+                del self.buf[:-1]
+                return changed
+            del self.buf[:start]
+            if len(self.buf) < 5:
+                return changed
+            ptype, seq, length = self.buf[2], self.buf[3], self.buf[4]
+            if len(self.buf) < 5 + length + 1:
+                return changed
+            payload = bytes(self.buf[5:5 + length])
+            if crc8(self.buf[2:5 + length]) != self.buf[5 + length]:
+                # not a packet after all, or a damaged one: look for the next sync
+                self.stats["crc_errors"] += 1
+                del self.buf[:1]
+                continue
+            del self.buf[:5 + length + 1]
+            self.stats["bytes"] += 5 + length + 1
+
+            if self.seq is not None and seq != (self.seq + 1) & 0xFF:
+                self.stats["lost"] += 1
+                self.synced = False
+            self.seq = seq
+            changed |= self.apply(ptype, payload)
+
+    def apply(self, ptype, payload):
+        if ptype == KEYFRAME:
+            self.cols, self.rows = payload[0], payload[1]
+            self.cells = bytearray(payload[2:2 + self.cols * self.rows])
+            self.synced = True
+            self.stats["keyframes"] += 1
+            return True
+        if ptype == DELTA and self.synced:
+            i = 0
+            while i + 2 <= len(payload):
+                pos, count = payload[i], payload[i + 1]
+                self.cells[pos:pos + count] = payload[i + 2:i + 2 + count]
+                i += 2 + count
+            self.stats["deltas"] += 1
+            return True
+        return False
+
+    def lines(self):
+        return [self.cells[r * self.cols:(r + 1) * self.cols].decode("latin-1") for r in range(self.rows)]
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("port", help="serial port, or - for stdin")
+    ap.add_argument("--baud", type=int, default=115200)
+    args = ap.parse_args()
+
+    if args.port == "-":
+        read = lambda: sys.stdin.buffer.read1(256)
+    else:
+        import serial  # pyserial
+
+        port = serial.Serial(args.port, args.baud, timeout=0.2)
+        read = lambda: port.read(256)
+
+    dec = Decoder()
+    try:
+        while True:
+            data = read()
+            if not data and args.port == "-":
+                break
+            if dec.feed(data) and dec.synced:
+                out = "\x1b[H\x1b[2J+" + "-" * dec.cols + "+\n"
+                out += "".join("|" + line + "|\n" for line in dec.lines())
+                out += "+" + "-" * dec.cols + "+\n"
+                frames = dec.stats["keyframes"] + dec.stats["deltas"]
+                out += "%d frames, %.1f B/frame, lost %d, crc %d\n" % (
+                    frames, dec.stats["bytes"] / frames, dec.stats["lost"], dec.stats["crc_errors"])
+                sys.stdout.write(out)
+                sys.stdout.flush()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,86 @@
+#!/usr/bin/env python3
+"""Pack WAV clips into the clip bank of the audio partition (main/audio_out.h).
+
+    pack_audio.py chime.wav half.wav -o clips.bin        # clip names from the file names
+    pack_audio.py jingle=station_a.wav:0.5 -o clips.bin  # own name, gain 0.5
+
+The WAVs have to be 16 bit mono at one sample rate; convert them first, e.g.
+    sox in.wav -r 22050 -c 1 -b 16 chime.wav
+Write the result with parttool.py write_partition --partition-name audio.
+"""
+import argparse
+import os
+import struct
+import sys
+import wave
+
+MAGIC = b"MCAU"
+VERSION = 1
+HEADER = struct.Struct("<4sHHII")
+ENTRY = struct.Struct("<16sIIH6x")
+NAME_LEN = 16
+CLIPS_MAX = 16
+GAIN_UNITY = 32768
+
+
+def parse_clip(arg):
+    """name=path:gain, name and gain optional."""
+    name, _, rest = arg.rpartition("=")
+    path, gain = rest, 1.0
+    if ":" in rest and not os.path.exists(rest):
+        path, _, g = rest.rpartition(":")
+        gain = float(g)
+    if not name:
+        name = os.path.splitext(os.path.basename(path))[0]
+    if len(name.encode()) > NAME_LEN:
+        sys.exit(f"{name}: clip names have at most {NAME_LEN} bytes")
+    if not 0.0 <= gain <= 1.0:
+        sys.exit(f"{name}: gain must be within 0..1")
+    return name, path, gain
+
+
+def read_wav(path):
+    with wave.open(path, "rb") as w:
+        if w.getnchannels() != 1 or w.getsampwidth() != 2:
+            sys.exit(f"{path}: need 16 bit mono, got {w.getnchannels()} channel(s) of {w.getsampwidth() * 8} bit")
+        return w.getframerate(), w.readframes(w.getnframes())
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("clips", nargs="+", help="[name=]file.wav[:gain]")
+    ap.add_argument("-o", "--output", required=True)
+    ap.add_argument("--size", type=lambda s: int(s, 0), default=0x200000, help="partition size (default 0x200000)")
+    args = ap.parse_args()
+
+    if len(args.clips) > CLIPS_MAX:
+        sys.exit(f"at most {CLIPS_MAX} clips")
+
+    rate = None
+    entries = []
+    data = bytearray()
+    offset = HEADER.size + ENTRY.size * len(args.clips)
+    offset = (offset + 3) & ~3
+    for arg in args.clips:
+        name, path, gain = parse_clip(arg)
+        clip_rate, pcm = read_wav(path)
+        if rate is None:
+            rate = clip_rate
+        elif clip_rate != rate:
+            sys.exit(f"{path}: {clip_rate} Hz, the other clips are {rate} Hz")
+        entries.append(ENTRY.pack(name.encode(), offset + len(data), len(pcm) // 2, min(int(gain * GAIN_UNITY), 0xFFFF)))
+        data += pcm
+        data += b"\0" * (-len(data) % 4)
+        print(f"{name}: {len(pcm) // 2 / clip_rate:.2f} s, gain {gain}")
+
+    blob = HEADER.pack(MAGIC, VERSION, len(entries), rate, 0) + b"".join(entries)
+    blob += b"\0" * (offset - len(blob)) + data
+    if len(blob) > args.size:
+        sys.exit(f"{len(blob)} bytes do not fit the {args.size} byte partition")
+    with open(args.output, "wb") as f:
+        f.write(blob)
+    print(f"{len(entries)} clips at {rate} Hz, {len(blob)} of {args.size} bytes")
+
+
+if __name__ == "__main__":
+    main()